@@ -0,0 +1,38 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/test/catch_main.cpp" "CMakeFiles/test_allocated_value.dir/test/catch_main.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/catch_main.cpp.o.d"
+  "/root/repo/test/test_allocated_value_basic.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_basic.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_basic.cpp.o.d"
+  "/root/repo/test/test_allocated_value_cold.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_cold.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_cold.cpp.o.d"
+  "/root/repo/test/test_allocated_value_compacting.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_compacting.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_compacting.cpp.o.d"
+  "/root/repo/test/test_allocated_value_fast_pimpl.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_fast_pimpl.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_fast_pimpl.cpp.o.d"
+  "/root/repo/test/test_allocated_value_flat.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_flat.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_flat.cpp.o.d"
+  "/root/repo/test/test_allocated_value_hash.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hash.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hash.cpp.o.d"
+  "/root/repo/test/test_allocated_value_hugepage_arena.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hugepage_arena.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hugepage_arena.cpp.o.d"
+  "/root/repo/test/test_allocated_value_interned.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_interned.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_interned.cpp.o.d"
+  "/root/repo/test/test_allocated_value_mapped_segment.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_mapped_segment.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_mapped_segment.cpp.o.d"
+  "/root/repo/test/test_allocated_value_nested.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_nested.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_nested.cpp.o.d"
+  "/root/repo/test/test_allocated_value_numa.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_numa.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_numa.cpp.o.d"
+  "/root/repo/test/test_allocated_value_odd_allocators.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_allocators.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_allocators.cpp.o.d"
+  "/root/repo/test/test_allocated_value_odd_types.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_types.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_types.cpp.o.d"
+  "/root/repo/test/test_allocated_value_pimpl.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_pimpl.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_pimpl.cpp.o.d"
+  "/root/repo/test/test_allocated_value_prefetch.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_prefetch.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_prefetch.cpp.o.d"
+  "/root/repo/test/test_allocated_value_slot_ptr.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_slot_ptr.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_slot_ptr.cpp.o.d"
+  "/root/repo/test/test_allocated_value_stack_allocator.cpp" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_stack_allocator.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_stack_allocator.cpp.o.d"
+  "/root/repo/test/test_fast_pimpl.cpp" "CMakeFiles/test_allocated_value.dir/test/test_fast_pimpl.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_fast_pimpl.cpp.o.d"
+  "/root/repo/test/test_pimpl.cpp" "CMakeFiles/test_allocated_value.dir/test/test_pimpl.cpp.o" "gcc" "CMakeFiles/test_allocated_value.dir/test/test_pimpl.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,49 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_allocated_value.dir/test/catch_main.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/catch_main.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_basic.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_basic.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_cold.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_cold.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_compacting.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_compacting.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_fast_pimpl.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_fast_pimpl.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_flat.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_flat.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hash.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hash.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hugepage_arena.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_hugepage_arena.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_interned.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_interned.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_mapped_segment.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_mapped_segment.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_nested.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_nested.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_numa.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_numa.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_allocators.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_allocators.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_types.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_odd_types.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_pimpl.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_pimpl.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_prefetch.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_prefetch.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_slot_ptr.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_slot_ptr.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_stack_allocator.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_allocated_value_stack_allocator.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_fast_pimpl.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_fast_pimpl.cpp.o.d"
+  "CMakeFiles/test_allocated_value.dir/test/test_pimpl.cpp.o"
+  "CMakeFiles/test_allocated_value.dir/test/test_pimpl.cpp.o.d"
+  "test_allocated_value"
+  "test_allocated_value.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_allocated_value.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
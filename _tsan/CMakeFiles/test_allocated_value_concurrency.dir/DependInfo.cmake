@@ -0,0 +1,24 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/test/catch_main.cpp" "CMakeFiles/test_allocated_value_concurrency.dir/test/catch_main.cpp.o" "gcc" "CMakeFiles/test_allocated_value_concurrency.dir/test/catch_main.cpp.o.d"
+  "/root/repo/test/test_allocated_value_destroy_parallel.cpp" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_destroy_parallel.cpp.o" "gcc" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_destroy_parallel.cpp.o.d"
+  "/root/repo/test/test_allocated_value_epoch.cpp" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_epoch.cpp.o" "gcc" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_epoch.cpp.o.d"
+  "/root/repo/test/test_allocated_value_hazard.cpp" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_hazard.cpp.o" "gcc" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_hazard.cpp.o.d"
+  "/root/repo/test/test_allocated_value_parallel_clone.cpp" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_parallel_clone.cpp.o" "gcc" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_parallel_clone.cpp.o.d"
+  "/root/repo/test/test_allocated_value_thread_affine.cpp" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_thread_affine.cpp.o" "gcc" "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_thread_affine.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
@@ -0,0 +1,21 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/catch_main.cpp.o"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/catch_main.cpp.o.d"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_destroy_parallel.cpp.o"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_destroy_parallel.cpp.o.d"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_epoch.cpp.o"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_epoch.cpp.o.d"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_hazard.cpp.o"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_hazard.cpp.o.d"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_parallel_clone.cpp.o"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_parallel_clone.cpp.o.d"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_thread_affine.cpp.o"
+  "CMakeFiles/test_allocated_value_concurrency.dir/test/test_allocated_value_thread_affine.cpp.o.d"
+  "test_allocated_value_concurrency"
+  "test_allocated_value_concurrency.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_allocated_value_concurrency.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
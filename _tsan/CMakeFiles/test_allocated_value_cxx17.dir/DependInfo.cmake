@@ -0,0 +1,23 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/test/catch_main.cpp" "CMakeFiles/test_allocated_value_cxx17.dir/test/catch_main.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx17.dir/test/catch_main.cpp.o.d"
+  "/root/repo/test/test_allocated_value_pmr_pool.cpp" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_pool.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_pool.cpp.o.d"
+  "/root/repo/test/test_allocated_value_pmr_stats.cpp" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_stats.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_stats.cpp.o.d"
+  "/root/repo/test/test_allocated_value_pmr_typed.cpp" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_typed.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_typed.cpp.o.d"
+  "/root/repo/test/test_allocated_value_soa.cpp" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_soa.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_soa.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
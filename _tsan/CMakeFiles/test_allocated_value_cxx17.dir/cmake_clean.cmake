@@ -0,0 +1,19 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/catch_main.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/catch_main.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_pool.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_pool.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_stats.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_stats.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_typed.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_pmr_typed.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_soa.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx17.dir/test/test_allocated_value_soa.cpp.o.d"
+  "test_allocated_value_cxx17"
+  "test_allocated_value_cxx17.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_allocated_value_cxx17.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,26 @@
+
+# Consider dependencies only in project.
+set(CMAKE_DEPENDS_IN_PROJECT_ONLY OFF)
+
+# The set of languages for which implicit dependencies are needed:
+set(CMAKE_DEPENDS_LANGUAGES
+  )
+
+# The set of dependency files which are needed:
+set(CMAKE_DEPENDS_DEPENDENCY_FILES
+  "/root/repo/test/catch_main.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/catch_main.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/catch_main.cpp.o.d"
+  "/root/repo/test/test_allocated_value_basic.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_basic.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_basic.cpp.o.d"
+  "/root/repo/test/test_allocated_value_constexpr.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_constexpr.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_constexpr.cpp.o.d"
+  "/root/repo/test/test_allocated_value_odd_allocators.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_allocators.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_allocators.cpp.o.d"
+  "/root/repo/test/test_allocated_value_odd_types.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_types.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_types.cpp.o.d"
+  "/root/repo/test/test_allocated_value_stack_allocator.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_stack_allocator.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_stack_allocator.cpp.o.d"
+  "/root/repo/test/test_allocated_value_task.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_task.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_task.cpp.o.d"
+  "/root/repo/test/test_allocated_value_three_way.cpp" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_three_way.cpp.o" "gcc" "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_three_way.cpp.o.d"
+  )
+
+# Targets to which this target links.
+set(CMAKE_TARGET_LINKED_INFO_FILES
+  )
+
+# Fortran module output directory.
+set(CMAKE_Fortran_TARGET_MODULE_DIR "")
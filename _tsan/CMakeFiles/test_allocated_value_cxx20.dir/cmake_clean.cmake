@@ -0,0 +1,25 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/catch_main.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/catch_main.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_basic.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_basic.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_constexpr.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_constexpr.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_allocators.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_allocators.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_types.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_odd_types.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_stack_allocator.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_stack_allocator.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_task.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_task.cpp.o.d"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_three_way.cpp.o"
+  "CMakeFiles/test_allocated_value_cxx20.dir/test/test_allocated_value_three_way.cpp.o.d"
+  "test_allocated_value_cxx20"
+  "test_allocated_value_cxx20.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_allocated_value_cxx20.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
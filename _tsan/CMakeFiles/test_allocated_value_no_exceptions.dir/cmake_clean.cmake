@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/test_allocated_value_no_exceptions.dir/test/test_allocated_value_no_exceptions.cpp.o"
+  "CMakeFiles/test_allocated_value_no_exceptions.dir/test/test_allocated_value_no_exceptions.cpp.o.d"
+  "test_allocated_value_no_exceptions"
+  "test_allocated_value_no_exceptions.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/test_allocated_value_no_exceptions.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,16 @@
+# CMake generated Testfile for 
+# Source directory: /root/repo
+# Build directory: /root/repo/_tsan
+# 
+# This file includes the relevant testing commands required for 
+# testing this directory and lists subdirectories to be tested as well.
+add_test(test_allocated_value "test_allocated_value")
+set_tests_properties(test_allocated_value PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;89;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(test_allocated_value_concurrency "test_allocated_value_concurrency")
+set_tests_properties(test_allocated_value_concurrency PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;105;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(test_allocated_value_no_exceptions "test_allocated_value_no_exceptions")
+set_tests_properties(test_allocated_value_no_exceptions PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;111;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(test_allocated_value_cxx17 "test_allocated_value_cxx17")
+set_tests_properties(test_allocated_value_cxx17 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;122;add_test;/root/repo/CMakeLists.txt;0;")
+add_test(test_allocated_value_cxx20 "test_allocated_value_cxx20")
+set_tests_properties(test_allocated_value_cxx20 PROPERTIES  _BACKTRACE_TRIPLES "/root/repo/CMakeLists.txt;137;add_test;/root/repo/CMakeLists.txt;0;")
@@ -0,0 +1,92 @@
+
+#include <tcb/cold.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * Scans an array of structs reading only their hot fields, comparing a
+ * struct holding its rarely-used fields inline, one which moves them into
+ * an allocated_value by hand, and one which uses cold<T>. Every 100th
+ * object has its cold fields written.
+ *
+ * Usage: bench_cold [objects] [scan passes]
+ */
+
+namespace {
+
+struct rarely_used {
+    std::string description;
+    double history[12];
+    int flags;
+};
+
+struct inline_record {
+    int key;
+    float score;
+    rarely_used details;
+};
+
+struct allocated_record {
+    int key;
+    float score;
+    tcb::allocated_value<rarely_used> details;
+};
+
+struct cold_record {
+    int key;
+    float score;
+    tcb::cold<rarely_used> details;
+};
+
+rarely_used& details(inline_record& r) { return r.details; }
+
+template <typename Record>
+rarely_used& details(Record& r) { return *r.details; }
+
+template <typename Record>
+void run(const char* name, std::size_t count, std::size_t passes)
+{
+    std::printf("%s (sizeof %zu):\n", name, sizeof(Record));
+
+    std::vector<Record> records;
+    const double build = bench::time_ms([&] {
+        records.resize(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            records[i].key = static_cast<int>(i);
+            records[i].score = static_cast<float>(i % 7);
+            if (i % 100 == 0) {
+                details(records[i]).flags = 1;
+            }
+        }
+    });
+    bench::report("  build", build, count);
+    std::printf("  cold arena: %zu bytes live\n",
+                tcb::cold_arena::this_thread().stats().live_bytes);
+
+    double sum = 0;
+    const double scan = bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            for (const auto& r : records) {
+                sum += r.score;
+            }
+        }
+    });
+    bench::do_not_optimize(sum);
+    bench::report("  scan hot fields", scan, double(count) * passes);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto count = bench::arg_or(argc, argv, 1, 1000000);
+    const auto passes = bench::arg_or(argc, argv, 2, 20);
+
+    run<inline_record>("inline", count, passes);
+    run<allocated_record>("allocated_value", count, passes);
+    run<cold_record>("cold", count, passes);
+}
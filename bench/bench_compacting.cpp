@@ -0,0 +1,97 @@
+
+#include <tcb/compacting_arena.hpp>
+
+#include "bench_util.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+/*
+ * Allocates many small values, frees a random 90% of them, then reports
+ * the resident set size (RSS) with std::allocator, and with a
+ * compacting_arena before and after compact(). Each RSS figure is the
+ * growth since the start of that run. Also times compact() and a scan over
+ * the surviving values before and after it.
+ *
+ * Usage: bench_compacting [values] [percentage kept]
+ */
+
+namespace {
+
+struct payload {
+    double a[7];
+    long id;
+};
+
+// Frees all but keep_percent% of values, chosen at random
+template <typename V>
+void churn(std::vector<V>& values, std::size_t keep_percent)
+{
+    std::mt19937 rng(42);
+    std::shuffle(values.begin(), values.end(), rng);
+    values.erase(values.begin() + values.size() * keep_percent / 100, values.end());
+    values.shrink_to_fit();
+}
+
+template <typename V>
+double sum_ids(const std::vector<V>& values)
+{
+    double total = 0;
+    for (const auto& v : values) {
+        total += double(v->id);
+    }
+    return total;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto n = bench::arg_or(argc, argv, 1, 2000000);
+    const auto keep = bench::arg_or(argc, argv, 2, 10);
+
+    {
+        const auto base = bench::rss_mib();
+        std::vector<tcb::allocated_value<payload>> values;
+        values.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            values.emplace_back(payload{{}, long(i)});
+        }
+        std::printf("%-48s %10.1f MiB\n", "std::allocator, all live", bench::rss_mib() - base);
+        churn(values, keep);
+        std::printf("%-48s %10.1f MiB\n", "std::allocator, after churn", bench::rss_mib() - base);
+    }
+
+    using value = tcb::allocated_value<payload, tcb::compacting_allocator<payload>>;
+    const auto base = bench::rss_mib();
+    tcb::compacting_arena<payload> arena;
+    std::vector<value> values;
+    values.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        values.emplace_back(payload{{}, long(i)}, arena);
+    }
+    std::printf("%-48s %10.1f MiB\n", "compacting_arena, all live", bench::rss_mib() - base);
+    churn(values, keep);
+    std::printf("%-48s %10.1f MiB  (%zu slabs, %.0f%% occupied)\n",
+                "compacting_arena, after churn", bench::rss_mib() - base,
+                arena.slab_count(), arena.occupancy() * 100);
+
+    bench::report("scan before compact()",
+                  bench::time_ms([&] { bench::do_not_optimize(sum_ids(values)); }),
+                  double(values.size()));
+
+    std::size_t released = 0;
+    bench::report("compact()",
+                  bench::time_ms([&] { released = arena.compact(); }),
+                  double(values.size()));
+
+    std::printf("%-48s %10.1f MiB  (%zu slabs released, %.0f%% occupied)\n",
+                "compacting_arena, after compact()", bench::rss_mib() - base,
+                released, arena.occupancy() * 100);
+
+    bench::report("scan after compact()",
+                  bench::time_ms([&] { bench::do_not_optimize(sum_ids(values)); }),
+                  double(values.size()));
+}
@@ -0,0 +1,71 @@
+
+#include "bench_util.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+/*
+ * Compares the time taken to compile compile_time_500_types.cpp, which
+ * instantiates allocated_value for 500 types, using the C++20
+ * requires-clause code path and the C++11 enable_if code path (selected
+ * with TCB_ALLOCATED_VALUE_NO_CONCEPTS).
+ *
+ * The compiler, source file and include path are baked in when the
+ * benchmark is built; see bench/CMakeLists.txt.
+ *
+ * Usage: bench_compile_time [repetitions]
+ */
+
+namespace {
+
+const char* const object_file = BENCH_OUTPUT_DIR "/compile_time_500_types.o";
+
+double compile_ms(const std::string& extra_flags)
+{
+    const std::string command = std::string(BENCH_CXX_COMPILER) +
+            " -std=c++20 -O1 -c -I \"" BENCH_INCLUDE_DIR "\" " + extra_flags +
+            " -o \"" + object_file + "\" \"" BENCH_SOURCE "\"";
+
+    int status = 0;
+    const double ms = bench::time_ms([&] { status = std::system(command.c_str()); });
+    if (status != 0) {
+        std::fprintf(stderr, "compilation failed: %s\n", command.c_str());
+        std::exit(1);
+    }
+    return ms;
+}
+
+long object_size()
+{
+    std::ifstream file(object_file, std::ios::binary | std::ios::ate);
+    return static_cast<long>(file.tellg());
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto reps = bench::arg_or(argc, argv, 1, 3);
+    constexpr double types = 500;
+
+    // Compile once first so that both paths see a warm file cache
+    compile_ms("");
+
+    double concepts = 0;
+    double sfinae = 0;
+    long concepts_size = 0;
+    long sfinae_size = 0;
+    for (std::size_t i = 0; i < reps; ++i) {
+        concepts += compile_ms("");
+        concepts_size = object_size();
+        sfinae += compile_ms("-DTCB_ALLOCATED_VALUE_NO_CONCEPTS");
+        sfinae_size = object_size();
+    }
+
+    bench::report("compile 500 types, requires-clauses", concepts / reps, types);
+    bench::report("compile 500 types, enable_if", sfinae / reps, types);
+    std::printf("object size: requires-clauses %ld bytes, enable_if %ld bytes\n",
+                concepts_size, sfinae_size);
+}
@@ -0,0 +1,92 @@
+
+#include <tcb/destroy_parallel.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+/*
+ * Destroys a std::vector of allocated_values on the calling thread, and
+ * with destroy_parallel() on pools of 1, 2, 4, ... workers up to the
+ * hardware concurrency, or a given maximum. Each value is a small struct,
+ * so the time is dominated by the calls to the allocator.
+ *
+ * Usage: bench_destroy_parallel [elements] [max workers]
+ */
+
+namespace {
+
+struct record {
+    record(long key, double weight) : key(key), weight(weight) {}
+
+    long key;
+    double weight;
+};
+
+std::vector<tcb::allocated_value<record>> make_values(std::size_t n)
+{
+    std::vector<tcb::allocated_value<record>> values;
+    values.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        values.emplace_back(tcb::in_place, long(i), 1.0);
+    }
+    return values;
+}
+
+using vector_type = std::vector<tcb::allocated_value<record>>;
+
+// Destroys values, with destroy_parallel() if there is a pool
+double destroy_ms(std::size_t n, tcb::work_stealing_pool* pool)
+{
+    auto values = make_values(n);
+    return bench::time_ms([&] {
+        if (pool) {
+            tcb::destroy_parallel(values, *pool);
+        }
+        vector_type().swap(values);
+    });
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto n = bench::arg_or(argc, argv, 1, 10000000);
+    const auto max_workers = bench::arg_or(argc, argv, 2, tcb::work_stealing_pool::default_size());
+    std::printf("%zu elements, %zu hardware threads\n", n, tcb::work_stealing_pool::default_size());
+
+    // The first entry is the plain vector destructor
+    std::vector<std::unique_ptr<tcb::work_stealing_pool>> pools;
+    pools.emplace_back();
+    for (std::size_t workers = 1;; workers *= 2) {
+        if (workers > max_workers) {
+            workers = max_workers;
+        }
+        pools.emplace_back(new tcb::work_stealing_pool(workers));
+        if (workers == max_workers) {
+            break;
+        }
+    }
+
+    // The time depends a good deal on the state the previous run left the
+    // heap in, so each case is run once in every position of a rotating
+    // order, and the best time is reported
+    std::vector<double> best(pools.size(), 0.0);
+    for (std::size_t run = 0; run < pools.size(); ++run) {
+        for (std::size_t j = 0; j < pools.size(); ++j) {
+            const auto i = (run + j) % pools.size();
+            const double ms = destroy_ms(n, pools[i].get());
+            best[i] = run == 0 || ms < best[i] ? ms : best[i];
+        }
+    }
+
+    bench::report("vector destructor", best[0], double(n));
+    for (std::size_t i = 1; i < pools.size(); ++i) {
+        char name[64];
+        std::snprintf(name, sizeof(name), "destroy_parallel, %zu workers", pools[i]->size());
+        bench::report(name, best[i], double(n));
+        std::printf("%48s %10.2fx\n", "speedup", best[0] / best[i]);
+    }
+}
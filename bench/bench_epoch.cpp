@@ -0,0 +1,130 @@
+
+#include <tcb/epoch.hpp>
+
+#include "bench_util.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Readers look up routes in a shared table while one writer continuously
+ * replaces it. Compares an allocated_value guarded by a std::shared_mutex,
+ * which the writer locks exclusively to swap in each new table, against an
+ * epoch_cell, for 1 to max threads readers. Reports the total lookups per
+ * second and the number of tables the writer published.
+ *
+ * Usage: bench_epoch [max reader threads] [milliseconds per run]
+ */
+
+namespace {
+
+struct routing_table {
+    explicit routing_table(unsigned version)
+        : routes(4096, version)
+    {}
+
+    std::vector<unsigned> routes;
+};
+
+using table_value = tcb::allocated_value<routing_table>;
+
+struct locked_table {
+    explicit locked_table(table_value t) : table(std::move(t)) {}
+
+    unsigned lookup(unsigned key)
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return table->routes[key % table->routes.size()];
+    }
+
+    void replace(table_value next)
+    {
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            swap(table, next);
+        }
+        // The old table is destroyed outside the lock
+    }
+
+    std::shared_mutex mutex;
+    table_value table;
+};
+
+struct epoch_table {
+    explicit epoch_table(table_value t) : cell(domain, std::move(t)) {}
+
+    unsigned lookup(unsigned key)
+    {
+        tcb::epoch::guard g(domain);
+        const auto& table = cell.load(g);
+        return table.routes[key % table.routes.size()];
+    }
+
+    void replace(table_value next)
+    {
+        cell.store(std::move(next));
+    }
+
+    tcb::epoch domain;
+    tcb::epoch_cell<routing_table> cell;
+};
+
+template <typename Table>
+void run(const char* name, unsigned readers, std::chrono::milliseconds duration)
+{
+    Table table(table_value(tcb::in_place, 0u));
+    std::atomic<bool> stop{false};
+    std::atomic<unsigned long long> lookups{0};
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            unsigned long long n = 0;
+            unsigned key = t;
+            unsigned sum = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                sum += table.lookup(key);
+                key = key * 1664525u + 1013904223u;
+                ++n;
+            }
+            bench::do_not_optimize(sum);
+            lookups += n;
+        });
+    }
+
+    unsigned version = 0;
+    std::thread writer([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            table.replace(table_value(tcb::in_place, ++version));
+        }
+    });
+
+    std::this_thread::sleep_for(duration);
+    stop = true;
+    writer.join();
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    const double seconds = std::chrono::duration<double>(duration).count();
+    std::printf("%-16s %3u readers %12.2f M lookups/s %8u tables\n",
+                name, readers, double(lookups) / seconds / 1e6, version);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto max_readers = static_cast<unsigned>(bench::arg_or(argc, argv, 1, 64));
+    const std::chrono::milliseconds duration(bench::arg_or(argc, argv, 2, 500));
+
+    for (unsigned readers = 1; readers <= max_readers; readers *= 2) {
+        run<locked_table>("shared_mutex", readers, duration);
+        run<epoch_table>("epoch", readers, duration);
+    }
+}
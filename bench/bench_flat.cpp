@@ -0,0 +1,135 @@
+
+#include <tcb/flat.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/*
+ * Round-trips a message containing nested allocated_values, comparing
+ * tcb::flatten() plus an in-place read through flat_view against writing
+ * each field to a byte stream and reading it back into new allocated_values.
+ *
+ * Usage: bench_flat [iterations]
+ */
+
+using tcb::allocated_value;
+
+namespace {
+
+struct vec3 {
+    double x, y, z;
+};
+
+struct message {
+    std::uint64_t id;
+    allocated_value<vec3> position;
+    allocated_value<vec3> velocity;
+    allocated_value<allocated_value<std::uint32_t>> flags;
+};
+
+struct flat_message {
+    std::uint64_t id;
+    tcb::flat_ref<vec3> position;
+    tcb::flat_ref<vec3> velocity;
+    tcb::flat_ref<tcb::flat_ref<std::uint32_t>> flags;
+};
+
+}
+
+namespace tcb {
+
+template <>
+struct flat_traits<message> {
+    using flat_type = flat_message;
+
+    static void write(flat_writer& w, std::size_t at, const message& m)
+    {
+        w.write_member(at, &flat_message::id, m.id);
+        w.write_member(at, &flat_message::position, m.position);
+        w.write_member(at, &flat_message::velocity, m.velocity);
+        w.write_member(at, &flat_message::flags, m.flags);
+    }
+
+    static bool check(flat_checker& c, const flat_message& f)
+    {
+        return c.check<decltype(message::position)>(f.position) &&
+               c.check<decltype(message::velocity)>(f.velocity) &&
+               c.check<decltype(message::flags)>(f.flags);
+    }
+};
+
+}
+
+namespace {
+
+template <typename T>
+void put(std::vector<char>& out, const T& value)
+{
+    const auto at = out.size();
+    out.resize(at + sizeof(T));
+    std::memcpy(out.data() + at, &value, sizeof(T));
+}
+
+template <typename T>
+T take(const char*& in)
+{
+    T value;
+    std::memcpy(&value, in, sizeof(T));
+    in += sizeof(T);
+    return value;
+}
+
+std::vector<char> serialize_fields(const message& m)
+{
+    std::vector<char> out;
+    put(out, m.id);
+    put(out, *m.position);
+    put(out, *m.velocity);
+    put(out, **m.flags);
+    return out;
+}
+
+message deserialize_fields(const std::vector<char>& buf)
+{
+    const char* in = buf.data();
+    const auto id = take<std::uint64_t>(in);
+    const auto pos = take<vec3>(in);
+    const auto vel = take<vec3>(in);
+    const auto flags = take<std::uint32_t>(in);
+    return message{id, allocated_value<vec3>{pos}, allocated_value<vec3>{vel},
+                   allocated_value<allocated_value<std::uint32_t>>{allocated_value<std::uint32_t>{flags}}};
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto iters = bench::arg_or(argc, argv, 1, 2000000);
+
+    const message m{42, allocated_value<vec3>{vec3{1, 2, 3}},
+                    allocated_value<vec3>{vec3{4, 5, 6}},
+                    allocated_value<allocated_value<std::uint32_t>>{allocated_value<std::uint32_t>{7}}};
+
+    double sum = 0;
+    auto ms = bench::time_ms([&] {
+        for (std::size_t i = 0; i < iters; i++) {
+            const auto received = deserialize_fields(serialize_fields(m));
+            sum += received.position->x + **received.flags;
+        }
+    });
+    bench::report("per-field serialize + deserialize", ms, iters);
+
+    ms = bench::time_ms([&] {
+        for (std::size_t i = 0; i < iters; i++) {
+            const auto buf = tcb::flatten(m);
+            const auto v = buf.view();
+            sum += v->position->x + **v->flags;
+        }
+    });
+    bench::report("flatten + in-place view", ms, iters);
+
+    bench::do_not_optimize(sum);
+}
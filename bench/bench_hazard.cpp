@@ -0,0 +1,139 @@
+
+#include <tcb/epoch.hpp>
+#include <tcb/hazard_pointer.hpp>
+
+#include "bench_util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+/*
+ * Readers repeatedly read a shared config while one writer replaces it.
+ * Times every read and every write, with hazard_slot and with epoch_cell,
+ * and reports latency percentiles together with the largest number of
+ * retired configs awaiting destruction.
+ *
+ * Usage: bench_hazard [reader threads] [operations per reader]
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct config {
+    explicit config(unsigned version)
+        : values(256, version)
+    {}
+
+    std::vector<unsigned> values;
+};
+
+using config_value = tcb::allocated_value<config>;
+
+struct hazard_cell {
+    hazard_cell() : slot(config_value(tcb::in_place, 0u), domain) {}
+
+    unsigned read(unsigned key)
+    {
+        const auto h = slot.protect();
+        return h->values[key % h->values.size()];
+    }
+
+    void write(unsigned version) { slot.emplace(version); }
+    std::size_t pending() const { return domain.pending(); }
+
+    tcb::hazard_domain domain;
+    tcb::hazard_slot<config> slot;
+};
+
+struct epoch_cell {
+    epoch_cell() : cell(domain, config_value(tcb::in_place, 0u)) {}
+
+    unsigned read(unsigned key)
+    {
+        tcb::epoch::guard g(domain);
+        const auto& c = cell.load(g);
+        return c.values[key % c.values.size()];
+    }
+
+    void write(unsigned version) { cell.store(config_value(tcb::in_place, version)); }
+    std::size_t pending() const { return domain.pending(); }
+
+    tcb::epoch domain;
+    tcb::epoch_cell<config> cell;
+};
+
+template <typename F>
+double elapsed_ns(F&& f)
+{
+    const auto start = clock_type::now();
+    f();
+    return std::chrono::duration<double, std::nano>(clock_type::now() - start).count();
+}
+
+void report_latency(const char* name, std::vector<double>& ns)
+{
+    std::sort(ns.begin(), ns.end());
+    const auto at = [&](double q) { return ns[std::size_t(q * double(ns.size() - 1))]; };
+    std::printf("  %-10s p50 %8.0f ns   p99 %8.0f ns   p99.9 %8.0f ns   max %10.0f ns\n",
+                name, at(0.5), at(0.99), at(0.999), ns.back());
+}
+
+template <typename Cell>
+void run(const char* name, unsigned readers, std::size_t ops)
+{
+    Cell cell;
+    std::atomic<unsigned> running{readers};
+    std::vector<std::vector<double>> read_ns(readers);
+    std::vector<double> write_ns;
+    std::size_t max_pending = 0;
+
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < readers; ++t) {
+        threads.emplace_back([&, t] {
+            auto& samples = read_ns[t];
+            samples.reserve(ops);
+            unsigned key = t;
+            unsigned sum = 0;
+            for (std::size_t i = 0; i < ops; ++i) {
+                samples.push_back(elapsed_ns([&] { sum += cell.read(key); }));
+                key = key * 1664525u + 1013904223u;
+            }
+            bench::do_not_optimize(sum);
+            --running;
+        });
+    }
+
+    unsigned version = 0;
+    while (running.load() > 0) {
+        write_ns.push_back(elapsed_ns([&] { cell.write(++version); }));
+        max_pending = std::max(max_pending, cell.pending());
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    std::vector<double> all;
+    for (auto& r : read_ns) {
+        all.insert(all.end(), r.begin(), r.end());
+    }
+    std::printf("%s: %u readers, %u writes, at most %zu retired configs pending\n",
+                name, readers, version, max_pending);
+    report_latency("read", all);
+    report_latency("write", write_ns);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto readers = static_cast<unsigned>(bench::arg_or(argc, argv, 1, 4));
+    const auto ops = bench::arg_or(argc, argv, 2, 1000000);
+
+    run<hazard_cell>("hazard_slot", readers, ops);
+    run<epoch_cell>("epoch_cell", readers, ops);
+}
@@ -0,0 +1,69 @@
+
+#include <tcb/hugepage_arena.hpp>
+
+#include "bench_util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/*
+ * Builds N allocated_value<node> handles, links them into a single random
+ * cycle and then chases the links, which defeats the hardware prefetcher and
+ * makes the run dominated by cache and TLB misses. The same walk is timed
+ * with std::allocator (malloc) and with a hugepage_arena.
+ *
+ * Usage: bench_hugepage_arena [handles (default 50M)]
+ */
+
+namespace {
+
+struct node {
+    std::uint32_t next;
+    std::uint32_t payload;
+};
+
+template <typename Value, typename... Alloc>
+void run(const char* name, const std::vector<std::uint32_t>& order, Alloc&... alloc)
+{
+    const auto n = order.size();
+
+    std::vector<Value> values;
+    values.reserve(n);
+    for (std::size_t i = 0; i < n; i++) {
+        values.emplace_back(node{0, static_cast<std::uint32_t>(i)}, alloc...);
+    }
+    for (std::size_t i = 0; i < n; i++) {
+        values[order[i]]->next = order[(i + 1) % n];
+    }
+
+    std::uint64_t sum = 0;
+    const auto ms = bench::time_ms([&] {
+        std::uint32_t idx = order[0];
+        for (std::size_t i = 0; i < n; i++) {
+            sum += values[idx]->payload;
+            idx = values[idx]->next;
+        }
+    });
+    bench::do_not_optimize(sum);
+    bench::report(name, ms, n);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto n = bench::arg_or(argc, argv, 1, 50000000);
+
+    std::vector<std::uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+    std::shuffle(order.begin(), order.end(), std::mt19937{42});
+
+    run<tcb::allocated_value<node>>("std::allocator", order);
+
+    tcb::hugepage_arena arena{n * tcb::hugepage_arena::granularity};
+    std::printf("(huge pages %s)\n", arena.uses_huge_pages() ? "enabled" : "unavailable");
+    run<tcb::allocated_value<node, tcb::arena_allocator<node>>>("hugepage_arena", order, arena);
+}
@@ -0,0 +1,121 @@
+
+#include <tcb/interned_value.hpp>
+
+#include "bench_util.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Stores N keys drawn from K distinct strings, first as one
+ * allocated_value<std::string> each and then as interned handles, and
+ * reports the heap bytes used by each representation. Then measures the
+ * throughput of intern() lookups for values already present, from 1 and 4
+ * threads.
+ *
+ * Usage: bench_interned [keys] [distinct keys]
+ */
+
+namespace {
+
+std::atomic<std::size_t> heap_bytes{0};
+
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind { using other = counting_allocator<U>; };
+
+    counting_allocator() = default;
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        heap_bytes += n * sizeof(T);
+        return std::allocator<T>::allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        heap_bytes -= n * sizeof(T);
+        std::allocator<T>::deallocate(p, n);
+    }
+};
+
+using string_t = std::basic_string<char, std::char_traits<char>, counting_allocator<char>>;
+
+struct key_hash {
+    std::size_t operator()(const string_t& s) const noexcept
+    {
+        std::size_t h = 14695981039346656037ull;
+        for (char c : s) {
+            h = (h ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+string_t key(std::size_t i)
+{
+    return string_t("a moderately long key which will not fit in SSO #") +
+           std::to_string(i).c_str();
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto n = bench::arg_or(argc, argv, 1, 1000000);
+    const auto k = bench::arg_or(argc, argv, 2, 1000);
+
+    {
+        std::vector<tcb::allocated_value<string_t, counting_allocator<string_t>>> values;
+        values.reserve(n);
+        const auto before = heap_bytes.load();
+        for (std::size_t i = 0; i < n; i++) {
+            values.emplace_back(key(i % k));
+        }
+        std::printf("allocated_value<string>: %zu bytes of values\n", heap_bytes - before);
+    }
+
+    using pool_t = tcb::intern_pool<string_t, key_hash, std::equal_to<string_t>,
+                                    counting_allocator<string_t>>;
+    pool_t pool;
+    std::vector<pool_t::handle> handles;
+    handles.reserve(n);
+    {
+        const auto before = heap_bytes.load();
+        for (std::size_t i = 0; i < n; i++) {
+            handles.push_back(pool.intern(key(i % k)));
+        }
+        std::printf("interned<string>:        %zu bytes of values (incl. table)\n",
+                    heap_bytes - before);
+    }
+
+    std::vector<string_t> keys;
+    for (std::size_t i = 0; i < k; i++) {
+        keys.push_back(key(i));
+    }
+
+    for (unsigned threads : {1u, 4u}) {
+        const auto per_thread = n / threads;
+        const auto ms = bench::time_ms([&] {
+            std::vector<std::thread> pool_threads;
+            for (unsigned t = 0; t < threads; t++) {
+                pool_threads.emplace_back([&, t] {
+                    for (std::size_t i = 0; i < per_thread; i++) {
+                        auto h = pool.intern(keys[(i + t * 7) % k]);
+                        bench::do_not_optimize(h);
+                    }
+                });
+            }
+            for (auto& t : pool_threads) {
+                t.join();
+            }
+        });
+        std::printf("%u thread(s): ", threads);
+        bench::report("intern() lookup", ms, per_thread * threads);
+    }
+}
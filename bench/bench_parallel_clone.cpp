@@ -0,0 +1,99 @@
+
+#include <tcb/parallel_clone.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/*
+ * Deep-copies a configuration tree -- nodes holding a name and a vector of
+ * allocated_value children -- with the copy constructor, and with
+ * parallel_clone() on pools of 1, 2, 4, ... workers up to the hardware
+ * concurrency, or a given maximum. The default tree has a fanout of 10 and
+ * a depth of 6, which is 1,111,111 nodes.
+ *
+ * Usage: bench_parallel_clone [fanout] [depth] [max workers]
+ */
+
+namespace {
+
+struct config_node {
+    int id;
+    std::string name;
+    std::vector<tcb::allocated_value<config_node>> children;
+};
+
+tcb::allocated_value<config_node> make_tree(std::size_t fanout, std::size_t depth,
+                                            int& next_id)
+{
+    const int id = next_id++;
+    tcb::allocated_value<config_node> node(config_node{id, "key" + std::to_string(id), {}});
+    if (depth > 0) {
+        node->children.reserve(fanout);
+        for (std::size_t i = 0; i < fanout; ++i) {
+            node->children.push_back(make_tree(fanout, depth - 1, next_id));
+        }
+    }
+    return node;
+}
+
+}
+
+namespace tcb {
+
+template <>
+struct clone_traits<config_node> {
+    static config_node clone(clone_context& ctx, const config_node& node)
+    {
+        return config_node{node.id, node.name, ctx.clone(node.children)};
+    }
+};
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto fanout = bench::arg_or(argc, argv, 1, 10);
+    const auto depth = bench::arg_or(argc, argv, 2, 6);
+    const auto max_workers = bench::arg_or(argc, argv, 3, tcb::work_stealing_pool::default_size());
+
+    int nodes = 0;
+    const auto tree = make_tree(fanout, depth, nodes);
+    std::printf("%d nodes, %zu hardware threads\n", nodes, tcb::work_stealing_pool::default_size());
+
+    double serial_ms = 0;
+    {
+        tcb::allocated_value<config_node> copy(tree);
+        serial_ms = bench::time_ms([&] {
+            tcb::allocated_value<config_node> again(tree);
+            bench::do_not_optimize(again);
+            copy = std::move(again);
+        });
+        bench::report("copy constructor", serial_ms, nodes);
+    }
+
+    for (std::size_t workers = 1;; workers *= 2) {
+        if (workers > max_workers) {
+            workers = max_workers;
+        }
+        tcb::work_stealing_pool pool(workers);
+        // Warm up the pool's threads and the allocator
+        auto copy = tcb::parallel_clone(tree, pool);
+        const double ms = bench::time_ms([&] {
+            auto again = tcb::parallel_clone(tree, pool);
+            bench::do_not_optimize(again);
+            copy = std::move(again);
+        });
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "parallel_clone, %zu workers", workers);
+        bench::report(name, ms, nodes);
+        std::printf("%48s %10.2fx\n", "speedup", serial_ms / ms);
+
+        if (workers == max_workers) {
+            break;
+        }
+    }
+}
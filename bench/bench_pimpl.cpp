@@ -0,0 +1,59 @@
+
+#include "bench_pimpl_widgets.hpp"
+
+#include "bench_util.hpp"
+
+#include <cstdio>
+#include <vector>
+
+/*
+ * Compares a pimpl class using allocated_value against one using
+ * fast_pimpl: the throughput of constructing and destroying objects, and
+ * the latency of an out-of-line member call on objects held in a vector.
+ *
+ * Usage: bench_pimpl [objects] [call passes]
+ */
+
+namespace {
+
+template <typename Widget>
+void run(const char* name, std::size_t count, std::size_t passes)
+{
+    std::printf("%s:\n", name);
+
+    const double construct = bench::time_ms([&] {
+        for (std::size_t i = 0; i < count; ++i) {
+            Widget w(static_cast<int>(i));
+            bench::do_not_optimize(w);
+        }
+    });
+    bench::report("  construct + destroy", construct, count);
+
+    std::vector<Widget> widgets;
+    widgets.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        widgets.emplace_back(static_cast<int>(i));
+    }
+
+    long long sum = 0;
+    const double calls = bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            for (const auto& w : widgets) {
+                sum += w.value();
+            }
+        }
+    });
+    bench::do_not_optimize(sum);
+    bench::report("  member call", calls, double(count) * passes);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto count = bench::arg_or(argc, argv, 1, 1000000);
+    const auto passes = bench::arg_or(argc, argv, 2, 20);
+
+    run<heap_widget>("allocated_value pimpl", count, passes);
+    run<inline_widget>("fast_pimpl", count, passes);
+}
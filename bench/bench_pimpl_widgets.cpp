@@ -0,0 +1,39 @@
+#include "bench_pimpl_widgets.hpp"
+
+struct heap_widget::private_ {
+    int value;
+    int scale;
+    double weight;
+    void* user_data;
+};
+
+heap_widget::heap_widget(int val)
+    : priv_(private_{val, 2, 1.0, nullptr})
+{}
+
+heap_widget::heap_widget(heap_widget&&) noexcept = default;
+heap_widget::~heap_widget() = default;
+
+int heap_widget::value() const
+{
+    return priv_->value * priv_->scale;
+}
+
+struct inline_widget::private_ {
+    int value;
+    int scale;
+    double weight;
+    void* user_data;
+};
+
+inline_widget::inline_widget(int val)
+    : priv_(private_{val, 2, 1.0, nullptr})
+{}
+
+inline_widget::inline_widget(inline_widget&&) noexcept = default;
+inline_widget::~inline_widget() = default;
+
+int inline_widget::value() const
+{
+    return priv_->value * priv_->scale;
+}
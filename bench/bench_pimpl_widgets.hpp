@@ -0,0 +1,37 @@
+
+#pragma once
+
+#include <tcb/allocated_value.hpp>
+#include <tcb/fast_pimpl.hpp>
+
+// Two otherwise identical classes, one storing its implementation through
+// allocated_value and one through fast_pimpl. The members are defined in
+// bench_pimpl_widgets.cpp, so calls cannot be inlined into the benchmark.
+
+class heap_widget {
+public:
+    explicit heap_widget(int val);
+
+    heap_widget(heap_widget&&) noexcept;
+    ~heap_widget();
+
+    int value() const;
+
+private:
+    struct private_;
+    tcb::allocated_value<private_> priv_;
+};
+
+class inline_widget {
+public:
+    explicit inline_widget(int val);
+
+    inline_widget(inline_widget&&) noexcept;
+    ~inline_widget();
+
+    int value() const;
+
+private:
+    struct private_;
+    tcb::fast_pimpl<private_, 32, 8> priv_;
+};
@@ -0,0 +1,85 @@
+
+#include <tcb/pmr/allocated_value.hpp>
+#include <tcb/pmr/object_pool_resource.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Churns a population of tcb::pmr::allocated_value<blob<N>> objects, replacing
+ * a pseudo-randomly chosen element on each iteration, with each of the
+ * candidate memory resources.
+ *
+ * Usage: bench_pool_resource [live objects] [iterations]
+ */
+
+namespace {
+
+template <std::size_t N>
+struct blob {
+    char data[N];
+};
+
+template <std::size_t N>
+double churn(std::pmr::memory_resource* res, std::size_t live, std::size_t iters)
+{
+    using value_t = tcb::pmr::allocated_value<blob<N>>;
+
+    std::pmr::vector<value_t> values{res};
+    values.reserve(live);
+    for (std::size_t i = 0; i < live; i++) {
+        values.emplace_back(blob<N>{});
+    }
+
+    std::uint32_t state = 12345;
+    return bench::time_ms([&] {
+        for (std::size_t i = 0; i < iters; i++) {
+            state = state * 1664525u + 1013904223u;
+            values[state % live] = value_t{blob<N>{}, res};
+        }
+        bench::do_not_optimize(values.front());
+    });
+}
+
+template <std::size_t N>
+void run_size(std::size_t live, std::size_t iters)
+{
+    std::printf("-- %zu byte objects\n", N);
+
+    {
+        const auto ms = churn<N>(std::pmr::new_delete_resource(), live, iters);
+        bench::report("new_delete_resource", ms, iters);
+    }
+    {
+        std::pmr::unsynchronized_pool_resource res;
+        bench::report("std::pmr::unsynchronized_pool_resource", churn<N>(&res, live, iters), iters);
+    }
+    {
+        std::pmr::synchronized_pool_resource res;
+        bench::report("std::pmr::synchronized_pool_resource", churn<N>(&res, live, iters), iters);
+    }
+    {
+        tcb::pmr::unsynchronized_object_pool_resource res;
+        bench::report("tcb::pmr::unsynchronized_object_pool_resource", churn<N>(&res, live, iters), iters);
+    }
+    {
+        tcb::pmr::synchronized_object_pool_resource res;
+        bench::report("tcb::pmr::synchronized_object_pool_resource", churn<N>(&res, live, iters), iters);
+    }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto live = bench::arg_or(argc, argv, 1, 10000);
+    const auto iters = bench::arg_or(argc, argv, 2, 2000000);
+
+    run_size<16>(live, iters);
+    run_size<64>(live, iters);
+    run_size<256>(live, iters);
+    run_size<1024>(live, iters);
+}
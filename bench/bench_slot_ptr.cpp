@@ -0,0 +1,71 @@
+
+#include <tcb/slot_ptr.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+/*
+ * Creates many handles to small values, with std::allocator and with
+ * slot_allocator, and reports the memory used per handle (handle plus
+ * value, from the growth in RSS) and the cost of dereferencing every handle
+ * in sequential and in scattered order.
+ *
+ * Usage: bench_slot_ptr [handles]
+ */
+
+namespace {
+
+// Visits every index once, in a scattered order
+inline std::size_t scatter(std::size_t i, std::size_t n)
+{
+    return (i * 2654435761u) % n;
+}
+
+template <typename V>
+void run(const char* name, std::size_t n)
+{
+    const auto base = bench::rss_mib();
+    std::vector<V> values;
+    values.reserve(n);
+    const auto build_ms = bench::time_ms([&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            values.emplace_back(static_cast<std::uint32_t>(i));
+        }
+    });
+    const auto mib = bench::rss_mib() - base;
+
+    std::printf("%s\n", name);
+    std::printf("  %-46s %10zu bytes\n", "handle size", sizeof(V));
+    std::printf("  %-46s %10.1f MiB  (%.1f bytes/handle)\n", "RSS growth",
+                mib, mib * 1024 * 1024 / double(n));
+    bench::report("  build", build_ms, double(n));
+
+    std::uint64_t sum = 0;
+    bench::report("  sequential dereference", bench::time_ms([&] {
+        for (const auto& v : values) {
+            sum += *v;
+        }
+    }), double(n));
+    bench::report("  scattered dereference", bench::time_ms([&] {
+        for (std::size_t i = 0; i < n; ++i) {
+            sum += *values[scatter(i, n)];
+        }
+    }), double(n));
+    bench::do_not_optimize(sum);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto n = bench::arg_or(argc, argv, 1, 100000000);
+
+    // The slot table is never freed, so run it first to stop the other run
+    // reusing its memory
+    run<tcb::allocated_value<std::uint32_t, tcb::slot_allocator<std::uint32_t>>>(
+            "slot_allocator", n);
+    run<tcb::allocated_value<std::uint32_t>>("std::allocator", n);
+}
@@ -0,0 +1,116 @@
+
+#include <tcb/value_soa.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdio>
+#include <vector>
+
+/*
+ * Reduces and updates single fields across many particles, comparing a
+ * vector of allocated_value<particle>, a plain vector<particle> and a
+ * value_soa<particle>, whose field spans the compiler can vectorise.
+ *
+ * Usage: bench_soa [particles] [passes]
+ */
+
+namespace {
+
+struct particle {
+    float x, y, z;
+    float vx, vy, vz;
+    float mass;
+    int id;
+};
+
+particle make_particle(std::size_t i)
+{
+    const float f = static_cast<float>(i % 1000);
+    return particle{f, f, f, 0.5f, 0.25f, 0.125f, 1.0f + f / 1000, static_cast<int>(i)};
+}
+
+constexpr float dt = 0.01f;
+
+}
+
+template <>
+struct tcb::soa_fields<particle> {
+    static constexpr auto members = std::make_tuple(
+            &particle::x, &particle::y, &particle::z,
+            &particle::vx, &particle::vy, &particle::vz,
+            &particle::mass, &particle::id);
+};
+
+int main(int argc, char** argv)
+{
+    const auto count = bench::arg_or(argc, argv, 1, 4000000);
+    const auto passes = bench::arg_or(argc, argv, 2, 10);
+    const double ops = double(count) * passes;
+
+    std::vector<tcb::allocated_value<particle>> handles;
+    std::vector<particle> aos;
+    tcb::value_soa<particle> soa;
+    handles.reserve(count);
+    aos.reserve(count);
+    soa.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        handles.emplace_back(make_particle(i));
+        aos.push_back(make_particle(i));
+        soa.push_back(make_particle(i));
+    }
+
+    float total = 0;
+
+    std::printf("sum of mass:\n");
+    bench::report("  vector<allocated_value>", bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            for (const auto& h : handles) {
+                total += h->mass;
+            }
+        }
+    }), ops);
+    bench::report("  vector<particle>", bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            for (const auto& a : aos) {
+                total += a.mass;
+            }
+        }
+    }), ops);
+    bench::report("  value_soa field span", bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            for (float m : soa.field<&particle::mass>()) {
+                total += m;
+            }
+        }
+    }), ops);
+
+    std::printf("x += vx * dt:\n");
+    bench::report("  vector<allocated_value>", bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            for (auto& h : handles) {
+                h->x += h->vx * dt;
+            }
+        }
+    }), ops);
+    bench::report("  vector<particle>", bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            for (auto& a : aos) {
+                a.x += a.vx * dt;
+            }
+        }
+    }), ops);
+    bench::report("  value_soa field spans", bench::time_ms([&] {
+        for (std::size_t p = 0; p < passes; ++p) {
+            const auto x = soa.field<&particle::x>();
+            const auto vx = soa.field<&particle::vx>();
+            for (std::size_t i = 0; i < x.size(); ++i) {
+                x[i] += vx[i] * dt;
+            }
+        }
+    }), ops);
+
+    bench::do_not_optimize(total);
+    bench::do_not_optimize(soa.get(count / 2));
+    bench::do_not_optimize(aos[count / 2]);
+    bench::do_not_optimize(*handles[count / 2]);
+}
@@ -0,0 +1,63 @@
+
+#include <tcb/pmr/object_pool_resource.hpp>
+#include <tcb/task.hpp>
+
+#include "bench_util.hpp"
+
+#include <memory_resource>
+
+/*
+ * Spawns and awaits millions of small tasks, one after another, with their
+ * frames allocated by global operator new (through std::allocator), by the
+ * object pool resource and by std::pmr::unsynchronized_pool_resource.
+ *
+ * Usage: bench_task [tasks]
+ */
+
+namespace {
+
+using pmr_alloc = std::pmr::polymorphic_allocator<std::byte>;
+
+template <typename Alloc>
+tcb::task<long, Alloc> leaf(std::allocator_arg_t, Alloc, long i)
+{
+    co_return i * 2 + 1;
+}
+
+template <typename Alloc>
+tcb::task<long, Alloc> spawn_all(std::allocator_arg_t, Alloc alloc, std::size_t n)
+{
+    long total = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        total += co_await leaf(std::allocator_arg, alloc, long(i));
+    }
+    co_return total;
+}
+
+template <typename Alloc>
+void run(const char* name, Alloc alloc, std::size_t n)
+{
+    const double ms = bench::time_ms([&] {
+        auto t = spawn_all(std::allocator_arg, alloc, n);
+        t.start();
+        bench::do_not_optimize(t.get());
+    });
+    bench::report(name, ms, double(n));
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto n = bench::arg_or(argc, argv, 1, 10000000);
+
+    run("std::allocator", std::allocator<std::byte>(), n);
+    {
+        tcb::pmr::unsynchronized_object_pool_resource pool;
+        run("unsynchronized_object_pool_resource", pmr_alloc(&pool), n);
+    }
+    {
+        std::pmr::unsynchronized_pool_resource pool;
+        run("std::pmr::unsynchronized_pool_resource", pmr_alloc(&pool), n);
+    }
+}
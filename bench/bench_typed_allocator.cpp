@@ -0,0 +1,61 @@
+
+#include <tcb/pmr/allocated_value.hpp>
+#include <tcb/pmr/object_pool_resource.hpp>
+#include <tcb/pmr/typed_resource_allocator.hpp>
+
+#include "bench_util.hpp"
+
+#include <cstdint>
+#include <vector>
+
+/*
+ * Compares construction and destruction of allocated_values through
+ * std::pmr::polymorphic_allocator (two virtual calls per value) with
+ * tcb::pmr::typed_resource_allocator (direct calls), on the same resource.
+ *
+ * Usage: bench_typed_allocator [live objects] [iterations]
+ */
+
+namespace {
+
+using pool_t = tcb::pmr::unsynchronized_object_pool_resource;
+
+template <typename Value, typename Alloc>
+double churn(const Alloc& alloc, std::size_t live, std::size_t iters)
+{
+    std::vector<Value> values;
+    values.reserve(live);
+    for (std::size_t i = 0; i < live; i++) {
+        values.emplace_back(static_cast<int>(i), alloc);
+    }
+
+    std::uint32_t state = 12345;
+    return bench::time_ms([&] {
+        for (std::size_t i = 0; i < iters; i++) {
+            state = state * 1664525u + 1013904223u;
+            values[state % live] = Value{static_cast<int>(i), alloc};
+        }
+        bench::do_not_optimize(values.front());
+    });
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    const auto live = bench::arg_or(argc, argv, 1, 10000);
+    const auto iters = bench::arg_or(argc, argv, 2, 10000000);
+
+    {
+        pool_t pool;
+        const auto ms = churn<tcb::pmr::allocated_value<int>>(
+                std::pmr::polymorphic_allocator<int>{&pool}, live, iters);
+        bench::report("pmr::allocated_value<int>", ms, iters);
+    }
+    {
+        pool_t pool;
+        const auto ms = churn<tcb::pmr::typed_allocated_value<int, pool_t>>(
+                tcb::pmr::typed_resource_allocator<int, pool_t>{&pool}, live, iters);
+        bench::report("pmr::typed_allocated_value<int, pool>", ms, iters);
+    }
+}
@@ -0,0 +1,64 @@
+
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+namespace bench {
+
+// Runs f once and returns the elapsed wall-clock time in milliseconds
+template <typename F>
+double time_ms(F&& f)
+{
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+inline void report(const char* name, double ms, double ops)
+{
+    std::printf("%-48s %10.2f ms %10.2f ns/op\n", name, ms, ms * 1e6 / ops);
+}
+
+// Reads an optional element count from the command line
+inline std::size_t arg_or(int argc, char** argv, int index, std::size_t def)
+{
+    return argc > index ? std::strtoull(argv[index], nullptr, 10) : def;
+}
+
+// Resident set size in MiB, from /proc/self/statm, or -1 if unavailable
+inline double rss_mib()
+{
+#if defined(__linux__)
+    long pages = 0;
+    long resident = 0;
+    if (std::FILE* f = std::fopen("/proc/self/statm", "r")) {
+        const int n = std::fscanf(f, "%ld %ld", &pages, &resident);
+        std::fclose(f);
+        if (n == 2) {
+            return double(resident) * double(::sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+        }
+    }
+#endif
+    return -1.0;
+}
+
+// Prevents the optimiser from discarding a computed value
+template <typename T>
+void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+}
@@ -0,0 +1,49 @@
+
+#include <tcb/allocated_value.hpp>
+
+#include <utility>
+
+/*
+ * Instantiates allocated_value, and its constructors, assignment operators
+ * and emplace(), for 500 distinct value types. This file is not run: it is
+ * compiled by bench_compile_time, which reports how long that takes.
+ */
+
+namespace {
+
+template <int N>
+struct value {
+    value() = default;
+    explicit value(int i) : i(i) {}
+
+    int i = N;
+};
+
+template <int N>
+int use()
+{
+    using av = tcb::allocated_value<value<N>>;
+
+    av a;
+    av b(tcb::in_place, N);
+    av c(value<N>{});
+    av d(std::allocator<value<N>>{});
+    av e(std::allocator_arg, std::allocator<value<N>>{}, tcb::in_place, N);
+    a.emplace(N + 1);
+    a = b;
+    c = std::move(d);
+    return a->i + b->i + c->i + e->i;
+}
+
+template <int... Ns>
+int use_all(std::integer_sequence<int, Ns...>)
+{
+    return (use<Ns>() + ...);
+}
+
+}
+
+int instantiate_all()
+{
+    return use_all(std::make_integer_sequence<int, 500>{});
+}
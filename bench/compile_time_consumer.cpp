@@ -0,0 +1,19 @@
+
+// A translation unit which uses allocated_value lightly, as most users of
+// the header do. It is built twice, once including the header and once
+// importing the module, to compare the cost of each; see README.md.
+
+#ifdef BENCH_USE_MODULE
+#include <string>
+import tcb.allocated_value;
+#else
+#include <tcb/allocated_value.hpp>
+#include <string>
+#endif
+
+int consume()
+{
+    auto a = tcb::make_allocated_value<std::string>("hello");
+    tcb::allocated_value<int> b(42);
+    return static_cast<int>(a->size()) + *b;
+}
@@ -2,8 +2,43 @@
 #ifndef TCB_ALLOCATED_HPP_INCLUDED
 #define TCB_ALLOCATED_HPP_INCLUDED
 
+#include <cstdlib>
+#include <functional>
 #include <memory>
+#include <new>
+#include <string>
 #include <type_traits>
+#include <utility>
+
+#if defined(__cpp_impl_three_way_comparison) && (__cpp_impl_three_way_comparison >= 201907L)
+# if __has_include(<compare>)
+#   include <compare>
+#   include <concepts>
+# endif
+#endif
+
+#if defined(__cpp_lib_three_way_comparison) && (__cpp_lib_three_way_comparison >= 201907L) && \
+    defined(__cpp_lib_concepts)
+#define TCB_ALLOCATED_VALUE_HAS_THREE_WAY_COMPARISON
+#endif
+
+// With C++20 constexpr allocation, an allocated_value using std::allocator
+// may be created and destroyed during constant evaluation
+#if defined(__cpp_constexpr_dynamic_alloc) && (__cpp_constexpr_dynamic_alloc >= 201907L) && \
+    defined(__cpp_lib_constexpr_dynamic_alloc) && (__cpp_lib_constexpr_dynamic_alloc >= 201907L)
+#define TCB_CONSTEXPR20 constexpr
+#define TCB_ALLOCATED_VALUE_HAS_CONSTEXPR
+#else
+#define TCB_CONSTEXPR20
+#endif
+
+// Constrain members with requires-clauses rather than enable_if where
+// possible, which is cheaper to compile. Define
+// TCB_ALLOCATED_VALUE_NO_CONCEPTS to always use the C++11 code path.
+#if !defined(TCB_ALLOCATED_VALUE_NO_CONCEPTS) && \
+    defined(__cpp_concepts) && (__cpp_concepts >= 201907L)
+#define TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+#endif
 
 namespace tcb {
 
@@ -43,16 +78,47 @@ constexpr in_place_t in_place{};
 
 namespace detail {
 
+// Used by the allocators and arenas in this library to report exhaustion
+[[noreturn]] inline void throw_bad_alloc()
+{
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+    std::abort();
+#else
+    throw std::bad_alloc{};
+#endif
+}
+
+// Used by allocators to report a request too large to represent
+[[noreturn]] inline void throw_bad_array_new_length()
+{
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+    std::abort();
+#else
+    throw std::bad_array_new_length{};
+#endif
+}
+
 template <typename T>
 struct ebo_store : private T {
     ebo_store() = default;
-    ebo_store(const T& t) : T(t) {}
-    ebo_store(T&& t) : T{std::move(t)} {}
+    TCB_CONSTEXPR20 ebo_store(const T& t) : T(t) {}
+    TCB_CONSTEXPR20 ebo_store(T&& t) : T{std::move(t)} {}
 
-    T& get_ebo_value() { return *this; }
-    const T& get_ebo_value() const { return *this; }
+    TCB_CONSTEXPR20 T& get_ebo_value() { return *this; }
+    TCB_CONSTEXPR20 const T& get_ebo_value() const { return *this; }
 };
 
+// Allocators may use "fancy" pointer types, but construct() and destroy()
+// take raw pointers
+template <typename T>
+constexpr T* to_address(T* p) noexcept { return p; }
+
+template <typename Ptr>
+TCB_CONSTEXPR20 auto to_address(const Ptr& p) noexcept -> decltype(std::addressof(*p))
+{
+    return std::addressof(*p);
+}
+
 }
 
 template <typename T, typename Alloc = std::allocator<T>>
@@ -97,10 +163,15 @@ public:
      * This constructor is available only if both the value_type and
      * allocator_type are DefaultConstructible.
      */
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+    TCB_CONSTEXPR20 explicit allocated_value()
+        requires std::is_default_constructible_v<Alloc>
+#else
     template <typename V = value_type, typename A = allocator_type,
               typename = typename std::enable_if<
                       std::is_default_constructible<A>::value>::type>
-    explicit allocated_value()
+    TCB_CONSTEXPR20 explicit allocated_value()
+#endif
     {
         do_construct();
     }
@@ -113,10 +184,15 @@ public:
      *
      * This constructor is available only if the value_type is DefaultConstructible.
      */
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+    TCB_CONSTEXPR20 explicit allocated_value(const allocator_type& allocator)
+        requires std::is_default_constructible_v<T>
+#else
     template <typename V = value_type,
               typename = typename std::enable_if<
                     std::is_default_constructible<V>::value>::type>
-    explicit allocated_value(const allocator_type& allocator)
+    TCB_CONSTEXPR20 explicit allocated_value(const allocator_type& allocator)
+#endif
         : ebo_base{allocator}
     {
         do_construct();
@@ -129,10 +205,15 @@ public:
      *
      * This constructor is available only if the allocator_type is DefaultConstructible.
      */
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+    TCB_CONSTEXPR20 explicit allocated_value(const value_type& value)
+        requires std::is_default_constructible_v<Alloc>
+#else
     template <typename A = allocator_type,
               typename = typename std::enable_if<
                     std::is_default_constructible<A>::value>::type>
-    explicit allocated_value(const value_type& value)
+    TCB_CONSTEXPR20 explicit allocated_value(const value_type& value)
+#endif
     {
         do_construct(value);
     }
@@ -144,10 +225,15 @@ public:
      *
      * This constructor is available only if the allocator_type is DefaultConstructible.
      */
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+    TCB_CONSTEXPR20 explicit allocated_value(value_type&& value)
+        requires std::is_default_constructible_v<Alloc>
+#else
     template <typename A = allocator_type,
               typename = typename std::enable_if<
                     std::is_default_constructible<A>::value>::type>
-    explicit allocated_value(value_type&& value)
+    TCB_CONSTEXPR20 explicit allocated_value(value_type&& value)
+#endif
     {
         do_construct(std::move(value));
     }
@@ -158,7 +244,7 @@ public:
      * Constructs an allocated_value holding a copy of value, using the
      * supplied allocator.
      */
-    allocated_value(const value_type& value, const allocator_type& allocator)
+    TCB_CONSTEXPR20 allocated_value(const value_type& value, const allocator_type& allocator)
         : ebo_base{allocator}
     {
         do_construct(value);
@@ -170,7 +256,7 @@ public:
      * Constructs an allocated_value holding the moved value, using the
      * supplied allocator.
      */
-    allocated_value(value_type&& value, const allocator_type& allocator)
+    TCB_CONSTEXPR20 allocated_value(value_type&& value, const allocator_type& allocator)
         : ebo_base{allocator}
     {
         do_construct(std::move(value));
@@ -185,11 +271,17 @@ public:
      * This constructor is available only if the value_type is construcible
      * from the given arguments, and the allocator_type is DefaultConstructible.
      */
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+    template <typename... Args>
+        requires std::is_constructible_v<T, Args...> &&
+                 std::is_default_constructible_v<Alloc>
+#else
     template <typename... Args, typename A = allocator_type,
               typename = typename std::enable_if<
                     std::is_constructible<T, Args...>::value &&
                     std::is_default_constructible<A>::value>::type>
-    explicit allocated_value(in_place_t, Args&&... args)
+#endif
+    TCB_CONSTEXPR20 explicit allocated_value(in_place_t, Args&&... args)
     {
         do_construct(std::forward<Args>(args)...);
     }
@@ -203,10 +295,15 @@ public:
      * This constructor is available only if the value_type is constructible
      * from the given arguments.
      */
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+    template <typename... Args>
+        requires std::is_constructible_v<T, Args...>
+#else
     template <typename... Args,
               typename = typename std::enable_if<
                     std::is_constructible<T, Args...>::value>::type>
-    allocated_value(std::allocator_arg_t, const allocator_type& allocator,
+#endif
+    TCB_CONSTEXPR20 allocated_value(std::allocator_arg_t, const allocator_type& allocator,
                     in_place_t, Args&&... args)
         : ebo_base{allocator}
     {
@@ -222,7 +319,7 @@ public:
      *
      * std::allocator_traits::select_on_copy_construction(other.get_allocator())
      */
-    allocated_value(const allocated_value& other)
+    TCB_CONSTEXPR20 allocated_value(const allocated_value& other)
         : allocated_value(other,
                           traits::select_on_container_copy_construction(other.get_allocator()))
     {}
@@ -233,7 +330,7 @@ public:
      * Constructs a new allocated_value holding a copy of other's value, using
      * the supplied allocator.
      */
-    allocated_value(const allocated_value& other, const allocator_type& allocator)
+    TCB_CONSTEXPR20 allocated_value(const allocated_value& other, const allocator_type& allocator)
             : ebo_base{allocator}
     {
         do_construct(other.get());
@@ -250,7 +347,7 @@ public:
      *
      * This constructor will not throw.
      */
-    allocated_value(allocated_value&& other) noexcept
+    TCB_CONSTEXPR20 allocated_value(allocated_value&& other) noexcept
         : ebo_base(std::move(other)),
           ptr(std::move(other.ptr))
     {
@@ -276,7 +373,7 @@ public:
      * This constructor will not throw if the supplied allocator compares equal
      * to other.get_allocator().
      */
-    allocated_value(allocated_value&& other, const allocator_type& allocator)
+    TCB_CONSTEXPR20 allocated_value(allocated_value&& other, const allocator_type& allocator)
         noexcept(is_always_equal_v)
         : ebo_base{allocator}
     {
@@ -297,7 +394,7 @@ public:
      *
      * If an exception is thrown during allocation or assignment, *this is unchanged.
      */
-    allocated_value& operator=(const allocated_value& other)
+    TCB_CONSTEXPR20 allocated_value& operator=(const allocated_value& other)
         noexcept(!is_pocca_t::value && std::is_nothrow_copy_assignable<value_type>::value)
     {
         if (this != std::addressof(other)) {
@@ -313,7 +410,7 @@ public:
      *
      * If an exception is thrown during assignment, *this is unchanged.
      */
-    allocated_value& operator=(const value_type& value)
+    TCB_CONSTEXPR20 allocated_value& operator=(const value_type& value)
     //    noexcept(std::is_nothrow_copy_assignable<value_type>::value &&
     //             std::is_nothrow_move_constructible<value_type>::value)
     {
@@ -328,14 +425,14 @@ public:
     }
 
     // Move assignment
-    allocated_value& operator=(allocated_value&& other)
+    TCB_CONSTEXPR20 allocated_value& operator=(allocated_value&& other)
         noexcept(is_pocma_t::value || is_always_equal_v)
     {
         do_move_assign(is_pocma_t{}, std::move(other));
         return *this;
     }
 
-    allocated_value& operator=(value_type&& value)
+    TCB_CONSTEXPR20 allocated_value& operator=(value_type&& value)
         noexcept(std::is_nothrow_move_assignable<value_type>::value)
     {
         get() = std::move(value);
@@ -347,7 +444,7 @@ public:
      *
      * Releases all resources held by this object.
      */
-    ~allocated_value()
+    TCB_CONSTEXPR20 ~allocated_value()
     {
         noexcept_release();
     }
@@ -355,7 +452,7 @@ public:
     /**
      * Swaps the contained values of *this and other.
      */
-    void swap(allocated_value& other) noexcept
+    TCB_CONSTEXPR20 void swap(allocated_value& other) noexcept
     {
         do_swap(is_pocs_t{}, other);
     }
@@ -366,17 +463,22 @@ public:
      *
      * This function is available only if value_type is constructible from Args.
      */
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONCEPTS
+    template <typename... Args>
+        requires std::is_constructible_v<T, Args...>
+#else
     template <typename... Args,
               typename = typename
                   std::enable_if<std::is_constructible<T, Args...>::value>::type>
-    void emplace(Args&&... args)
+#endif
+    TCB_CONSTEXPR20 void emplace(Args&&... args)
     {
         // If constructing the new value fails, move the old value back in place.
         auto temp = std::move(get());
         auto a = get_allocator();
         TRY {
-            traits::destroy(a, ptr);
-            traits::construct(a, ptr, std::forward<Args>(args)...);
+            traits::destroy(a, detail::to_address(ptr));
+            traits::construct(a, detail::to_address(ptr), std::forward<Args>(args)...);
         } CATCH(...) {
             get() = std::move(temp);
         }
@@ -384,38 +486,38 @@ public:
     }
 
     /// Access the contained value.
-    reference get() noexcept { return *ptr; }
+    TCB_CONSTEXPR20 reference get() noexcept { return *ptr; }
     /// @overload
-    const_reference get() const noexcept { return *ptr; }
+    TCB_CONSTEXPR20 const_reference get() const noexcept { return *ptr; }
 
     /// Returns a copy of the contained allocator.
-    allocator_type get_allocator() const noexcept { return as_allocator(); }
+    TCB_CONSTEXPR20 allocator_type get_allocator() const noexcept { return as_allocator(); }
 
     /// Returns get().
-    reference operator*() noexcept { return get(); }
+    TCB_CONSTEXPR20 reference operator*() noexcept { return get(); }
     /// @overload
-    const_reference operator*() const noexcept { return get(); }
+    TCB_CONSTEXPR20 const_reference operator*() const noexcept { return get(); }
 
     /// Member access.
-    pointer operator->() noexcept { return ptr; }
+    TCB_CONSTEXPR20 pointer operator->() noexcept { return ptr; }
     /// @overload
-    const_pointer operator->() const noexcept { return ptr; }
+    TCB_CONSTEXPR20 const_pointer operator->() const noexcept { return ptr; }
 
 private:
     template <typename... Args>
-    void do_construct(Args&&... args)
+    TCB_CONSTEXPR20 void do_construct(Args&&... args)
     {
         auto a = get_allocator();
         ptr = traits::allocate(a, 1);
         TRY {
-            traits::construct(a, ptr, std::forward<Args>(args)...);
+            traits::construct(a, detail::to_address(ptr), std::forward<Args>(args)...);
         } CATCH (...) {
             traits::deallocate(a, ptr, 1);
             THROW;
         }
     }
 
-    void do_copy_assign(std::true_type /*is_pocca*/, const allocated_value& other)
+    TCB_CONSTEXPR20 void do_copy_assign(std::true_type /*is_pocca*/, const allocated_value& other)
     {
         // Keep a copy of our old contents around for safekeeping
         auto temp = std::move(*this);
@@ -443,13 +545,13 @@ private:
         }
     }
 
-    void do_copy_assign(std::false_type /*is_pocca*/, const allocated_value& other)
+    TCB_CONSTEXPR20 void do_copy_assign(std::false_type /*is_pocca*/, const allocated_value& other)
         noexcept(std::is_nothrow_copy_assignable<value_type>::value)
     {
         get() = other.get();
     }
 
-    void do_move_assign(std::true_type /*is_pocma*/, allocated_value&& other) noexcept
+    TCB_CONSTEXPR20 void do_move_assign(std::true_type /*is_pocma*/, allocated_value&& other) noexcept
     {
         // Destroy what we have, then steal the contents of other
         noexcept_release();
@@ -458,7 +560,7 @@ private:
         other.ptr = nullptr;
     }
 
-    void do_move_assign(std::false_type /*is_pocma*/, allocated_value&& other)
+    TCB_CONSTEXPR20 void do_move_assign(std::false_type /*is_pocma*/, allocated_value&& other)
         noexcept(is_always_equal_v)
     {
         if (get_allocator() == other.get_allocator()) {
@@ -472,7 +574,7 @@ private:
         }
     }
 
-    void do_swap(std::true_type /*is_pocs*/, allocated_value& other) noexcept
+    TCB_CONSTEXPR20 void do_swap(std::true_type /*is_pocs*/, allocated_value& other) noexcept
     {
         // Need to swap both allocator and pointer
         using std::swap;
@@ -480,21 +582,21 @@ private:
         swap(ptr, other.ptr);
     }
 
-    void do_swap(std::false_type /*is_pocs*/, allocated_value& other) noexcept
+    TCB_CONSTEXPR20 void do_swap(std::false_type /*is_pocs*/, allocated_value& other) noexcept
     {
         // Only need to swap pointer values
         using std::swap;
         swap(ptr, other.ptr);
     }
 
-    void noexcept_release() noexcept
+    TCB_CONSTEXPR20 void noexcept_release() noexcept
     {
         // This is horrible. We call destroy then deallocate,
         // swallowing all exceptions that may occur
         auto a = get_allocator();
         if (ptr) {
             TRY {
-                traits::destroy(a, ptr);
+                traits::destroy(a, detail::to_address(ptr));
             } CATCH (...) {}
             TRY {
                 traits::deallocate(a, ptr, 1);
@@ -502,14 +604,14 @@ private:
         }
     }
 
-    allocator_type& as_allocator() { return this->get_ebo_value(); }
-    const allocator_type& as_allocator() const { return this->get_ebo_value(); }
+    TCB_CONSTEXPR20 allocator_type& as_allocator() { return this->get_ebo_value(); }
+    TCB_CONSTEXPR20 const allocator_type& as_allocator() const { return this->get_ebo_value(); }
 
     pointer ptr = nullptr;
 };
 
 template <typename T, typename Alloc = std::allocator<T>, typename... Args>
-allocated_value<T, Alloc>
+TCB_CONSTEXPR20 allocated_value<T, Alloc>
 make_allocated_value(Args&&... args)
 {
     return allocated_value<T, Alloc>(in_place, std::forward<Args>(args)...);
@@ -517,7 +619,7 @@ make_allocated_value(Args&&... args)
 
 /* FIXME: The naming is consistent with allocate_shared(), but... urgh. */
 template <typename T, typename Alloc, typename... Args>
-allocated_value<T, Alloc>
+TCB_CONSTEXPR20 allocated_value<T, Alloc>
 allocate_allocated_value(const Alloc& allocator, Args&&... args)
 {
     return allocated_value<T, Alloc>(std::allocator_arg, allocator,
@@ -526,127 +628,297 @@ allocate_allocated_value(const Alloc& allocator, Args&&... args)
 
 // Non-member swap
 template <typename T, typename A>
-void swap(allocated_value<T, A>& first, allocated_value<T, A>& second)
+TCB_CONSTEXPR20 void swap(allocated_value<T, A>& first, allocated_value<T, A>& second)
 {
     first.swap(second);
 }
 
+/**
+ * True for types whose values always compare equal to themselves, letting
+ * comparisons between two allocated_values referring to the same object
+ * return without comparing the values.
+ *
+ * This holds by default for integral, enumeration and std::basic_string
+ * types. Specialise it as std::true_type for other such types; it is not
+ * assumed in general, since it does not hold for types which contain
+ * floating-point members, for example, which may be NaN.
+ */
+template <typename T>
+struct is_reflexively_comparable
+    : std::integral_constant<bool, std::is_integral<T>::value || std::is_enum<T>::value> {};
+
+template <typename CharT, typename Traits, typename Alloc>
+struct is_reflexively_comparable<std::basic_string<CharT, Traits, Alloc>> : std::true_type {};
+
+namespace detail {
+
+// Two handles referring to the same object hold equal values, if T opts in
+template <typename T>
+TCB_CONSTEXPR20 bool same_object(const T& lhs, const T& rhs) noexcept
+{
+    return is_reflexively_comparable<T>::value &&
+           std::addressof(lhs) == std::addressof(rhs);
+}
+
+}
+
 // Comparison between two allocated_values (possibly with different allocators)
 template <typename T, typename A, typename B>
-bool operator==(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
+TCB_CONSTEXPR20 bool operator==(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
 {
-    return lhs.get() == rhs.get();
+    return detail::same_object(lhs.get(), rhs.get()) || lhs.get() == rhs.get();
 }
 
 template <typename T, typename A, typename B>
-bool operator!=(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
+TCB_CONSTEXPR20 bool operator!=(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
 {
-    return lhs.get() != rhs.get();
+    return !detail::same_object(lhs.get(), rhs.get()) && lhs.get() != rhs.get();
 }
 
-template <typename T, typename A, typename B>
-bool operator<(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
+// Comparison between T and allocated_value<T>
+template <typename T, typename A>
+TCB_CONSTEXPR20 bool operator==(const T& lhs, const allocated_value<T, A>& rhs)
+{
+    return lhs == rhs.get();
+}
+
+template <typename T, typename A>
+TCB_CONSTEXPR20 bool operator!=(const T& lhs, const allocated_value<T, A>& rhs)
 {
-    return lhs.get() < rhs.get();
+    return lhs != rhs.get();
 }
 
+// Comparison between allocated_value<T> and T
+template <typename T, typename A>
+TCB_CONSTEXPR20 bool operator==(const allocated_value<T, A>& lhs, const T& rhs)
+{
+    return lhs.get() == rhs;
+}
+
+template <typename T, typename A>
+TCB_CONSTEXPR20 bool operator!=(const allocated_value<T, A>& lhs, const T& rhs)
+{
+    return lhs.get() != rhs;
+}
+
+#ifdef TCB_ALLOCATED_VALUE_HAS_THREE_WAY_COMPARISON
+
+namespace detail {
+
+// The exposition-only synth-three-way from the standard library: uses
+// operator<=> where T provides it, and otherwise synthesises a weak
+// ordering from operator<
+struct synth_three_way {
+    template <typename T, typename U>
+    constexpr auto operator()(const T& t, const U& u) const
+        requires requires {
+            { t < u } -> std::convertible_to<bool>;
+            { u < t } -> std::convertible_to<bool>;
+        }
+    {
+        if constexpr (std::three_way_comparable_with<T, U>) {
+            return t <=> u;
+        } else {
+            if (t < u) {
+                return std::weak_ordering::less;
+            }
+            if (u < t) {
+                return std::weak_ordering::greater;
+            }
+            return std::weak_ordering::equivalent;
+        }
+    }
+};
+
+template <typename T, typename U = T>
+using synth_three_way_result =
+        decltype(synth_three_way{}(std::declval<const T&>(), std::declval<const U&>()));
+
+}
+
+/*
+ * With C++20 three-way comparison, <, <=, > and >= are all rewritten in
+ * terms of a single operator<=>, which (for types which provide their own
+ * operator<=>) compares the contained values only once. The T <=>
+ * allocated_value<T> form is synthesised from the reversed overload.
+ */
 template <typename T, typename A, typename B>
-bool operator<=(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
+TCB_CONSTEXPR20 detail::synth_three_way_result<T>
+operator<=>(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
+{
+    if (detail::same_object(lhs.get(), rhs.get())) {
+        return std::strong_ordering::equal;
+    }
+    return detail::synth_three_way{}(lhs.get(), rhs.get());
+}
+
+template <typename T, typename A>
+TCB_CONSTEXPR20 detail::synth_three_way_result<T>
+operator<=>(const allocated_value<T, A>& lhs, const T& rhs)
 {
-    return lhs.get() <= rhs.get();
+    return detail::synth_three_way{}(lhs.get(), rhs);
 }
 
+#else
+
 template <typename T, typename A, typename B>
-bool operator>(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
+TCB_CONSTEXPR20 bool operator<(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
 {
-    return lhs.get() > rhs.get();
+    return !detail::same_object(lhs.get(), rhs.get()) && lhs.get() < rhs.get();
 }
 
 template <typename T, typename A, typename B>
-bool operator>=(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
+TCB_CONSTEXPR20 bool operator<=(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
 {
-    return lhs.get() >= rhs.get();
+    return detail::same_object(lhs.get(), rhs.get()) || lhs.get() <= rhs.get();
 }
 
-// Comparison between T and allocated_value<T>
-template <typename T, typename A>
-bool operator==(const T& lhs, const allocated_value<T, A>& rhs)
+template <typename T, typename A, typename B>
+TCB_CONSTEXPR20 bool operator>(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
 {
-    return lhs == rhs.get();
+    return !detail::same_object(lhs.get(), rhs.get()) && lhs.get() > rhs.get();
 }
 
-template <typename T, typename A>
-bool operator!=(const T& lhs, const allocated_value<T, A>& rhs)
+template <typename T, typename A, typename B>
+TCB_CONSTEXPR20 bool operator>=(const allocated_value<T, A>& lhs, const allocated_value<T, B>& rhs)
 {
-    return lhs != rhs.get();
+    return detail::same_object(lhs.get(), rhs.get()) || lhs.get() >= rhs.get();
 }
 
 template <typename T, typename A>
-bool operator<(const T& lhs, const allocated_value<T, A>& rhs)
+TCB_CONSTEXPR20 bool operator<(const T& lhs, const allocated_value<T, A>& rhs)
 {
     return lhs < rhs.get();
 }
 
 template <typename T, typename A>
-bool operator<=(const T& lhs, const allocated_value<T, A>& rhs)
+TCB_CONSTEXPR20 bool operator<=(const T& lhs, const allocated_value<T, A>& rhs)
 {
     return lhs <= rhs.get();
 }
 
 template <typename T, typename A>
-bool operator>(const T& lhs, const allocated_value<T, A>& rhs)
+TCB_CONSTEXPR20 bool operator>(const T& lhs, const allocated_value<T, A>& rhs)
 {
     return lhs > rhs.get();
 }
 
 template <typename T, typename A>
-bool operator>=(const T& lhs, const allocated_value<T, A>& rhs)
+TCB_CONSTEXPR20 bool operator>=(const T& lhs, const allocated_value<T, A>& rhs)
 {
     return lhs >= rhs.get();
 }
 
-// Comparison between allocated_value<T> and T
-
 template <typename T, typename A>
-bool operator==(const allocated_value<T, A>& lhs, const T& rhs)
+TCB_CONSTEXPR20 bool operator<(const allocated_value<T, A>& lhs, const T& rhs)
 {
-    return lhs.get() == rhs;
+    return lhs.get() < rhs;
 }
 
 template <typename T, typename A>
-bool operator!=(const allocated_value<T, A>& lhs, const T& rhs)
+TCB_CONSTEXPR20 bool operator<=(const allocated_value<T, A>& lhs, const T& rhs)
 {
-    return lhs.get() != rhs;
+    return lhs.get() <= rhs;
 }
 
 template <typename T, typename A>
-bool operator<(const allocated_value<T, A>& lhs, const T& rhs)
+TCB_CONSTEXPR20 bool operator>(const allocated_value<T, A>& lhs, const T& rhs)
 {
-    return lhs.get() < rhs;
+    return lhs.get() > rhs;
 }
 
 template <typename T, typename A>
-bool operator<=(const allocated_value<T, A>& lhs, const T& rhs)
+TCB_CONSTEXPR20 bool operator>=(const allocated_value<T, A>& lhs, const T& rhs)
 {
-    return lhs.get() <= rhs;
+    return lhs.get() >= rhs;
 }
 
+#endif // TCB_ALLOCATED_VALUE_HAS_THREE_WAY_COMPARISON
+
+namespace detail {
+
+template <typename T>
+TCB_CONSTEXPR20 const T& unwrap(const T& value) noexcept { return value; }
+
 template <typename T, typename A>
-bool operator>(const allocated_value<T, A>& lhs, const T& rhs)
-{
-    return lhs.get() > rhs;
+TCB_CONSTEXPR20 const T& unwrap(const allocated_value<T, A>& value) noexcept { return value.get(); }
+
 }
 
+/*
+ * Transparent function objects, which compare and hash allocated_value<T>s
+ * by their contained values, and which accept a T (or anything comparable
+ * with a T) on either side. Using these with std::set or
+ * std::unordered_set allows lookup by T without constructing, and
+ * allocating, a temporary allocated_value.
+ */
+struct allocated_value_less {
+    using is_transparent = void;
+
+    template <typename L, typename R>
+    TCB_CONSTEXPR20 bool operator()(const L& lhs, const R& rhs) const
+    {
+        return detail::unwrap(lhs) < detail::unwrap(rhs);
+    }
+};
+
+struct allocated_value_equal_to {
+    using is_transparent = void;
+
+    template <typename L, typename R>
+    TCB_CONSTEXPR20 bool operator()(const L& lhs, const R& rhs) const
+    {
+        return detail::unwrap(lhs) == detail::unwrap(rhs);
+    }
+};
+
+/// Hash must give equal results for a T and any key type used in lookups.
+template <typename T, typename Hash = std::hash<T>>
+struct allocated_value_hash {
+    using is_transparent = void;
+
+    template <typename U>
+    std::size_t operator()(const U& value) const
+    {
+        return Hash{}(detail::unwrap(value));
+    }
+};
+
+namespace detail {
+
+// Disabled, as std::hash<T> is
+template <typename T, typename A, typename = void>
+struct hash_base {
+    hash_base() = delete;
+    hash_base(const hash_base&) = delete;
+    hash_base& operator=(const hash_base&) = delete;
+};
+
+// Hashes the contained value
 template <typename T, typename A>
-bool operator>=(const allocated_value<T, A>& lhs, const T& rhs)
-{
-    return lhs.get() >= rhs;
+struct hash_base<T, A, decltype(static_cast<void>(
+        std::hash<typename std::remove_const<T>::type>{}(std::declval<const T&>())))> {
+    std::size_t operator()(const allocated_value<T, A>& value) const
+    {
+        return std::hash<typename std::remove_const<T>::type>{}(value.get());
+    }
+};
+
 }
 
 #undef TRY
 #undef CATCH
 #undef THROW
+#undef TCB_CONSTEXPR20
 
 } // namespace tcb
 
+namespace std {
+
+// Enabled only if std::hash<T> is, like std::hash<std::optional<T>>
+template <typename T, typename A>
+struct hash<::tcb::allocated_value<T, A>> : ::tcb::detail::hash_base<T, A> {};
+
+}
+
 #endif
@@ -0,0 +1,182 @@
+
+#ifndef TCB_CACHED_HASH_HPP_INCLUDED
+#define TCB_CACHED_HASH_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace tcb {
+
+/**
+ * A value which remembers its own hash.
+ *
+ * Used as the value_type of an allocated_value, e.g.
+ * allocated_value<cached_hash<std::string>>, this stores the hash in the
+ * allocated block next to the value, so that hashing the allocated_value
+ * (which forwards to std::hash<cached_hash<T>>) computes Hash at most once.
+ *
+ * Read access through value(), operator* and operator-> is const and keeps
+ * the cached hash. Mutable access is only available through
+ * mutable_value(), which discards it.
+ *
+ * Computing the hash concurrently from several threads is safe; mutating
+ * the value concurrently with any other access is not.
+ */
+template <typename T, typename Hash = std::hash<T>>
+class cached_hash {
+public:
+    using value_type = T;
+
+    cached_hash() = default;
+
+    /// Constructs the value from the given argument.
+    template <typename U,
+              typename = typename std::enable_if<
+                    std::is_constructible<T, U&&>::value &&
+                    !std::is_same<typename std::decay<U>::type, cached_hash>::value>::type>
+    cached_hash(U&& u)
+        : value_(std::forward<U>(u))
+    {}
+
+    /// Constructs the value in-place from the given arguments.
+    template <typename... Args>
+    explicit cached_hash(in_place_t, Args&&... args)
+        : value_(std::forward<Args>(args)...)
+    {}
+
+    cached_hash(const cached_hash& other)
+        : value_(other.value_)
+    {
+        copy_cache(other);
+    }
+
+    cached_hash(cached_hash&& other)
+        noexcept(std::is_nothrow_move_constructible<T>::value)
+        : value_(std::move(other.value_))
+    {
+        take_cache(other);
+    }
+
+    cached_hash& operator=(const cached_hash& other)
+    {
+        value_ = other.value_;
+        copy_cache(other);
+        return *this;
+    }
+
+    cached_hash& operator=(cached_hash&& other)
+        noexcept(std::is_nothrow_move_assignable<T>::value)
+    {
+        value_ = std::move(other.value_);
+        take_cache(other);
+        return *this;
+    }
+
+    /// Access the value.
+    const T& value() const noexcept { return value_; }
+    /// @overload
+    const T& operator*() const noexcept { return value_; }
+    /// Member access.
+    const T* operator->() const noexcept { return std::addressof(value_); }
+
+    /// Mutable access to the value. Invalidates the cached hash.
+    T& mutable_value() noexcept
+    {
+        valid_.store(false, std::memory_order_relaxed);
+        return value_;
+    }
+
+    /// Returns Hash{}(value()), computing it if it is not already cached.
+    std::size_t hash() const
+    {
+        if (valid_.load(std::memory_order_acquire)) {
+            return hash_.load(std::memory_order_relaxed);
+        }
+        const std::size_t h = Hash{}(value_);
+        hash_.store(h, std::memory_order_relaxed);
+        valid_.store(true, std::memory_order_release);
+        return h;
+    }
+
+    /// Returns true if the hash has been computed and not since invalidated.
+    bool has_cached_hash() const noexcept
+    {
+        return valid_.load(std::memory_order_acquire);
+    }
+
+    /// Compares cached hashes, if both are available, before the values.
+    friend bool operator==(const cached_hash& lhs, const cached_hash& rhs)
+    {
+        if (lhs.has_cached_hash() && rhs.has_cached_hash() &&
+            lhs.hash_.load(std::memory_order_relaxed) !=
+                rhs.hash_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        return lhs.value_ == rhs.value_;
+    }
+
+    friend bool operator!=(const cached_hash& lhs, const cached_hash& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    friend bool operator<(const cached_hash& lhs, const cached_hash& rhs)
+    {
+        return lhs.value_ < rhs.value_;
+    }
+
+    friend bool operator<=(const cached_hash& lhs, const cached_hash& rhs)
+    {
+        return lhs.value_ <= rhs.value_;
+    }
+
+    friend bool operator>(const cached_hash& lhs, const cached_hash& rhs)
+    {
+        return lhs.value_ > rhs.value_;
+    }
+
+    friend bool operator>=(const cached_hash& lhs, const cached_hash& rhs)
+    {
+        return lhs.value_ >= rhs.value_;
+    }
+
+private:
+    void copy_cache(const cached_hash& other) noexcept
+    {
+        const bool valid = other.valid_.load(std::memory_order_acquire);
+        hash_.store(other.hash_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        valid_.store(valid, std::memory_order_release);
+    }
+
+    // The moved-from value no longer matches the hash it had
+    void take_cache(cached_hash& other) noexcept
+    {
+        copy_cache(other);
+        other.valid_.store(false, std::memory_order_relaxed);
+    }
+
+    T value_{};
+    mutable std::atomic<std::size_t> hash_{0};
+    mutable std::atomic<bool> valid_{false};
+};
+
+}
+
+namespace std {
+
+template <typename T, typename Hash>
+struct hash<::tcb::cached_hash<T, Hash>> {
+    std::size_t operator()(const ::tcb::cached_hash<T, Hash>& value) const
+    {
+        return value.hash();
+    }
+};
+
+}
+
+#endif
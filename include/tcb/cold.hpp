@@ -0,0 +1,523 @@
+
+#ifndef TCB_COLD_HPP_INCLUDED
+#define TCB_COLD_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tcb {
+
+/// Usage figures for a cold_arena.
+struct cold_arena_stats {
+    /// Number of chunks obtained from operator new.
+    std::size_t chunks = 0;
+    /// Bytes of chunk storage, including any still unused.
+    std::size_t reserved_bytes = 0;
+    /// Bytes in pooled blocks handed out by this arena and not yet freed, by
+    /// any thread. Blocks larger than cold_arena::max_block_size are not
+    /// counted.
+    std::size_t live_bytes = 0;
+};
+
+/**
+ * A per-thread arena for rarely-used ("cold") data.
+ *
+ * Small blocks are carved out of 64KiB chunks, so cold data allocated by
+ * one thread ends up packed together, away from the hot objects which
+ * refer to it. Freed blocks are recycled through per-size free lists.
+ * Blocks larger than max_block_size are passed to operator new.
+ *
+ * A block may be freed by any thread. A block freed by a thread other than
+ * the one which allocated it is passed back to the allocating thread's
+ * arena, which returns it to its free lists at its next allocation. If the
+ * allocating thread has exited, the block's chunk is instead released once
+ * every block in it has been freed.
+ *
+ * Each thread's arena is created on first use and destroyed when the
+ * thread exits. Cold data must therefore not be freed by a thread_local
+ * object's destructor after the arena for that thread has been destroyed.
+ */
+class cold_arena {
+    struct free_block {
+        free_block* next;
+        std::size_t size;    // for blocks freed by other threads
+    };
+
+    // Blocks freed by other threads, waiting for the owning arena to take
+    // them back. Shared by the arena and its chunks, so that it lasts as
+    // long as any block which might be freed into it.
+    struct remote_frees {
+        std::mutex mutex;
+        bool owner_alive = true;
+        free_block* head = nullptr;
+        std::atomic<std::size_t> bytes{0};
+    };
+
+    // Placed at the start of each chunk. refs counts the live blocks in the
+    // chunk, including those waiting in remote_frees, plus one while the
+    // owning arena is alive.
+    struct chunk_header {
+        std::atomic<std::size_t> refs;
+        std::atomic<cold_arena*> owner;
+        void* allocation;
+        chunk_header* next;
+        std::shared_ptr<remote_frees> remote;
+    };
+
+public:
+    static constexpr std::size_t chunk_size = 64 * 1024;
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t max_block_size = 1024;
+
+    cold_arena() = default;
+
+    cold_arena(const cold_arena&) = delete;
+    cold_arena& operator=(const cold_arena&) = delete;
+
+    /// Releases the arena's chunks, or leaves them to be released by the
+    /// last thread to free a block in them.
+    ~cold_arena()
+    {
+        // Blocks freed by other threads from now on release their chunks
+        // directly
+        if (remote_) {
+            free_block* b;
+            {
+                std::lock_guard<std::mutex> lock(remote_->mutex);
+                remote_->owner_alive = false;
+                b = remote_->head;
+                remote_->head = nullptr;
+            }
+            while (b) {
+                const auto next = b->next;
+                release(chunk_of(b));
+                b = next;
+            }
+        }
+
+        auto c = chunks_;
+        while (c) {
+            const auto next = c->next;
+            c->owner.store(nullptr, std::memory_order_release);
+            release(c);
+            c = next;
+        }
+    }
+
+    /// Returns the calling thread's arena.
+    static cold_arena& this_thread()
+    {
+        static thread_local cold_arena arena;
+        return arena;
+    }
+
+    /// Allocates bytes bytes, aligned to granularity.
+    void* allocate(std::size_t bytes)
+    {
+        if (bytes > max_block_size) {
+            return ::operator new(bytes);
+        }
+        if (remote_ && remote_->bytes.load(std::memory_order_relaxed) != 0) {
+            take_back_remote_frees();
+        }
+
+        const auto size = block_size(bytes);
+        auto& head = free_lists_[size / granularity - 1];
+        void* p;
+        if (head) {
+            p = head;
+            head = head->next;
+            chunk_of(p)->refs.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            if (!current_ || end_ - top_ < static_cast<std::ptrdiff_t>(size)) {
+                new_chunk();
+            }
+            p = top_;
+            top_ += size;
+            current_->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        live_ += size;
+        return p;
+    }
+
+    /// Returns a block previously obtained from allocate(bytes), from any
+    /// thread's arena.
+    void deallocate(void* p, std::size_t bytes) noexcept
+    {
+        if (bytes > max_block_size) {
+            ::operator delete(p);
+            return;
+        }
+
+        const auto size = block_size(bytes);
+        const auto c = chunk_of(p);
+        if (c->owner.load(std::memory_order_acquire) == this) {
+            push_free(static_cast<free_block*>(p), size);
+            live_ -= size;
+        } else if (return_to_owner(c, static_cast<free_block*>(p), size)) {
+            // The block's reference to its chunk goes with it
+            return;
+        }
+        release(c);
+    }
+
+    /// Returns usage figures for this arena.
+    cold_arena_stats stats() const noexcept
+    {
+        cold_arena_stats s;
+        s.chunks = num_chunks_;
+        s.reserved_bytes = num_chunks_ * chunk_size;
+        s.live_bytes = live_ - (remote_ ? remote_->bytes.load(std::memory_order_relaxed) : 0);
+        return s;
+    }
+
+private:
+    static std::size_t block_size(std::size_t bytes) noexcept
+    {
+        return bytes == 0 ? granularity : (bytes + granularity - 1) / granularity * granularity;
+    }
+
+    static constexpr std::size_t header_size =
+            (sizeof(chunk_header) + granularity - 1) / granularity * granularity;
+
+    // Chunks are aligned to chunk_size, so the header of the chunk
+    // containing any block can be found by masking its address
+    static chunk_header* chunk_of(void* p) noexcept
+    {
+        const auto addr = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<chunk_header*>(addr & ~std::uintptr_t(chunk_size - 1));
+    }
+
+    static void release(chunk_header* c) noexcept
+    {
+        if (c->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            void* allocation = c->allocation;
+            c->~chunk_header();
+            ::operator delete(allocation);
+        }
+    }
+
+    void push_free(free_block* b, std::size_t size) noexcept
+    {
+        auto& head = free_lists_[size / granularity - 1];
+        b->next = head;
+        head = b;
+    }
+
+    // Called on a thread other than the owner's. Returns false if the
+    // owning arena has been destroyed.
+    static bool return_to_owner(chunk_header* c, free_block* b, std::size_t size) noexcept
+    {
+        auto& r = *c->remote;
+        std::lock_guard<std::mutex> lock(r.mutex);
+        if (!r.owner_alive) {
+            return false;
+        }
+        b->next = r.head;
+        b->size = size;
+        r.head = b;
+        r.bytes.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+
+    void take_back_remote_frees() noexcept
+    {
+        free_block* b;
+        {
+            std::lock_guard<std::mutex> lock(remote_->mutex);
+            b = remote_->head;
+            remote_->head = nullptr;
+        }
+        while (b) {
+            const auto next = b->next;
+            const auto size = b->size;
+            push_free(b, size);
+            live_ -= size;
+            remote_->bytes.fetch_sub(size, std::memory_order_relaxed);
+            // Never the last reference, which the arena holds
+            release(chunk_of(b));
+            b = next;
+        }
+    }
+
+    void new_chunk()
+    {
+        if (!remote_) {
+            remote_ = std::make_shared<remote_frees>();
+        }
+
+        // Over-allocate so that the chunk can be aligned to its own size.
+        // The unused part is never touched, so mostly costs address space.
+        void* allocation = ::operator new(2 * chunk_size);
+        const auto raw = reinterpret_cast<std::uintptr_t>(allocation);
+        const auto aligned = (raw + chunk_size - 1) & ~std::uintptr_t(chunk_size - 1);
+
+        auto c = ::new (reinterpret_cast<void*>(aligned)) chunk_header;
+        c->refs.store(1, std::memory_order_relaxed);
+        c->owner.store(this, std::memory_order_relaxed);
+        c->allocation = allocation;
+        c->remote = remote_;
+        c->next = chunks_;
+        chunks_ = c;
+        ++num_chunks_;
+
+        current_ = c;
+        top_ = reinterpret_cast<char*>(c) + header_size;
+        end_ = reinterpret_cast<char*>(c) + chunk_size;
+    }
+
+    chunk_header* chunks_ = nullptr;
+    chunk_header* current_ = nullptr;
+    char* top_ = nullptr;
+    char* end_ = nullptr;
+    std::size_t num_chunks_ = 0;
+    std::size_t live_ = 0;
+    free_block* free_lists_[max_block_size / granularity] = {};
+    std::shared_ptr<remote_frees> remote_;
+};
+
+/**
+ * A stateless allocator which obtains memory from the calling thread's
+ * cold_arena.
+ */
+template <typename T>
+class cold_allocator {
+    static_assert(alignof(T) <= cold_arena::granularity,
+                  "cold_allocator does not support over-aligned types");
+
+public:
+    using value_type = T;
+    using is_always_equal = std::true_type;
+
+    cold_allocator() = default;
+
+    template <typename U>
+    cold_allocator(const cold_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+            detail::throw_bad_alloc();
+        }
+        return static_cast<T*>(cold_arena::this_thread().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        cold_arena::this_thread().deallocate(p, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const cold_allocator<T>&, const cold_allocator<U>&) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const cold_allocator<T>&, const cold_allocator<U>&) noexcept
+{
+    return false;
+}
+
+/**
+ * A lazily-allocated member, for moving rarely-used fields out of a hot
+ * struct.
+ *
+ * With the default allocator a cold<T> is the size of a pointer. It
+ * starts out empty, and its T is only allocated -- from the thread's
+ * cold_arena by default -- when it is first accessed through a non-const
+ * member. Until then, const access returns a shared, value-initialised T,
+ * so reading cold data which was never written costs no allocation either.
+ *
+ * Like allocated_value, cold<T> has value semantics: copying a cold<T>
+ * copies its value, if it has one.
+ *
+ * hot_size() and cold_size() give the bytes which a cold<T> member adds
+ * to its enclosing struct and to the cold arena respectively. Together with
+ * cold_arena::stats(), these measure the effect of splitting a struct.
+ */
+template <typename T, typename Alloc = cold_allocator<T>>
+class cold : private detail::ebo_store<Alloc> {
+    using traits = std::allocator_traits<Alloc>;
+    using ebo_base = detail::ebo_store<Alloc>;
+
+public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using pointer = typename traits::pointer;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+    static_assert(std::is_same<typename traits::value_type, T>::value,
+                  "Alloc::value_type must be T");
+
+    /// Constructs an empty cold<T>. Does not allocate.
+    cold() = default;
+
+    /// Constructs an empty cold<T> which will use the supplied allocator.
+    explicit cold(const allocator_type& allocator)
+        : ebo_base{allocator}
+    {}
+
+    /// Constructs a cold<T> holding the given value.
+    template <typename... Args>
+    explicit cold(in_place_t, Args&&... args)
+    {
+        do_construct(std::forward<Args>(args)...);
+    }
+
+    /// Copies other's value, if it has one.
+    cold(const cold& other)
+        : ebo_base{traits::select_on_container_copy_construction(other.get_allocator())}
+    {
+        if (other.ptr) {
+            do_construct(*other.ptr);
+        }
+    }
+
+    cold(cold&& other) noexcept
+        : ebo_base(std::move(other)),
+          ptr(other.ptr)
+    {
+        other.ptr = nullptr;
+    }
+
+    /// Assigns other's value, or the default value if other is empty.
+    cold& operator=(const cold& other)
+    {
+        if (this != std::addressof(other)) {
+            if (other.ptr) {
+                get() = *other.ptr;
+            } else {
+                reset();
+            }
+        }
+        return *this;
+    }
+
+    cold& operator=(cold&& other) noexcept
+    {
+        static_assert(traits::is_always_equal::value,
+                      "cold<T> move assignment requires an always-equal allocator");
+        if (this != std::addressof(other)) {
+            reset();
+            ptr = other.ptr;
+            other.ptr = nullptr;
+        }
+        return *this;
+    }
+
+    /// Assigns value, allocating if necessary.
+    cold& operator=(const value_type& value)
+    {
+        get() = value;
+        return *this;
+    }
+
+    /// @overload
+    cold& operator=(value_type&& value)
+    {
+        get() = std::move(value);
+        return *this;
+    }
+
+    ~cold()
+    {
+        reset();
+    }
+
+    /// Returns true if the value has been allocated.
+    bool has_value() const noexcept { return ptr != nullptr; }
+
+    /// Destroys and frees the value, if there is one.
+    void reset() noexcept
+    {
+        if (ptr) {
+            auto a = get_allocator();
+            traits::destroy(a, detail::to_address(ptr));
+            traits::deallocate(a, ptr, 1);
+            ptr = nullptr;
+        }
+    }
+
+    /// Replaces the value with one constructed from the given arguments.
+    template <typename... Args>
+    reference emplace(Args&&... args)
+    {
+        reset();
+        do_construct(std::forward<Args>(args)...);
+        return *ptr;
+    }
+
+    /// Access the value, allocating a value-initialised T on first use.
+    reference get()
+    {
+        if (!ptr) {
+            do_construct();
+        }
+        return *ptr;
+    }
+
+    /// Access the value without allocating. If there is no value yet,
+    /// returns a shared value-initialised T.
+    const_reference get() const
+    {
+        return ptr ? *ptr : default_value();
+    }
+
+    /// Returns get().
+    reference operator*() { return get(); }
+    /// @overload
+    const_reference operator*() const { return get(); }
+
+    /// Member access.
+    value_type* operator->() { return std::addressof(get()); }
+    /// @overload
+    const value_type* operator->() const { return std::addressof(get()); }
+
+    allocator_type get_allocator() const noexcept { return this->get_ebo_value(); }
+
+    /// Bytes which a cold<T> member occupies in its enclosing object.
+    static constexpr std::size_t hot_size() noexcept { return sizeof(cold); }
+    /// Bytes of cold storage used once the value has been allocated.
+    static constexpr std::size_t cold_size() noexcept { return sizeof(T); }
+
+private:
+    template <typename... Args>
+    void do_construct(Args&&... args)
+    {
+        // Frees the block if construct() throws
+        struct guard {
+            Alloc& a;
+            pointer p;
+            ~guard() { if (p) { traits::deallocate(a, p, 1); } }
+        };
+
+        auto a = get_allocator();
+        guard g{a, traits::allocate(a, 1)};
+        traits::construct(a, detail::to_address(g.p), std::forward<Args>(args)...);
+        ptr = g.p;
+        g.p = nullptr;
+    }
+
+    static const value_type& default_value()
+    {
+        static const value_type value{};
+        return value;
+    }
+
+    pointer ptr = nullptr;
+};
+
+}
+
+#endif
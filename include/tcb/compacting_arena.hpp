@@ -0,0 +1,596 @@
+
+#ifndef TCB_COMPACTING_ARENA_HPP_INCLUDED
+#define TCB_COMPACTING_ARENA_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define TCB_COMPACTING_ARENA_USE_MMAP
+#endif
+
+namespace tcb {
+
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+#define TRY
+#define CATCH(X) if (false)
+#define THROW
+#else
+#define TRY try
+#define CATCH catch
+#define THROW throw
+#endif
+
+namespace detail {
+
+// One level of indirection between a handle and its value. Entries never
+// move, so compaction only has to update the entry, not the handle.
+union registry_entry {
+    void* address;
+    registry_entry* next_free;
+};
+
+// Maps size bytes aligned to size. Slabs are mapped directly, rather than
+// obtained from operator new, so that releasing one returns its memory to
+// the operating system.
+inline void* map_aligned(std::size_t size)
+{
+#ifdef TCB_COMPACTING_ARENA_USE_MMAP
+    void* p = ::mmap(nullptr, 2 * size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw_bad_alloc();
+    }
+    const auto raw = reinterpret_cast<std::uintptr_t>(p);
+    const auto aligned = (raw + size - 1) & ~std::uintptr_t(size - 1);
+    if (aligned != raw) {
+        ::munmap(p, aligned - raw);
+    }
+    const auto tail = raw + 2 * size - (aligned + size);
+    if (tail != 0) {
+        ::munmap(reinterpret_cast<void*>(aligned + size), tail);
+    }
+    return reinterpret_cast<void*>(aligned);
+#else
+    // Keep the original address just before the aligned block
+    void* p = ::operator new(2 * size);
+    const auto raw = reinterpret_cast<std::uintptr_t>(p) + sizeof(void*);
+    const auto aligned = (raw + size - 1) & ~std::uintptr_t(size - 1);
+    reinterpret_cast<void**>(aligned)[-1] = p;
+    return reinterpret_cast<void*>(aligned);
+#endif
+}
+
+inline void unmap_aligned(void* p, std::size_t size) noexcept
+{
+#ifdef TCB_COMPACTING_ARENA_USE_MMAP
+    ::munmap(p, size);
+#else
+    (void) size;
+    ::operator delete(static_cast<void**>(p)[-1]);
+#endif
+}
+
+}
+
+template <typename T>
+class compacting_arena;
+
+/**
+ * The pointer type of compacting_allocator.
+ *
+ * A relocatable_ptr refers to its target through an entry in the arena's
+ * registry, which compaction updates when it moves the target. Handles
+ * holding relocatable_ptrs -- such as allocated_value<T,
+ * compacting_allocator<T>> -- therefore stay valid across compaction,
+ * although raw pointers and references obtained from them do not.
+ *
+ * Only single objects can be addressed, so pointer arithmetic is not
+ * supported.
+ */
+template <typename T>
+class relocatable_ptr {
+    template <typename U>
+    friend class relocatable_ptr;
+
+    template <typename U>
+    friend class compacting_arena;
+
+    template <typename U>
+    using add_ref_t = typename std::conditional<std::is_void<U>::value,
+                                                void, U&>::type;
+
+public:
+    using element_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    template <typename U>
+    using rebind = relocatable_ptr<U>;
+
+    relocatable_ptr() noexcept = default;
+
+    relocatable_ptr(std::nullptr_t) noexcept {}
+
+    /// Converting constructor, available if U* is implicitly convertible to T*.
+    template <typename U,
+              typename = typename std::enable_if<
+                    std::is_convertible<U*, T*>::value>::type>
+    relocatable_ptr(const relocatable_ptr<U>& other) noexcept
+        : entry_(other.entry_)
+    {}
+
+    /// Explicit conversion, as with static_cast<T*>(void_ptr).
+    template <typename U,
+              typename = typename std::enable_if<
+                    !std::is_convertible<U*, T*>::value &&
+                    std::is_void<typename std::remove_cv<U>::type>::value>::type,
+              typename = void>
+    explicit relocatable_ptr(const relocatable_ptr<U>& other) noexcept
+        : entry_(other.entry_)
+    {}
+
+    /// Returns the current address of the target.
+    T* get() const noexcept
+    {
+        return entry_ ? static_cast<T*>(entry_->address) : nullptr;
+    }
+
+    template <typename U = T>
+    add_ref_t<U> operator*() const noexcept { return *get(); }
+
+    T* operator->() const noexcept { return get(); }
+
+    explicit operator bool() const noexcept { return entry_ != nullptr; }
+
+    /// Returns a relocatable_ptr to r, which must be a value allocated by a
+    /// compacting_arena, for std::pointer_traits.
+    template <typename U = T,
+              typename = typename std::enable_if<!std::is_void<U>::value>::type>
+    static relocatable_ptr pointer_to(U& r) noexcept
+    {
+        using arena_type = compacting_arena<typename std::remove_cv<U>::type>;
+        relocatable_ptr p;
+        p.entry_ = arena_type::entry_of(std::addressof(r));
+        return p;
+    }
+
+    friend bool operator==(const relocatable_ptr& a, const relocatable_ptr& b) noexcept
+    {
+        return a.entry_ == b.entry_;
+    }
+
+    friend bool operator!=(const relocatable_ptr& a, const relocatable_ptr& b) noexcept
+    {
+        return a.entry_ != b.entry_;
+    }
+
+    friend bool operator==(const relocatable_ptr& a, std::nullptr_t) noexcept { return !a; }
+    friend bool operator==(std::nullptr_t, const relocatable_ptr& a) noexcept { return !a; }
+    friend bool operator!=(const relocatable_ptr& a, std::nullptr_t) noexcept { return bool(a); }
+    friend bool operator!=(std::nullptr_t, const relocatable_ptr& a) noexcept { return bool(a); }
+
+private:
+    detail::registry_entry* entry_ = nullptr;
+};
+
+/**
+ * A slab allocator for single objects of type T, which can compact its
+ * slabs by moving live objects.
+ *
+ * Objects are allocated in slots within 64KiB slabs. When objects are
+ * freed in an unfavourable order the slabs become sparsely occupied, and
+ * the memory cannot otherwise be reclaimed. compact() moves objects out of
+ * the emptiest slabs into free slots in the fullest ones, then returns the
+ * slabs it has emptied to the operating system. compact_step() does the
+ * same work incrementally, in bounded steps.
+ *
+ * Objects are moved by memcpy if T is trivially copyable, and otherwise
+ * by move-construction followed by destruction of the original. If a move
+ * constructor throws, compaction stops and the exception propagates, with
+ * the object left in its original slot. Because
+ * allocations are reached through relocatable_ptrs, the handles owning
+ * them need not be told: an allocated_value<T, compacting_allocator<T>>
+ * remains valid, but raw pointers and references to its value are
+ * invalidated by compaction.
+ *
+ * All objects must be freed before the arena is destroyed. This class is
+ * not thread safe.
+ */
+template <typename T>
+class compacting_arena {
+    static_assert(alignof(T) <= 64, "compacting_arena does not support over-aligned types");
+
+    template <typename U>
+    friend class relocatable_ptr;
+
+    using entry = detail::registry_entry;
+
+    struct slab_header {
+        std::size_t live;
+        std::size_t used;    // slots ever handed out from this slab
+        char* free_list;
+    };
+
+    // Each slot holds a link word followed by the object. For a live slot
+    // the link is the owning registry entry; for a free slot it is the next
+    // free slot (or null) with the low bit set.
+    static constexpr std::size_t link_size = sizeof(void*);
+    static constexpr std::size_t slot_align =
+            alignof(T) > alignof(void*) ? alignof(T) : alignof(void*);
+    static constexpr std::size_t storage_offset =
+            (link_size + alignof(T) - 1) / alignof(T) * alignof(T);
+    static constexpr std::size_t slot_size =
+            (storage_offset + sizeof(T) + slot_align - 1) / slot_align * slot_align;
+    static constexpr std::size_t first_slot =
+            (sizeof(slab_header) + slot_align - 1) / slot_align * slot_align;
+
+    static constexpr std::size_t entries_per_block = 1024;
+
+public:
+    static constexpr std::size_t slab_size = 64 * 1024;
+    static constexpr std::size_t slots_per_slab = (slab_size - first_slot) / slot_size;
+
+    static_assert(slots_per_slab > 0, "T is too large for a compacting_arena slab");
+
+    compacting_arena() = default;
+
+    compacting_arena(const compacting_arena&) = delete;
+    compacting_arena& operator=(const compacting_arena&) = delete;
+
+    ~compacting_arena()
+    {
+        for (auto s : slabs_) {
+            detail::unmap_aligned(s, slab_size);
+        }
+        for (auto b : entry_blocks_) {
+            delete[] b;
+        }
+    }
+
+    /// Allocates a slot for one T, and returns a pointer to it.
+    relocatable_ptr<T> allocate()
+    {
+        // Neither call changes anything if it throws, but an entry taken
+        // first would be lost if mapping a slab failed
+        auto s = slab_with_space();
+        auto e = new_entry();
+        char* slot = pop_slot(s);
+        ++s->live;
+        ++live_;
+        link_of(slot) = e;
+        e->address = slot + storage_offset;
+
+        relocatable_ptr<T> p;
+        p.entry_ = e;
+        return p;
+    }
+
+    /// Frees a slot previously returned by allocate().
+    void deallocate(relocatable_ptr<T> p) noexcept
+    {
+        auto e = p.entry_;
+        char* slot = static_cast<char*>(e->address) - storage_offset;
+        auto s = slab_of(slot);
+        push_slot(s, slot);
+        --s->live;
+        --live_;
+
+        e->next_free = free_entries_;
+        free_entries_ = e;
+    }
+
+    /**
+     * Moves up to max_moves objects towards the fullest slabs, releasing
+     * any slabs which become empty. Returns true once no further slab can
+     * be emptied.
+     */
+    bool compact_step(std::size_t max_moves)
+    {
+        while (max_moves > 0) {
+            auto source = sparsest_slab();
+            if (!source || free_slots() - (slots_per_slab - source->live) < source->live) {
+                return true;
+            }
+
+            // Move from the sparsest slab to the fullest slabs with room
+            for (std::size_t i = 0; i < source->used && max_moves > 0; ++i) {
+                char* slot = slot_at(source, i);
+                if (is_free(link_of(slot))) {
+                    continue;
+                }
+                relocate(slot, source);
+                --max_moves;
+            }
+
+            if (source->live == 0) {
+                release(source);
+            }
+        }
+        return false;
+    }
+
+    /// Compacts the arena fully. Returns the number of slabs released.
+    std::size_t compact()
+    {
+        const auto before = slabs_.size();
+        while (!compact_step(static_cast<std::size_t>(-1))) {}
+        return before - slabs_.size();
+    }
+
+    /// Returns the number of live objects.
+    std::size_t live() const noexcept { return live_; }
+
+    /// Returns the number of slabs currently mapped.
+    std::size_t slab_count() const noexcept { return slabs_.size(); }
+
+    /// Returns the number of object slots in the mapped slabs.
+    std::size_t capacity() const noexcept { return slabs_.size() * slots_per_slab; }
+
+    /// Returns live() / capacity(), or 1 if nothing is mapped.
+    double occupancy() const noexcept
+    {
+        return slabs_.empty() ? 1.0 : double(live_) / double(capacity());
+    }
+
+private:
+    static void*& link_of(char* slot) noexcept
+    {
+        return *reinterpret_cast<void**>(slot);
+    }
+
+    static bool is_free(void* link) noexcept
+    {
+        return reinterpret_cast<std::uintptr_t>(link) & 1;
+    }
+
+    static void* tag(char* slot) noexcept
+    {
+        return reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(slot) | 1);
+    }
+
+    static char* untag(void* link) noexcept
+    {
+        return reinterpret_cast<char*>(reinterpret_cast<std::uintptr_t>(link) & ~std::uintptr_t(1));
+    }
+
+    static char* pop_slot(slab_header* s) noexcept
+    {
+        char* slot;
+        if (s->free_list) {
+            slot = s->free_list;
+            s->free_list = untag(link_of(slot));
+        } else {
+            slot = slot_at(s, s->used++);
+        }
+        return slot;
+    }
+
+    static void push_slot(slab_header* s, char* slot) noexcept
+    {
+        link_of(slot) = tag(s->free_list);
+        s->free_list = slot;
+    }
+
+    static slab_header* slab_of(const void* p) noexcept
+    {
+        const auto addr = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<slab_header*>(addr & ~std::uintptr_t(slab_size - 1));
+    }
+
+    static char* slot_at(slab_header* s, std::size_t i) noexcept
+    {
+        return reinterpret_cast<char*>(s) + first_slot + i * slot_size;
+    }
+
+    // Used by relocatable_ptr::pointer_to()
+    static entry* entry_of(const T* value) noexcept
+    {
+        auto slot = const_cast<char*>(reinterpret_cast<const char*>(value)) - storage_offset;
+        return static_cast<entry*>(link_of(slot));
+    }
+
+    entry* new_entry()
+    {
+        if (!free_entries_) {
+            entry_blocks_.reserve(entry_blocks_.size() + 1);
+            auto block = new entry[entries_per_block];
+            entry_blocks_.push_back(block);
+            for (std::size_t i = 0; i < entries_per_block; ++i) {
+                block[i].next_free = free_entries_;
+                free_entries_ = &block[i];
+            }
+        }
+        auto e = free_entries_;
+        free_entries_ = e->next_free;
+        return e;
+    }
+
+    static bool has_space(const slab_header* s) noexcept
+    {
+        return s->free_list || s->used < slots_per_slab;
+    }
+
+    slab_header* slab_with_space()
+    {
+        if (current_ && has_space(current_)) {
+            return current_;
+        }
+        for (auto s : slabs_) {
+            if (has_space(s)) {
+                return current_ = s;
+            }
+        }
+
+        slabs_.reserve(slabs_.size() + 1);
+        auto s = ::new (detail::map_aligned(slab_size)) slab_header{0, 0, nullptr};
+        slabs_.push_back(s);
+        return current_ = s;
+    }
+
+    std::size_t free_slots() const noexcept
+    {
+        return capacity() - live_;
+    }
+
+    slab_header* sparsest_slab() const noexcept
+    {
+        slab_header* best = nullptr;
+        for (auto s : slabs_) {
+            if (!best || s->live < best->live) {
+                best = s;
+            }
+        }
+        return best;
+    }
+
+    // The fullest slab, other than source, which has room
+    slab_header* destination_for(const slab_header* source) const noexcept
+    {
+        slab_header* best = nullptr;
+        for (auto s : slabs_) {
+            if (s != source && has_space(s) && (!best || s->live > best->live)) {
+                best = s;
+            }
+        }
+        return best;
+    }
+
+    void relocate(char* from, slab_header* source)
+    {
+        if (!dest_ || dest_ == source || !has_space(dest_)) {
+            dest_ = destination_for(source);
+        }
+        auto s = dest_;
+        char* to = pop_slot(s);
+
+        // If the move throws, the value stays where it was, and the slot
+        // goes back on the free list rather than looking like a live one
+        TRY {
+            move_value(from + storage_offset, to + storage_offset,
+                       std::is_trivially_copyable<T>{});
+        } CATCH (...) {
+            push_slot(s, to);
+            THROW;
+        }
+
+        auto e = static_cast<entry*>(link_of(from));
+        link_of(to) = e;
+        e->address = to + storage_offset;
+        ++s->live;
+
+        push_slot(source, from);
+        --source->live;
+    }
+
+    static void move_value(char* from, char* to, std::true_type /*trivially copyable*/) noexcept
+    {
+        std::memcpy(to, from, sizeof(T));
+    }
+
+    static void move_value(char* from, char* to, std::false_type /*trivially copyable*/)
+    {
+        auto src = reinterpret_cast<T*>(from);
+        ::new (static_cast<void*>(to)) T(std::move(*src));
+        src->~T();
+    }
+
+    void release(slab_header* s) noexcept
+    {
+        for (auto& p : slabs_) {
+            if (p == s) {
+                p = slabs_.back();
+                slabs_.pop_back();
+                break;
+            }
+        }
+        if (current_ == s) {
+            current_ = nullptr;
+        }
+        if (dest_ == s) {
+            dest_ = nullptr;
+        }
+        detail::unmap_aligned(s, slab_size);
+    }
+
+    std::vector<slab_header*> slabs_;
+    std::vector<entry*> entry_blocks_;
+    entry* free_entries_ = nullptr;
+    slab_header* current_ = nullptr;
+    slab_header* dest_ = nullptr;
+    std::size_t live_ = 0;
+};
+
+template <typename T>
+constexpr std::size_t compacting_arena<T>::slab_size;
+
+template <typename T>
+constexpr std::size_t compacting_arena<T>::slots_per_slab;
+
+/**
+ * An allocator which obtains single objects from a compacting_arena.
+ *
+ * The allocator holds a reference to its arena, which must outlive every
+ * allocation made from it. Two compacting_allocators compare equal if they
+ * share an arena.
+ */
+template <typename T>
+class compacting_allocator {
+public:
+    using value_type = T;
+    using pointer = relocatable_ptr<T>;
+    using const_pointer = relocatable_ptr<const T>;
+    using void_pointer = relocatable_ptr<void>;
+    using const_void_pointer = relocatable_ptr<const void>;
+
+    compacting_allocator(compacting_arena<T>& arena) noexcept
+        : arena_(&arena)
+    {}
+
+    /// Allocates a single T. Throws std::bad_alloc if n != 1.
+    pointer allocate(std::size_t n)
+    {
+        if (n != 1) {
+            detail::throw_bad_alloc();
+        }
+        return arena_->allocate();
+    }
+
+    void deallocate(pointer p, std::size_t) noexcept
+    {
+        arena_->deallocate(p);
+    }
+
+    compacting_arena<T>& arena() const noexcept { return *arena_; }
+
+private:
+    compacting_arena<T>* arena_;
+};
+
+template <typename T>
+bool operator==(const compacting_allocator<T>& lhs, const compacting_allocator<T>& rhs) noexcept
+{
+    return &lhs.arena() == &rhs.arena();
+}
+
+template <typename T>
+bool operator!=(const compacting_allocator<T>& lhs, const compacting_allocator<T>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+}
+
+#undef TRY
+#undef CATCH
+#undef THROW
+
+#endif
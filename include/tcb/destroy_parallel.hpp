@@ -0,0 +1,328 @@
+
+#ifndef TCB_DESTROY_PARALLEL_HPP_INCLUDED
+#define TCB_DESTROY_PARALLEL_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tcb {
+
+template <typename Alloc>
+class thread_affine_allocator;
+
+namespace pmr {
+
+template <typename T, typename Resource>
+class typed_resource_allocator;
+
+class synchronized_object_pool_resource;
+
+}
+
+/**
+ * Whether values allocated with allocators of type A may be destroyed on
+ * several threads at once, even when the allocators compare equal.
+ *
+ * This is false unless specialised, in which case destroy_parallel() frees
+ * all the values from one allocator on the same thread.
+ *
+ * std::pmr::polymorphic_allocator is not thread-safe here, as that depends
+ * on the resource it holds at run time, so values sharing a resource are
+ * freed on one worker. Values allocated through a typed_resource_allocator
+ * on a synchronized_object_pool_resource are freed on any worker, which
+ * requires that resource's upstream to be thread-safe too.
+ */
+template <typename A, typename = void>
+struct is_thread_safe_allocator : std::false_type {};
+
+template <typename T>
+struct is_thread_safe_allocator<std::allocator<T>> : std::true_type {};
+
+// Deallocations on foreign threads are queued for the owning thread
+template <typename A>
+struct is_thread_safe_allocator<thread_affine_allocator<A>> : std::true_type {};
+
+template <typename T>
+struct is_thread_safe_allocator<
+    pmr::typed_resource_allocator<T, pmr::synchronized_object_pool_resource>>
+    : std::true_type {};
+
+/**
+ * Maps allocators of type A to a hashable key, letting destroy_parallel()
+ * group values by allocator without comparing against every group.
+ *
+ * Specialisations provide a static key(const A&) function whose results are
+ * equal exactly when the allocators compare equal. Without one, allocators
+ * are compared against each group seen so far, most recent first.
+ *
+ * Allocators with a resource() member returning a pointer, such as
+ * std::pmr::polymorphic_allocator and pmr::typed_resource_allocator, are
+ * keyed on the resource's address. That assumes each resource compares
+ * equal only to itself, as the standard resources and those of this
+ * library do.
+ */
+template <typename A, typename = void>
+struct allocator_key {};
+
+template <typename A>
+struct allocator_key<A, typename std::enable_if<std::is_pointer<
+                            decltype(std::declval<const A&>().resource())>::value>::type> {
+    static const void* key(const A& alloc) noexcept { return alloc.resource(); }
+};
+
+namespace detail {
+
+template <typename V>
+void destroy_value(V& value) noexcept
+{
+    V doomed(std::move(value));
+}
+
+template <typename It>
+struct destroy_each {
+    void operator()(work_stealing_pool::worker&, std::size_t i) const
+    {
+        destroy_value(first[i]);
+    }
+
+    It first;
+};
+
+// A run of consecutive elements sharing an allocator
+struct destroy_run {
+    std::size_t first;
+    std::size_t last;
+    std::size_t group;
+};
+
+template <typename It>
+struct destroy_group {
+    void operator()(work_stealing_pool::worker&, std::size_t g) const
+    {
+        for (std::size_t r = (*group_starts)[g]; r < (*group_starts)[g + 1]; ++r) {
+            const auto& run = (*runs)[r];
+            for (std::size_t i = run.first; i < run.last; ++i) {
+                destroy_value(first[i]);
+            }
+        }
+    }
+
+    It first;
+    const std::vector<destroy_run>* runs;
+    const std::vector<std::size_t>* group_starts;
+};
+
+template <typename It>
+void destroy_parallel(It first, std::size_t n, work_stealing_pool& pool, std::true_type)
+{
+    pool.for_each(0, n, destroy_each<It>{first});
+}
+
+template <typename...>
+struct void_type {
+    using type = void;
+};
+
+// Assigns each allocator to a group of equal allocators, each represented
+// by the index of its first element. The few most recently matched groups
+// are tried first, so that interleaved runs of a handful of allocators
+// rarely need to compare against every group.
+template <typename It, typename A, typename = void>
+class allocator_groups {
+public:
+    explicit allocator_groups(It first) : first_(first) {}
+
+    std::size_t find_or_add(std::size_t i, const A& alloc)
+    {
+        for (std::size_t k = 0; k < recent_count_; ++k) {
+            if (first_[representatives_[recent_[k]]].get_allocator() == alloc) {
+                return promote(k, recent_[k]);
+            }
+        }
+        std::size_t g = 0;
+        while (g < representatives_.size() && !(first_[representatives_[g]].get_allocator() == alloc)) {
+            ++g;
+        }
+        if (g == representatives_.size()) {
+            representatives_.push_back(i);
+        }
+        if (recent_count_ < recent_size) {
+            ++recent_count_;
+        }
+        return promote(recent_count_ - 1, g);
+    }
+
+    std::size_t size() const noexcept { return representatives_.size(); }
+
+private:
+    static constexpr std::size_t recent_size = 4;
+
+    std::size_t promote(std::size_t k, std::size_t g) noexcept
+    {
+        for (; k > 0; --k) {
+            recent_[k] = recent_[k - 1];
+        }
+        recent_[0] = g;
+        return g;
+    }
+
+    It first_;
+    std::vector<std::size_t> representatives_;
+    std::size_t recent_[recent_size] = {};
+    std::size_t recent_count_ = 0;
+};
+
+// Allocators with a key are grouped by hashing it
+template <typename It, typename A>
+class allocator_groups<
+    It, A, typename void_type<decltype(allocator_key<A>::key(std::declval<const A&>()))>::type> {
+public:
+    explicit allocator_groups(It) {}
+
+    std::size_t find_or_add(std::size_t, const A& alloc)
+    {
+        return groups_.emplace(allocator_key<A>::key(alloc), groups_.size()).first->second;
+    }
+
+    std::size_t size() const noexcept { return groups_.size(); }
+
+private:
+    using key_type = typename std::decay<decltype(allocator_key<A>::key(std::declval<const A&>()))>::type;
+
+    std::unordered_map<key_type, std::size_t> groups_;
+};
+
+// Splits the elements into runs sharing an allocator, and the runs into
+// groups of equal allocators. Each group is then destroyed by one worker.
+template <typename It>
+void destroy_parallel(It first, std::size_t n, work_stealing_pool& pool, std::false_type)
+{
+    using allocator_type = typename std::iterator_traits<It>::value_type::allocator_type;
+
+    allocator_groups<It, allocator_type> groups(first);
+    std::vector<destroy_run> runs;
+    for (std::size_t i = 0; i < n; ++i) {
+        // Values which have been moved from have nothing to free
+        if (first[i].operator->() == nullptr) {
+            continue;
+        }
+        const auto g = groups.find_or_add(i, first[i].get_allocator());
+        if (!runs.empty() && runs.back().group == g) {
+            runs.back().last = i + 1;
+        } else {
+            runs.push_back(destroy_run{i, i + 1, g});
+        }
+    }
+
+    std::vector<std::size_t> group_starts(groups.size() + 1, 0);
+    for (const auto& run : runs) {
+        ++group_starts[run.group + 1];
+    }
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        group_starts[g + 1] += group_starts[g];
+    }
+    std::vector<destroy_run> sorted(runs.size());
+    {
+        auto next = group_starts;
+        for (const auto& run : runs) {
+            sorted[next[run.group]++] = run;
+        }
+    }
+
+    pool.for_each(0, groups.size(), destroy_group<It>{first, &sorted, &group_starts});
+}
+
+}
+
+/**
+ * Destroys the values held by each allocated_value in range, using the
+ * workers of pool.
+ *
+ * range must be a random-access range of allocated_values, such as a
+ * std::vector. Afterwards every element is in the moved-from state, so
+ * destroying or clearing the container itself is cheap.
+ *
+ * Unless is_thread_safe_allocator is true for the allocator type, the
+ * elements are first grouped by allocator equality, with each group freed
+ * by a single worker. That takes a serial pass over the range, hashing the
+ * allocators where allocator_key supports them and otherwise comparing
+ * them, and gives no parallelism when every element uses the same
+ * allocator. In particular, pmr::allocated_values on one memory resource
+ * are all freed by the same worker.
+ */
+template <typename Range>
+void destroy_parallel(Range& range, work_stealing_pool& pool)
+{
+    using std::begin;
+    using std::end;
+    const auto first = begin(range);
+    const auto n = static_cast<std::size_t>(std::distance(first, end(range)));
+    using value_type = typename std::iterator_traits<decltype(first)>::value_type;
+    using allocator_type = typename value_type::allocator_type;
+    detail::destroy_parallel(first, n, pool, is_thread_safe_allocator<allocator_type>{});
+}
+
+/**
+ * A container of allocated_values whose contents are destroyed in parallel.
+ *
+ * Wraps a Container, such as a std::vector of allocated_values, which is
+ * accessed through get() or operator->. When the wrapper is destroyed, the
+ * values are destroyed with destroy_parallel(), provided that there are at
+ * least threshold of them; smaller containers are destroyed on the calling
+ * thread as usual.
+ */
+template <typename Container>
+class parallel_teardown {
+public:
+    using container_type = Container;
+
+    static constexpr std::size_t default_threshold = 4096;
+
+    explicit parallel_teardown(work_stealing_pool& pool, Container c = Container(),
+                               std::size_t threshold = default_threshold)
+        : pool_(&pool),
+          container_(std::move(c)),
+          threshold_(threshold)
+    {}
+
+    parallel_teardown(parallel_teardown&&) = default;
+    parallel_teardown& operator=(parallel_teardown&&) = default;
+
+    ~parallel_teardown()
+    {
+        if (container_.size() >= threshold_) {
+            destroy_parallel(container_, *pool_);
+        }
+    }
+
+    Container& get() noexcept { return container_; }
+    const Container& get() const noexcept { return container_; }
+
+    Container& operator*() noexcept { return container_; }
+    const Container& operator*() const noexcept { return container_; }
+
+    Container* operator->() noexcept { return std::addressof(container_); }
+    const Container* operator->() const noexcept { return std::addressof(container_); }
+
+    work_stealing_pool& pool() const noexcept { return *pool_; }
+
+private:
+    work_stealing_pool* pool_;
+    Container container_;
+    std::size_t threshold_;
+};
+
+template <typename Container>
+constexpr std::size_t parallel_teardown<Container>::default_threshold;
+
+}
+
+#endif
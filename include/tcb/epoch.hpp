@@ -0,0 +1,325 @@
+
+#ifndef TCB_EPOCH_HPP_INCLUDED
+#define TCB_EPOCH_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace tcb {
+
+namespace detail {
+
+// A thread's announcement of the epoch in which it is reading. Padded so
+// that records belonging to different threads never share a cache line.
+struct epoch_participant {
+    std::atomic<std::uint64_t> state{0};   // (epoch << 1) | 1 while reading, else 0
+    std::atomic<bool> in_use{false};
+    epoch_participant* next = nullptr;
+    char padding[128 - sizeof(std::atomic<std::uint64_t>) - sizeof(std::atomic<bool>) -
+                 sizeof(epoch_participant*)];
+};
+
+// A value whose destruction has been deferred
+struct epoch_retired {
+    virtual ~epoch_retired() = default;
+    std::uint64_t epoch = 0;
+    epoch_retired* next = nullptr;
+};
+
+template <typename T, typename A>
+struct epoch_retired_value : epoch_retired {
+    explicit epoch_retired_value(allocated_value<T, A>&& v) noexcept
+        : value(std::move(v))
+    {}
+
+    allocated_value<T, A> value;
+};
+
+}
+
+/**
+ * An epoch-based reclamation (EBR) domain.
+ *
+ * Readers enter a critical section by constructing an epoch::guard, and
+ * may then dereference values published by writers -- typically through
+ * an epoch_cell -- until the guard is destroyed. Writers which replace such
+ * a value pass the old one to retire(), which destroys it only once every
+ * reader which could still be using it has left its critical section.
+ *
+ * Entering and leaving a critical section touch only the calling thread's
+ * record, so readers do not contend with each other or with writers. The
+ * cost falls on retire(), which scans the records of all threads that have
+ * used the domain.
+ *
+ * Guards may be nested, and may be created on any number of threads. A
+ * value passed to retire() is destroyed by whichever thread later finds it
+ * to be unreachable, or by the domain's destructor. The domain must outlive
+ * all of its guards.
+ */
+class epoch {
+public:
+    /// An RAII reader critical section.
+    class guard {
+    public:
+        explicit guard(epoch& domain)
+            : record_(domain.acquire_record())
+        {
+            const auto e = domain.global_.load(std::memory_order_relaxed);
+            // Sequentially consistent, so that the announcement is ordered
+            // before any load of a published pointer
+            record_->state.store((e << 1) | 1, std::memory_order_seq_cst);
+        }
+
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+
+        ~guard()
+        {
+            record_->state.store(0, std::memory_order_release);
+            record_->in_use.store(false, std::memory_order_release);
+        }
+
+    private:
+        detail::epoch_participant* record_;
+    };
+
+    epoch() = default;
+
+    epoch(const epoch&) = delete;
+    epoch& operator=(const epoch&) = delete;
+
+    /// Destroys every retired value. No guards may be active.
+    ~epoch()
+    {
+        free_list(retired_head_);
+        auto r = records_.load(std::memory_order_acquire);
+        while (r) {
+            const auto next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    /**
+     * Defers the destruction of value until no reader can be accessing it.
+     *
+     * The value must already be unreachable by new readers -- for example,
+     * because it has been swapped out of the place they look for it.
+     */
+    template <typename T, typename A>
+    void retire(allocated_value<T, A>&& value)
+    {
+        auto node = new detail::epoch_retired_value<T, A>(std::move(value));
+
+        detail::epoch_retired* ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // Readers who loaded the old pointer announced this epoch or an
+            // earlier one, so it is safe once the global epoch is two ahead
+            node->epoch = global_.load(std::memory_order_seq_cst);
+            if (retired_tail_) {
+                retired_tail_->next = node;
+            } else {
+                retired_head_ = node;
+            }
+            retired_tail_ = node;
+            ++pending_;
+            ready = collect_locked();
+        }
+        free_list(ready);
+    }
+
+    /// Advances the epoch if possible, and destroys any retired values which
+    /// have become unreachable.
+    void collect()
+    {
+        detail::epoch_retired* ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready = collect_locked();
+        }
+        free_list(ready);
+    }
+
+    /// Returns the number of retired values not yet destroyed.
+    std::size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+    /// Returns the current global epoch.
+    std::uint64_t current() const noexcept
+    {
+        return global_.load(std::memory_order_acquire);
+    }
+
+private:
+    // Each thread remembers the record it last used, and in which domain.
+    // Domain ids are never reused, so a stale hint is never dereferenced.
+    struct record_hint {
+        std::uint64_t domain_id = 0;
+        detail::epoch_participant* record = nullptr;
+    };
+
+    static record_hint& this_thread_hint() noexcept
+    {
+        static thread_local record_hint hint;
+        return hint;
+    }
+
+    static std::uint64_t next_id() noexcept
+    {
+        static std::atomic<std::uint64_t> id{0};
+        return id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    static bool try_claim(detail::epoch_participant* r) noexcept
+    {
+        bool expected = false;
+        return !r->in_use.load(std::memory_order_relaxed) &&
+               r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire);
+    }
+
+    detail::epoch_participant* acquire_record()
+    {
+        auto& hint = this_thread_hint();
+        if (hint.domain_id == id_ && try_claim(hint.record)) {
+            return hint.record;
+        }
+
+        // Reuse a record abandoned by another thread, or add a new one
+        auto r = records_.load(std::memory_order_acquire);
+        for (; r; r = r->next) {
+            if (try_claim(r)) {
+                break;
+            }
+        }
+        if (!r) {
+            r = new detail::epoch_participant;
+            r->in_use.store(true, std::memory_order_relaxed);
+            auto head = records_.load(std::memory_order_relaxed);
+            do {
+                r->next = head;
+            } while (!records_.compare_exchange_weak(head, r, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+        }
+        hint.domain_id = id_;
+        hint.record = r;
+        return r;
+    }
+
+    // Advances the global epoch if every active reader has seen it, then
+    // unlinks and returns the retired values which are safe to destroy
+    detail::epoch_retired* collect_locked() noexcept
+    {
+        auto e = global_.load(std::memory_order_relaxed);
+        bool can_advance = true;
+        for (auto r = records_.load(std::memory_order_acquire); r; r = r->next) {
+            const auto s = r->state.load(std::memory_order_seq_cst);
+            if ((s & 1) && (s >> 1) != e) {
+                can_advance = false;
+                break;
+            }
+        }
+        if (can_advance) {
+            global_.store(++e, std::memory_order_seq_cst);
+        }
+
+        // The list is in epoch order, so the safe values form a prefix
+        detail::epoch_retired* ready = nullptr;
+        detail::epoch_retired* last = nullptr;
+        while (retired_head_ && retired_head_->epoch + 2 <= e) {
+            last = retired_head_;
+            if (!ready) {
+                ready = last;
+            }
+            retired_head_ = last->next;
+            --pending_;
+        }
+        if (last) {
+            last->next = nullptr;
+        }
+        if (!retired_head_) {
+            retired_tail_ = nullptr;
+        }
+        return ready;
+    }
+
+    static void free_list(detail::epoch_retired* r) noexcept
+    {
+        while (r) {
+            const auto next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    const std::uint64_t id_ = next_id();
+    std::atomic<std::uint64_t> global_{1};
+    std::atomic<detail::epoch_participant*> records_{nullptr};
+
+    mutable std::mutex mutex_;
+    detail::epoch_retired* retired_head_ = nullptr;
+    detail::epoch_retired* retired_tail_ = nullptr;
+    std::size_t pending_ = 0;
+};
+
+/**
+ * A value which readers access under an epoch::guard while writers replace
+ * it.
+ *
+ * load() is a single atomic load. store() publishes a new value and retires
+ * the old one to the domain, so a reference obtained from load() stays
+ * valid until the guard passed to it is destroyed. Concurrent calls to
+ * store() are serialised.
+ */
+template <typename T, typename Alloc = std::allocator<T>>
+class epoch_cell {
+public:
+    using value_type = T;
+    using allocator_type = Alloc;
+
+    epoch_cell(epoch& domain, allocated_value<T, Alloc> initial)
+        : domain_(domain),
+          current_(std::move(initial)),
+          published_(std::addressof(*current_))
+    {}
+
+    epoch_cell(const epoch_cell&) = delete;
+    epoch_cell& operator=(const epoch_cell&) = delete;
+
+    /// Returns the current value, which remains valid while g is alive.
+    const T& load(const epoch::guard& g) const noexcept
+    {
+        (void) g;
+        return *published_.load(std::memory_order_seq_cst);
+    }
+
+    /// Replaces the value, retiring the old one.
+    void store(allocated_value<T, Alloc> next)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            published_.store(std::addressof(*next), std::memory_order_seq_cst);
+            swap(current_, next);
+        }
+        domain_.retire(std::move(next));
+    }
+
+private:
+    epoch& domain_;
+    std::mutex mutex_;
+    allocated_value<T, Alloc> current_;
+    std::atomic<const T*> published_;
+};
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+
+#ifndef TCB_FAST_PIMPL_HPP_INCLUDED
+#define TCB_FAST_PIMPL_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tcb {
+
+namespace detail {
+
+// The template arguments appear in the compiler's diagnostic if either
+// assertion fails, giving the size and alignment which Impl requires
+template <std::size_t ImplSize, std::size_t ImplAlign, std::size_t Size, std::size_t Align>
+struct fast_pimpl_check {
+    static_assert(ImplSize <= Size,
+                  "fast_pimpl: Size is too small for Impl");
+    static_assert(Align % ImplAlign == 0,
+                  "fast_pimpl: Align is not a multiple of Impl's alignment");
+    static constexpr bool value = true;
+};
+
+}
+
+/**
+ * Pimpl storage which keeps the implementation object inside the owning
+ * object, rather than in a separate allocation.
+ *
+ * Like allocated_value<Impl>, a fast_pimpl<Impl, Size, Align> may be
+ * declared while Impl is incomplete, and provides value semantics. Unlike
+ * allocated_value, constructing one performs no allocation and accessing
+ * Impl involves no indirection, at the cost of fixing an upper bound on
+ * the implementation's size and alignment in the header.
+ *
+ * The bounds are checked by static_asserts in each member function, so
+ * they are enforced in the translation unit which defines Impl, where the
+ * owning class's special members are defined. If they fail, increase Size
+ * or Align in the header to at least the values reported.
+ *
+ * Unlike allocated_value, a moved-from fast_pimpl still holds an Impl,
+ * which is in whatever state Impl's move constructor leaves it.
+ */
+template <typename Impl, std::size_t Size,
+          std::size_t Align = alignof(std::max_align_t)>
+class fast_pimpl {
+public:
+    using value_type = Impl;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    static constexpr std::size_t size = Size;
+    static constexpr std::size_t alignment = Align;
+
+    /// Constructs a value-initialised Impl.
+    fast_pimpl()
+    {
+        check();
+        ::new (address()) Impl();
+    }
+
+    /// Constructs the Impl by copying value.
+    explicit fast_pimpl(const Impl& value)
+    {
+        check();
+        ::new (address()) Impl(value);
+    }
+
+    /// Constructs the Impl by moving from value.
+    explicit fast_pimpl(Impl&& value)
+    {
+        check();
+        ::new (address()) Impl(std::move(value));
+    }
+
+    /// Constructs the Impl in-place from the given arguments.
+    template <typename... Args>
+    explicit fast_pimpl(in_place_t, Args&&... args)
+    {
+        check();
+        ::new (address()) Impl(std::forward<Args>(args)...);
+    }
+
+    fast_pimpl(const fast_pimpl& other)
+    {
+        check();
+        ::new (address()) Impl(other.get());
+    }
+
+    fast_pimpl(fast_pimpl&& other)
+        noexcept(std::is_nothrow_move_constructible<Impl>::value)
+    {
+        check();
+        ::new (address()) Impl(std::move(other.get()));
+    }
+
+    fast_pimpl& operator=(const fast_pimpl& other)
+    {
+        check();
+        get() = other.get();
+        return *this;
+    }
+
+    fast_pimpl& operator=(fast_pimpl&& other)
+        noexcept(std::is_nothrow_move_assignable<Impl>::value)
+    {
+        check();
+        get() = std::move(other.get());
+        return *this;
+    }
+
+    ~fast_pimpl()
+    {
+        check();
+        get().~Impl();
+    }
+
+    /// Access the implementation object.
+    reference get() noexcept { return *static_cast<pointer>(address()); }
+    /// @overload
+    const_reference get() const noexcept { return *static_cast<const_pointer>(address()); }
+
+    /// Returns get().
+    reference operator*() noexcept { return get(); }
+    /// @overload
+    const_reference operator*() const noexcept { return get(); }
+
+    /// Member access.
+    pointer operator->() noexcept { return std::addressof(get()); }
+    /// @overload
+    const_pointer operator->() const noexcept { return std::addressof(get()); }
+
+private:
+    // Instantiated along with each member, at which point Impl is complete
+    static void check() noexcept
+    {
+        static_assert(detail::fast_pimpl_check<sizeof(Impl), alignof(Impl),
+                                               Size, Align>::value, "");
+    }
+
+    void* address() noexcept { return static_cast<void*>(storage_); }
+    const void* address() const noexcept { return static_cast<const void*>(storage_); }
+
+    alignas(Align) unsigned char storage_[Size];
+};
+
+template <typename Impl, std::size_t S, std::size_t A>
+constexpr std::size_t fast_pimpl<Impl, S, A>::size;
+
+template <typename Impl, std::size_t S, std::size_t A>
+constexpr std::size_t fast_pimpl<Impl, S, A>::alignment;
+
+}
+
+#endif
@@ -0,0 +1,375 @@
+
+#ifndef TCB_FLAT_HPP_INCLUDED
+#define TCB_FLAT_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace tcb {
+
+/*
+ * Flat serialisation
+ *
+ * flatten() copies a value -- including any allocated_values it owns --
+ * into a single contiguous buffer. Owning pointers are replaced by
+ * flat_refs, which store the distance to their target rather than its
+ * address, so the buffer can be copied, sent to another process or mapped
+ * from a file and then read in place through a flat_view, without any
+ * allocation or unpacking.
+ *
+ * The flat representation of a type T is flat_traits<T>::flat_type:
+ *
+ *  - trivially copyable types are stored as themselves;
+ *  - allocated_value<T, A> is stored as a flat_ref to the flat form of T,
+ *    or as a null flat_ref if it has been moved from;
+ *  - other types must specialise flat_traits, providing a flat_type and a
+ *    static write() member function, and a static check() member function
+ *    if the flat_type holds flat_refs. See test/test_allocated_value_flat.cpp
+ *    for an example.
+ *
+ * A buffer received from elsewhere is read through a flat_view, which
+ * first checks that every flat_ref in it points within the buffer. Buffers
+ * use the host's byte order and type layout.
+ */
+
+/// Thrown by flat_view when a buffer does not hold a valid flattened value.
+struct flat_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+template <typename T, typename = void>
+struct flat_traits;
+
+template <typename T>
+using flat_type_t = typename flat_traits<T>::flat_type;
+
+class flat_checker;
+
+namespace detail {
+
+// flat_refs, and the flat types which hold them, cannot be copied, and
+// only they need checking; all other flat types are trivially copyable.
+// Either way, their bytes are copied along with the buffer.
+template <typename F>
+using is_flat_type = std::integral_constant<bool,
+        std::is_trivially_copyable<F>::value ||
+        (std::is_standard_layout<F>::value && std::is_trivially_destructible<F>::value)>;
+
+[[noreturn]] inline void throw_flat_error(const char* what)
+{
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+    std::fprintf(stderr, "flat_view: %s\n", what);
+    std::abort();
+#else
+    throw flat_error(what);
+#endif
+}
+
+}
+
+/**
+ * A relative reference to a flattened value of type F.
+ *
+ * A flat_ref is only meaningful inside the buffer it was written to, so it
+ * cannot be copied out of it. A null flat_ref stands for an allocated_value
+ * which had been moved from.
+ */
+template <typename F>
+class flat_ref {
+    template <typename, typename>
+    friend struct flat_traits;
+    friend class flat_checker;
+
+public:
+    flat_ref(const flat_ref&) = delete;
+    flat_ref& operator=(const flat_ref&) = delete;
+
+    /// Returns the target, which must not be null.
+    const F& get() const noexcept
+    {
+        return *reinterpret_cast<const F*>(reinterpret_cast<const char*>(this) + offset_);
+    }
+
+    const F& operator*() const noexcept { return get(); }
+    const F* operator->() const noexcept { return &get(); }
+
+    explicit operator bool() const noexcept { return offset_ != 0; }
+
+private:
+    std::int64_t offset_;
+};
+
+/**
+ * Builds a flat buffer.
+ *
+ * Space is reserved for a value's flat form with reserve<T>(), which
+ * returns an offset into the buffer, and then filled in with write(). As
+ * the buffer may grow while it is being written, references into it should
+ * not be held across calls to reserve().
+ */
+class flat_writer {
+public:
+    /// Reserves zeroed, suitably aligned space for the flat form of T.
+    template <typename T>
+    std::size_t reserve()
+    {
+        using F = flat_type_t<T>;
+        static_assert(detail::is_flat_type<F>::value,
+                      "flat types must be trivially copyable, or hold flat_refs");
+        static_assert(alignof(F) <= alignof(std::max_align_t),
+                      "flat types cannot be over-aligned");
+
+        const auto at = (size_ + alignof(F) - 1) / alignof(F) * alignof(F);
+        grow(at + sizeof(F));
+        return at;
+    }
+
+    /// Writes the flat form of value at the given offset.
+    template <typename T>
+    void write(std::size_t at, const T& value)
+    {
+        flat_traits<T>::write(*this, at, value);
+    }
+
+    /**
+     * Writes the flat form of value into member m of the flat object of type
+     * F at offset at.
+     */
+    template <typename F, typename M, typename T>
+    void write_member(std::size_t at, M F::* m, const T& value)
+    {
+        static_assert(std::is_same<M, flat_type_t<T>>::value,
+                      "member type must be the flat form of the value type");
+        const auto member_at = static_cast<std::size_t>(
+                reinterpret_cast<char*>(&(get<F>(at)->*m)) - data());
+        write(member_at, value);
+    }
+
+    /// Returns a pointer to the flat object of type F at offset at.
+    template <typename F>
+    F* get(std::size_t at) noexcept
+    {
+        return reinterpret_cast<F*>(data() + at);
+    }
+
+    char* data() noexcept { return reinterpret_cast<char*>(storage_.data()); }
+    std::size_t size() const noexcept { return size_; }
+
+    std::vector<std::max_align_t> release() noexcept { return std::move(storage_); }
+
+private:
+    void grow(std::size_t new_size)
+    {
+        const auto words = (new_size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+        if (words > storage_.size()) {
+            storage_.resize(words < 2 * storage_.size() ? 2 * storage_.size() : words);
+        }
+        size_ = new_size;
+    }
+
+    // Using max_align_t as the element type keeps the data suitably aligned
+    std::vector<std::max_align_t> storage_;
+    std::size_t size_ = 0;
+};
+
+/**
+ * Checks the flat_refs in a buffer of untrusted contents.
+ *
+ * Every non-null flat_ref must point forwards, to a suitably aligned
+ * object lying within the buffer, and the objects reached must not add up
+ * to more than the size of the buffer, so checking takes time linear in
+ * its size however the references are arranged.
+ */
+class flat_checker {
+public:
+    flat_checker(const void* data, std::size_t size) noexcept
+        : end_(static_cast<const char*>(data) + size),
+          budget_(size)
+    {}
+
+    /**
+     * Checks the flat form of T, which is known to lie within the buffer,
+     * and the flat_refs it holds.
+     */
+    template <typename T>
+    bool check(const flat_type_t<T>& f)
+    {
+        return check_flat<T>(f, std::is_copy_constructible<flat_type_t<T>>{});
+    }
+
+    /// Checks that r is null or refers to the flat form of T.
+    template <typename T>
+    bool check_ref(const flat_ref<flat_type_t<T>>& r)
+    {
+        using F = flat_type_t<T>;
+        if (r.offset_ == 0) {
+            return true;
+        }
+        const auto from = reinterpret_cast<const char*>(std::addressof(r));
+        const auto room = static_cast<std::size_t>(end_ - from);
+        if (r.offset_ < 0 || room < sizeof(F) ||
+            static_cast<std::uint64_t>(r.offset_) > room - sizeof(F)) {
+            return false;
+        }
+        const auto target = from + r.offset_;
+        if (reinterpret_cast<std::uintptr_t>(target) % alignof(F) != 0 || !take(sizeof(F))) {
+            return false;
+        }
+        return check<T>(*reinterpret_cast<const F*>(target));
+    }
+
+    /// Accounts for the root object, which is not reached through a flat_ref.
+    bool take(std::size_t bytes) noexcept
+    {
+        if (bytes > budget_) {
+            return false;
+        }
+        budget_ -= bytes;
+        return true;
+    }
+
+private:
+    // Flat types which can be copied cannot hold flat_refs
+    template <typename T>
+    bool check_flat(const flat_type_t<T>&, std::true_type /*copy constructible*/)
+    {
+        return true;
+    }
+
+    template <typename T>
+    bool check_flat(const flat_type_t<T>& f, std::false_type /*copy constructible*/)
+    {
+        return flat_traits<T>::check(*this, f);
+    }
+
+    const char* end_;
+    std::size_t budget_;
+};
+
+/**
+ * A read-only view of a flattened T, stored in a buffer created by
+ * flatten().
+ */
+template <typename T>
+class flat_view {
+    template <typename>
+    friend class flat_buffer;
+
+public:
+    using flat_type = flat_type_t<T>;
+
+    /**
+     * Constructs a view of the size bytes at data, which may have come from
+     * anywhere. Throws flat_error if the buffer is misaligned, too short, or
+     * holds a flat_ref which does not stay within it.
+     */
+    flat_view(const void* data, std::size_t size)
+        : root_(static_cast<const flat_type*>(data))
+    {
+        if (!is_valid(data, size)) {
+            detail::throw_flat_error("invalid flat buffer");
+        }
+    }
+
+    /// Returns true if a flat_view of the size bytes at data may be created.
+    static bool is_valid(const void* data, std::size_t size)
+    {
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(flat_type) != 0) {
+            return false;
+        }
+        flat_checker checker(data, size);
+        return checker.take(sizeof(flat_type)) &&
+               checker.template check<T>(*static_cast<const flat_type*>(data));
+    }
+
+    const flat_type& get() const noexcept { return *root_; }
+    const flat_type& operator*() const noexcept { return *root_; }
+    const flat_type* operator->() const noexcept { return root_; }
+
+private:
+    // For buffers written by this process, which need no checking
+    explicit flat_view(const flat_type* root) noexcept : root_(root) {}
+
+    const flat_type* root_;
+};
+
+/**
+ * A contiguous, relocatable buffer holding a flattened T.
+ */
+template <typename T>
+class flat_buffer {
+public:
+    explicit flat_buffer(const T& value)
+    {
+        flat_writer w;
+        w.write(w.reserve<T>(), value);
+        size_ = w.size();
+        storage_ = w.release();
+    }
+
+    const void* data() const noexcept { return storage_.data(); }
+    std::size_t size() const noexcept { return size_; }
+
+    flat_view<T> view() const noexcept
+    {
+        return flat_view<T>(static_cast<const flat_type_t<T>*>(data()));
+    }
+
+private:
+    std::vector<std::max_align_t> storage_;
+    std::size_t size_;
+};
+
+/// Copies value, and everything it owns, into a single flat_buffer.
+template <typename T>
+flat_buffer<T> flatten(const T& value)
+{
+    return flat_buffer<T>(value);
+}
+
+// Trivially copyable types are their own flat form
+template <typename T>
+struct flat_traits<T, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> {
+    using flat_type = T;
+
+    static void write(flat_writer& w, std::size_t at, const T& value)
+    {
+        std::memcpy(w.get<T>(at), std::addressof(value), sizeof(T));
+    }
+};
+
+// allocated_value<T> is flattened to a relative reference to flattened T
+template <typename T, typename A>
+struct flat_traits<allocated_value<T, A>> {
+    using flat_type = flat_ref<flat_type_t<T>>;
+
+    static void write(flat_writer& w, std::size_t at, const allocated_value<T, A>& value)
+    {
+        // A moved-from value is written as a null reference
+        if (value.operator->() == nullptr) {
+            return;
+        }
+        const auto child = w.reserve<T>();
+        w.write(child, *value);
+        w.get<flat_type>(at)->offset_ =
+                static_cast<std::int64_t>(child) - static_cast<std::int64_t>(at);
+    }
+
+    static bool check(flat_checker& c, const flat_type& f)
+    {
+        return c.check_ref<T>(f);
+    }
+};
+
+}
+
+#endif
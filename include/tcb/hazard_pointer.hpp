@@ -0,0 +1,393 @@
+
+#ifndef TCB_HAZARD_POINTER_HPP_INCLUDED
+#define TCB_HAZARD_POINTER_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace tcb {
+
+namespace detail {
+
+// One hazard pointer. Padded so that records belonging to different
+// threads never share a cache line.
+struct hazard_record {
+    std::atomic<const void*> hazard{nullptr};
+    std::atomic<bool> in_use{false};
+    hazard_record* next = nullptr;
+    char padding[128 - sizeof(std::atomic<const void*>) - sizeof(std::atomic<bool>) -
+                 sizeof(hazard_record*)];
+};
+
+// A value whose destruction has been deferred
+struct hazard_retired {
+    explicit hazard_retired(const void* address) noexcept : address(address) {}
+    virtual ~hazard_retired() = default;
+    const void* address;
+    hazard_retired* next = nullptr;
+};
+
+template <typename T, typename A>
+struct hazard_retired_value : hazard_retired {
+    explicit hazard_retired_value(allocated_value<T, A>&& v) noexcept
+        : hazard_retired(std::addressof(*v)),
+          value(std::move(v))
+    {}
+
+    allocated_value<T, A> value;
+};
+
+}
+
+/**
+ * A hazard pointer domain.
+ *
+ * A reader protects a pointer by publishing it in a hazard record owned by
+ * its thread, then checking that the pointer is still current. A writer
+ * which has replaced a value retires the old one; once scan_threshold()
+ * values are waiting, retire() scans every hazard record and destroys the
+ * retired values which no reader has protected.
+ *
+ * Unlike epoch-based reclamation, a stalled reader holds back only the one
+ * value it protects, so the number of values awaiting destruction never
+ * exceeds scan_threshold() plus the number of hazard records.
+ *
+ * The domain must outlive every hazard_slot and hazard_ptr which uses it.
+ */
+class hazard_domain {
+public:
+    hazard_domain() = default;
+
+    /// Constructs a domain which scans once threshold values are retired.
+    explicit hazard_domain(std::size_t threshold)
+        : threshold_(threshold)
+    {}
+
+    hazard_domain(const hazard_domain&) = delete;
+    hazard_domain& operator=(const hazard_domain&) = delete;
+
+    /// Destroys every retired value. No hazard_ptrs may be active.
+    ~hazard_domain()
+    {
+        free_list(retired_head_);
+        auto r = records_.load(std::memory_order_acquire);
+        while (r) {
+            const auto next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    /// Returns a process-wide domain.
+    static hazard_domain& global()
+    {
+        static hazard_domain domain;
+        return domain;
+    }
+
+    /**
+     * Defers the destruction of value until no hazard pointer protects it.
+     *
+     * The value must already be unreachable by new readers -- for example,
+     * because it has been swapped out of the slot they read.
+     */
+    template <typename T, typename A>
+    void retire(allocated_value<T, A>&& value)
+    {
+        auto node = new detail::hazard_retired_value<T, A>(std::move(value));
+
+        detail::hazard_retired* ready = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            node->next = retired_head_;
+            retired_head_ = node;
+            if (++pending_ >= scan_threshold()) {
+                ready = scan_locked();
+            }
+        }
+        free_list(ready);
+    }
+
+    /// Scans the hazard records now, destroying every retired value which
+    /// is not protected.
+    void reclaim()
+    {
+        detail::hazard_retired* ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready = scan_locked();
+        }
+        free_list(ready);
+    }
+
+    /// Returns the number of retired values not yet destroyed.
+    std::size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+    /// Returns the number of retired values which trigger a scan: the
+    /// threshold given on construction, but at least twice the number of
+    /// hazard records, so that each scan frees at least half its batch.
+    std::size_t scan_threshold() const noexcept
+    {
+        const auto floor = 2 * num_records_.load(std::memory_order_relaxed);
+        return threshold_ > floor ? threshold_ : floor;
+    }
+
+private:
+    template <typename T>
+    friend class hazard_ptr;
+
+    // Each thread remembers the record it last used, and in which domain.
+    // Domain ids are never reused, so a stale hint is never dereferenced.
+    struct record_hint {
+        std::uint64_t domain_id = 0;
+        detail::hazard_record* record = nullptr;
+    };
+
+    static record_hint& this_thread_hint() noexcept
+    {
+        static thread_local record_hint hint;
+        return hint;
+    }
+
+    static std::uint64_t next_id() noexcept
+    {
+        static std::atomic<std::uint64_t> id{0};
+        return id.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    static bool try_claim(detail::hazard_record* r) noexcept
+    {
+        bool expected = false;
+        return !r->in_use.load(std::memory_order_relaxed) &&
+               r->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire);
+    }
+
+    detail::hazard_record* acquire_record()
+    {
+        auto& hint = this_thread_hint();
+        if (hint.domain_id == id_ && try_claim(hint.record)) {
+            return hint.record;
+        }
+
+        // Reuse a record released by another thread, or add a new one
+        auto r = records_.load(std::memory_order_acquire);
+        for (; r; r = r->next) {
+            if (try_claim(r)) {
+                break;
+            }
+        }
+        if (!r) {
+            r = new detail::hazard_record;
+            r->in_use.store(true, std::memory_order_relaxed);
+            auto head = records_.load(std::memory_order_relaxed);
+            do {
+                r->next = head;
+            } while (!records_.compare_exchange_weak(head, r, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+            num_records_.fetch_add(1, std::memory_order_relaxed);
+        }
+        hint.domain_id = id_;
+        hint.record = r;
+        return r;
+    }
+
+    static void release_record(detail::hazard_record* r) noexcept
+    {
+        r->hazard.store(nullptr, std::memory_order_release);
+        r->in_use.store(false, std::memory_order_release);
+    }
+
+    // Unlinks and returns the retired values which no hazard protects
+    detail::hazard_retired* scan_locked()
+    {
+        protected_.clear();
+        for (auto r = records_.load(std::memory_order_acquire); r; r = r->next) {
+            if (const auto p = r->hazard.load(std::memory_order_seq_cst)) {
+                protected_.push_back(p);
+            }
+        }
+        std::sort(protected_.begin(), protected_.end());
+
+        detail::hazard_retired* ready = nullptr;
+        auto link = &retired_head_;
+        while (auto node = *link) {
+            if (std::binary_search(protected_.begin(), protected_.end(), node->address)) {
+                link = &node->next;
+            } else {
+                *link = node->next;
+                node->next = ready;
+                ready = node;
+                --pending_;
+            }
+        }
+        return ready;
+    }
+
+    static void free_list(detail::hazard_retired* r) noexcept
+    {
+        while (r) {
+            const auto next = r->next;
+            delete r;
+            r = next;
+        }
+    }
+
+    const std::uint64_t id_ = next_id();
+    std::atomic<detail::hazard_record*> records_{nullptr};
+    std::atomic<std::size_t> num_records_{0};
+    std::size_t threshold_ = 64;
+
+    mutable std::mutex mutex_;
+    detail::hazard_retired* retired_head_ = nullptr;
+    std::size_t pending_ = 0;
+    std::vector<const void*> protected_;
+};
+
+/**
+ * A protected, read-only pointer to the value of a hazard_slot.
+ *
+ * The value remains valid, even if the slot is updated, until the
+ * hazard_ptr is destroyed. hazard_ptrs are movable but not copyable, and
+ * each occupies one hazard record.
+ */
+template <typename T>
+class hazard_ptr {
+public:
+    hazard_ptr(hazard_ptr&& other) noexcept
+        : record_(other.record_),
+          value_(other.value_)
+    {
+        other.record_ = nullptr;
+        other.value_ = nullptr;
+    }
+
+    hazard_ptr& operator=(hazard_ptr&& other) noexcept
+    {
+        if (this != &other) {
+            reset();
+            std::swap(record_, other.record_);
+            std::swap(value_, other.value_);
+        }
+        return *this;
+    }
+
+    ~hazard_ptr() { reset(); }
+
+    const T& operator*() const noexcept { return *value_; }
+    const T* operator->() const noexcept { return value_; }
+    const T* get() const noexcept { return value_; }
+
+    /// Releases the protection early.
+    void reset() noexcept
+    {
+        if (record_) {
+            hazard_domain::release_record(record_);
+            record_ = nullptr;
+            value_ = nullptr;
+        }
+    }
+
+private:
+    template <typename U, typename A>
+    friend class hazard_slot;
+
+    hazard_ptr(hazard_domain& domain, const std::atomic<const T*>& source)
+        : record_(domain.acquire_record())
+    {
+        // Publish the hazard, then check that the pointer was not replaced
+        // (and possibly freed) before the hazard became visible
+        auto p = source.load(std::memory_order_relaxed);
+        for (;;) {
+            record_->hazard.store(p, std::memory_order_seq_cst);
+            const auto q = source.load(std::memory_order_seq_cst);
+            if (q == p) {
+                break;
+            }
+            p = q;
+        }
+        value_ = p;
+    }
+
+    detail::hazard_record* record_;
+    const T* value_;
+};
+
+/**
+ * A shared allocated_value which readers access through hazard pointers
+ * while writers replace it.
+ *
+ * protect() returns a hazard_ptr to the current value. store() and
+ * emplace() publish a replacement -- emplace() builds it with the slot's
+ * allocator -- and retire the old value to the domain. Concurrent writes
+ * are serialised.
+ */
+template <typename T, typename Alloc = std::allocator<T>>
+class hazard_slot {
+public:
+    using value_type = T;
+    using allocator_type = Alloc;
+
+    /// Constructs a slot holding initial, whose allocator the slot adopts.
+    explicit hazard_slot(allocated_value<T, Alloc> initial,
+                         hazard_domain& domain = hazard_domain::global())
+        : domain_(domain),
+          alloc_(initial.get_allocator()),
+          current_(std::move(initial)),
+          published_(std::addressof(*current_))
+    {}
+
+    hazard_slot(const hazard_slot&) = delete;
+    hazard_slot& operator=(const hazard_slot&) = delete;
+
+    /// Returns a protected pointer to the current value.
+    hazard_ptr<T> protect() const
+    {
+        return hazard_ptr<T>(domain_, published_);
+    }
+
+    /// Replaces the value, retiring the old one. next's allocator must
+    /// compare equal to get_allocator().
+    void store(allocated_value<T, Alloc> next)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            published_.store(std::addressof(*next), std::memory_order_seq_cst);
+            swap(current_, next);
+        }
+        domain_.retire(std::move(next));
+    }
+
+    /// Replaces the value with one constructed from args using the slot's
+    /// allocator, retiring the old one.
+    template <typename... Args>
+    void emplace(Args&&... args)
+    {
+        store(allocated_value<T, Alloc>(std::allocator_arg, alloc_, in_place,
+                                        std::forward<Args>(args)...));
+    }
+
+    allocator_type get_allocator() const { return alloc_; }
+
+private:
+    hazard_domain& domain_;
+    const Alloc alloc_;
+    std::mutex mutex_;
+    allocated_value<T, Alloc> current_;
+    std::atomic<const T*> published_;
+};
+
+}
+
+#endif
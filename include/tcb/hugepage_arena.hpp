@@ -0,0 +1,253 @@
+
+#ifndef TCB_HUGEPAGE_ARENA_HPP_INCLUDED
+#define TCB_HUGEPAGE_ARENA_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace tcb {
+
+/**
+ * An arena which carves single objects out of one large virtual memory
+ * reservation, backed by transparent huge pages where the system allows it.
+ *
+ * The whole reservation is mapped up front with MAP_NORESERVE, so it costs
+ * address space but no physical memory until it is touched. It is aligned
+ * to a 2MiB boundary and advised with MADV_HUGEPAGE; if that advice is
+ * refused the arena silently falls back to the system's ordinary page size.
+ *
+ * Blocks of up to max_pooled_size bytes are recycled through per-size free
+ * lists. Larger blocks are only reclaimed when they are the most recent
+ * allocation, or when the arena becomes empty.
+ *
+ * Memory is never returned to the operating system implicitly; call
+ * trim() to do so.
+ *
+ * This class is not thread safe.
+ */
+class hugepage_arena {
+    struct free_block {
+        free_block* next;
+    };
+
+public:
+    static constexpr std::size_t default_reserve_size = std::size_t{1} << 30;
+    static constexpr std::size_t huge_page_size = std::size_t{2} << 20;
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t max_pooled_size = 1024;
+
+    /**
+     * Reserves (but does not commit) reserve_size bytes of address space,
+     * rounded up to a whole number of huge pages.
+     */
+    explicit hugepage_arena(std::size_t reserve_size = default_reserve_size)
+        : reserved_(round_up(reserve_size, huge_page_size))
+    {
+        // Over-map by one huge page so that the start can be aligned
+        const auto map_size = reserved_ + huge_page_size;
+        void* p = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            detail::throw_bad_alloc();
+        }
+
+        const auto raw = reinterpret_cast<std::uintptr_t>(p);
+        const auto aligned = round_up(raw, huge_page_size);
+        if (aligned != raw) {
+            ::munmap(p, aligned - raw);
+        }
+        const auto tail = raw + map_size - (aligned + reserved_);
+        if (tail != 0) {
+            ::munmap(reinterpret_cast<void*>(aligned + reserved_), tail);
+        }
+        base_ = reinterpret_cast<char*>(aligned);
+
+#ifdef MADV_HUGEPAGE
+        huge_ = ::madvise(base_, reserved_, MADV_HUGEPAGE) == 0;
+#endif
+    }
+
+    hugepage_arena(const hugepage_arena&) = delete;
+    hugepage_arena& operator=(const hugepage_arena&) = delete;
+
+    ~hugepage_arena()
+    {
+        ::munmap(base_, reserved_);
+    }
+
+    /**
+     * Allocates bytes bytes with the given alignment. Throws std::bad_alloc
+     * if the reservation is exhausted.
+     */
+    void* allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        const auto size = block_size(bytes);
+        if (size <= max_pooled_size && alignment <= granularity) {
+            auto& head = free_lists_[size / granularity - 1];
+            if (head) {
+                auto b = head;
+                head = b->next;
+                live_ += size;
+                return b;
+            }
+        }
+
+        const auto start = round_up(top_, alignment);
+        if (start > reserved_ || reserved_ - start < size) {
+            detail::throw_bad_alloc();
+        }
+        top_ = start + size;
+        if (top_ > high_water_) {
+            high_water_ = top_;
+        }
+        live_ += size;
+        return base_ + start;
+    }
+
+    /// Returns a block previously obtained from allocate(bytes).
+    void deallocate(void* p, std::size_t bytes) noexcept
+    {
+        const auto size = block_size(bytes);
+        live_ -= size;
+
+        if (live_ == 0) {
+            reset_free_lists();
+            top_ = 0;
+        } else if (static_cast<char*>(p) + size == base_ + top_) {
+            top_ -= size;
+        } else if (size <= max_pooled_size) {
+            auto b = static_cast<free_block*>(p);
+            auto& head = free_lists_[size / granularity - 1];
+            b->next = head;
+            head = b;
+        }
+    }
+
+    /**
+     * Returns every whole page between the current allocation top and the
+     * high-water mark to the operating system, and returns the number of
+     * bytes released.
+     */
+    std::size_t trim() noexcept
+    {
+        const auto page = page_size();
+        const auto from = round_up(top_, page);
+        const auto to = round_up(high_water_, page);
+        if (to <= from) {
+            return 0;
+        }
+        ::madvise(base_ + from, to - from, MADV_DONTNEED);
+        high_water_ = from;
+        return to - from;
+    }
+
+    /// Returns true if the kernel accepted the MADV_HUGEPAGE advice.
+    bool uses_huge_pages() const noexcept { return huge_; }
+
+    /// Returns the start of the reserved region.
+    void* data() const noexcept { return base_; }
+
+    /// Returns the size of the reserved region in bytes.
+    std::size_t reserved() const noexcept { return reserved_; }
+
+    /// Returns the number of bytes in live allocations.
+    std::size_t live() const noexcept { return live_; }
+
+    /// Returns the offset of the allocation top from the start of the region.
+    std::size_t used() const noexcept { return top_; }
+
+    bool operator==(const hugepage_arena& other) const noexcept { return this == &other; }
+    bool operator!=(const hugepage_arena& other) const noexcept { return this != &other; }
+
+private:
+    static std::size_t round_up(std::size_t n, std::size_t to) noexcept
+    {
+        return (n + to - 1) / to * to;
+    }
+
+    static std::size_t block_size(std::size_t bytes) noexcept
+    {
+        return bytes == 0 ? granularity : round_up(bytes, granularity);
+    }
+
+    std::size_t page_size() const noexcept
+    {
+        return huge_ ? huge_page_size : static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    }
+
+    void reset_free_lists() noexcept
+    {
+        for (auto& head : free_lists_) {
+            head = nullptr;
+        }
+    }
+
+    char* base_ = nullptr;
+    std::size_t reserved_;
+    std::size_t top_ = 0;
+    std::size_t high_water_ = 0;
+    std::size_t live_ = 0;
+    bool huge_ = false;
+    free_block* free_lists_[max_pooled_size / granularity] = {};
+};
+
+/**
+ * An allocator which obtains memory from a hugepage_arena.
+ *
+ * Like hh::short_alloc, the allocator holds a reference to its arena, which
+ * must outlive every allocation made from it. Two arena_allocators compare
+ * equal if they share an arena.
+ */
+template <typename T>
+class arena_allocator {
+public:
+    using value_type = T;
+
+    arena_allocator(hugepage_arena& arena) noexcept
+        : arena_(&arena)
+    {}
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) noexcept
+        : arena_(&other.arena())
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+            detail::throw_bad_alloc();
+        }
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        arena_->deallocate(p, n * sizeof(T));
+    }
+
+    hugepage_arena& arena() const noexcept { return *arena_; }
+
+private:
+    hugepage_arena* arena_;
+};
+
+template <typename T, typename U>
+bool operator==(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) noexcept
+{
+    return &lhs.arena() == &rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const arena_allocator<T>& lhs, const arena_allocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+}
+
+#endif
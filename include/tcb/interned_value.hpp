@@ -0,0 +1,288 @@
+
+#ifndef TCB_INTERNED_VALUE_HPP_INCLUDED
+#define TCB_INTERNED_VALUE_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace tcb {
+
+template <typename T, typename Hash = std::hash<T>,
+          typename KeyEqual = std::equal_to<T>, typename Alloc = std::allocator<T>>
+class intern_pool;
+
+namespace detail {
+
+template <typename T>
+struct intern_node {
+    template <typename... Args>
+    explicit intern_node(std::size_t hash, Args&&... args)
+        : value(std::forward<Args>(args)...),
+          hash(hash)
+    {}
+
+    const T value;
+    const std::size_t hash;
+    std::atomic<std::size_t> refs{1};
+};
+
+}
+
+/**
+ * A shared, immutable handle to a value owned by an intern_pool.
+ *
+ * Handles to equal values obtained from the same pool refer to the same
+ * object, so comparing them is a pointer comparison, and hashing them reads
+ * a hash computed once when the value was interned. Copying a handle bumps
+ * a reference count; when the last handle to a value is destroyed the value
+ * is removed from the pool.
+ *
+ * The pool must outlive all of its handles.
+ */
+template <typename T, typename Hash = std::hash<T>,
+          typename KeyEqual = std::equal_to<T>, typename Alloc = std::allocator<T>>
+class interned {
+    using pool_type = intern_pool<T, Hash, KeyEqual, Alloc>;
+    using node_type = detail::intern_node<T>;
+
+    friend pool_type;
+
+public:
+    using value_type = T;
+
+    interned(const interned& other) noexcept
+        : node_(other.node_),
+          pool_(other.pool_)
+    {
+        node_->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    interned(interned&& other) noexcept
+        : node_(other.node_),
+          pool_(other.pool_)
+    {
+        other.node_ = nullptr;
+    }
+
+    interned& operator=(interned other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    ~interned()
+    {
+        if (node_) {
+            pool_->release(node_);
+        }
+    }
+
+    void swap(interned& other) noexcept
+    {
+        std::swap(node_, other.node_);
+        std::swap(pool_, other.pool_);
+    }
+
+    /// Access the shared value.
+    const T& get() const noexcept { return node_->value; }
+    /// @overload
+    const T& operator*() const noexcept { return node_->value; }
+    /// Member access.
+    const T* operator->() const noexcept { return std::addressof(node_->value); }
+
+    /// Returns the hash of the value, as computed by the pool's Hash.
+    std::size_t hash() const noexcept { return node_->hash; }
+
+    /**
+     * Compares two handles. Handles from the same pool are equal if and only
+     * if they refer to the same object; handles from different pools fall
+     * back to comparing the values.
+     */
+    friend bool operator==(const interned& lhs, const interned& rhs)
+    {
+        if (lhs.node_ == rhs.node_) {
+            return true;
+        }
+        return lhs.pool_ != rhs.pool_ && lhs.node_->hash == rhs.node_->hash &&
+               KeyEqual{}(lhs.get(), rhs.get());
+    }
+
+    friend bool operator!=(const interned& lhs, const interned& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    interned(node_type* node, pool_type* pool) noexcept
+        : node_(node),
+          pool_(pool)
+    {}
+
+    node_type* node_;
+    pool_type* pool_;
+};
+
+template <typename T, typename H, typename E, typename A>
+void swap(interned<T, H, E, A>& first, interned<T, H, E, A>& second) noexcept
+{
+    first.swap(second);
+}
+
+/**
+ * A hash-consing factory which stores a single copy of each distinct value.
+ *
+ * intern() returns an interned<T> handle to the pool's copy of its
+ * argument, adding one if no equal value is present. Values are stored in
+ * allocated_values using a rebound copy of the supplied allocator, and are
+ * erased once the last handle referring to them is destroyed.
+ *
+ * The table is split into independently-locked shards chosen by hash, so
+ * that threads interning different values rarely contend. intern() may be
+ * called concurrently from any number of threads.
+ */
+template <typename T, typename Hash, typename KeyEqual, typename Alloc>
+class intern_pool {
+    using node_type = detail::intern_node<T>;
+    using node_alloc = typename std::allocator_traits<Alloc>::template rebind_alloc<node_type>;
+    using node_value = allocated_value<node_type, node_alloc>;
+    using map_alloc = typename std::allocator_traits<Alloc>::template
+            rebind_alloc<std::pair<const std::size_t, node_value>>;
+    using map_type = std::unordered_multimap<std::size_t, node_value,
+                                             std::hash<std::size_t>,
+                                             std::equal_to<std::size_t>, map_alloc>;
+
+    friend class interned<T, Hash, KeyEqual, Alloc>;
+
+public:
+    using value_type = T;
+    using handle = interned<T, Hash, KeyEqual, Alloc>;
+    using allocator_type = Alloc;
+
+    static constexpr std::size_t num_shards = 64;
+
+    explicit intern_pool(const Alloc& alloc = Alloc{}, const Hash& hash = Hash{},
+                         const KeyEqual& eq = KeyEqual{})
+        : alloc_(alloc),
+          hash_(hash),
+          eq_(eq)
+    {
+        for (auto& s : shards_) {
+            s.map = map_type(0, std::hash<std::size_t>{}, std::equal_to<std::size_t>{},
+                             map_alloc(alloc));
+        }
+    }
+
+    intern_pool(const intern_pool&) = delete;
+    intern_pool& operator=(const intern_pool&) = delete;
+
+    /// Returns a handle to the pool's copy of value, inserting it if needed.
+    handle intern(const T& value)
+    {
+        return do_intern(value);
+    }
+
+    /// @overload
+    handle intern(T&& value)
+    {
+        return do_intern(std::move(value));
+    }
+
+    /// Returns the number of distinct values currently held.
+    std::size_t size() const
+    {
+        std::size_t n = 0;
+        for (auto& s : shards_) {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            n += s.map.size();
+        }
+        return n;
+    }
+
+    allocator_type get_allocator() const { return alloc_; }
+
+private:
+    struct alignas(64) shard {
+        mutable std::mutex mutex;
+        map_type map;
+    };
+
+    shard& shard_for(std::size_t h) noexcept
+    {
+        // Mix the hash so that weak hashes (e.g. the identity hash for
+        // integers) still spread across shards
+        return shards_[(h * 0x9E3779B97F4A7C15ull >> 32) % num_shards];
+    }
+
+    template <typename U>
+    handle do_intern(U&& value)
+    {
+        const std::size_t h = hash_(value);
+        auto& s = shard_for(h);
+
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto range = s.map.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            node_type& n = *it->second;
+            if (eq_(n.value, value)) {
+                n.refs.fetch_add(1, std::memory_order_relaxed);
+                return handle(std::addressof(n), this);
+            }
+        }
+
+        auto it = s.map.emplace(h, allocate_allocated_value<node_type>(
+                node_alloc(alloc_), h, std::forward<U>(value)));
+        return handle(std::addressof(*it->second), this);
+    }
+
+    void release(node_type* node) noexcept
+    {
+        // Read the hash first: once our reference is dropped another
+        // thread may free the node
+        const auto h = node->hash;
+        if (node->refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+
+        // The value may have been re-interned (or even erased and replaced)
+        // between the decrement and taking the lock, so look it up again
+        // by address and only erase it if it is still unreferenced
+        auto& s = shard_for(h);
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto range = s.map.equal_range(h);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (std::addressof(*it->second) == node) {
+                if (node->refs.load(std::memory_order_acquire) == 0) {
+                    s.map.erase(it);
+                }
+                return;
+            }
+        }
+    }
+
+    Alloc alloc_;
+    Hash hash_;
+    KeyEqual eq_;
+    shard shards_[num_shards];
+};
+
+}
+
+namespace std {
+
+template <typename T, typename H, typename E, typename A>
+struct hash<::tcb::interned<T, H, E, A>> {
+    std::size_t operator()(const ::tcb::interned<T, H, E, A>& value) const noexcept
+    {
+        return value.hash();
+    }
+};
+
+}
+
+#endif
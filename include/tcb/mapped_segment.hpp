@@ -0,0 +1,525 @@
+
+#ifndef TCB_MAPPED_SEGMENT_HPP_INCLUDED
+#define TCB_MAPPED_SEGMENT_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+#include "offset_ptr.hpp"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tcb {
+
+/// Thrown when a mapped_segment file is missing, corrupt or incompatible.
+struct mapped_segment_error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+namespace detail {
+
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+#define TRY
+#define CATCH(X) if (false)
+#define THROW
+#else
+#define TRY try
+#define CATCH catch
+#define THROW throw
+#endif
+
+// Without exceptions, errors are printed and the program aborts
+[[noreturn]] inline void throw_segment_error(const std::string& what)
+{
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+    std::fprintf(stderr, "mapped_segment: %s\n", what.c_str());
+    std::abort();
+#else
+    throw mapped_segment_error(what);
+#endif
+}
+
+[[noreturn]] inline void throw_system_error(int err, const std::string& what)
+{
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+    std::fprintf(stderr, "mapped_segment: %s: %s\n", what.c_str(), std::strerror(err));
+    std::abort();
+#else
+    throw std::system_error(err, std::generic_category(), what);
+#endif
+}
+
+/*
+ * The header at the start of every mapped segment file. Everything in it is
+ * position independent: blocks are identified by their offset from the
+ * start of the file, with zero meaning "none".
+ */
+struct segment_header {
+    static constexpr std::uint64_t magic_value = 0x314745534c415643ull;
+    static constexpr std::uint32_t format_version = 2;
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t num_free_lists = 64;
+    static constexpr std::size_t max_roots = 32;
+    static constexpr std::size_t max_root_name = 48;
+
+    struct root_entry {
+        char name[max_root_name];
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint64_t align;
+    };
+
+    std::uint64_t magic;
+    std::uint32_t version;
+    std::uint32_t user_version;
+    std::uint64_t size;
+    std::uint64_t top;
+    std::uint64_t clean;
+    std::uint64_t free_lists[num_free_lists];
+    root_entry roots[max_roots];
+    std::uint64_t checksum;
+
+    char* base() noexcept { return reinterpret_cast<char*>(this); }
+
+    static std::size_t block_size(std::size_t bytes) noexcept
+    {
+        return bytes == 0 ? granularity : (bytes + granularity - 1) / granularity * granularity;
+    }
+
+    static std::size_t data_start() noexcept
+    {
+        return block_size(sizeof(segment_header));
+    }
+
+    void* allocate(std::size_t bytes, std::size_t alignment)
+    {
+        clean = 0;
+        const auto size = block_size(bytes);
+        const auto cls = size / granularity - 1;
+        if (cls < num_free_lists && alignment <= granularity && free_lists[cls] != 0) {
+            const auto off = free_lists[cls];
+            std::memcpy(&free_lists[cls], base() + off, sizeof(std::uint64_t));
+            return base() + off;
+        }
+
+        const auto start = (top + alignment - 1) / alignment * alignment;
+        if (start > this->size || this->size - start < size) {
+            throw_bad_alloc();
+        }
+        top = start + size;
+        return base() + start;
+    }
+
+    void deallocate(void* p, std::size_t bytes) noexcept
+    {
+        clean = 0;
+        const auto size = block_size(bytes);
+        const auto off = static_cast<std::uint64_t>(static_cast<char*>(p) - base());
+        if (off + size == top) {
+            top = off;
+            return;
+        }
+        // Blocks too large for a free list are leaked until the segment
+        // is recreated
+        const auto cls = size / granularity - 1;
+        if (cls < num_free_lists) {
+            std::memcpy(base() + off, &free_lists[cls], sizeof(std::uint64_t));
+            free_lists[cls] = off;
+        }
+    }
+
+    // FNV-1a over the header, except the checksum itself, and over the
+    // root objects. Entries lying outside the segment are skipped, and
+    // leave the mismatch to be caught.
+    std::uint64_t compute_checksum() const noexcept
+    {
+        std::uint64_t h = 0xcbf29ce484222325ull;
+        h = hash_bytes(h, this, offsetof(segment_header, checksum));
+        for (const auto& e : roots) {
+            if (e.offset != 0 && e.offset <= size && e.size <= size - e.offset) {
+                h = hash_bytes(h, reinterpret_cast<const char*>(this) + e.offset, e.size);
+            }
+        }
+        return h;
+    }
+
+    static std::uint64_t hash_bytes(std::uint64_t h, const void* p, std::size_t n) noexcept
+    {
+        auto bytes = static_cast<const unsigned char*>(p);
+        for (std::size_t i = 0; i < n; i++) {
+            h = (h ^ bytes[i]) * 0x100000001b3ull;
+        }
+        return h;
+    }
+};
+
+}
+
+/**
+ * An allocator which obtains memory from a mapped_segment.
+ *
+ * The allocator's pointer type is offset_ptr<T>, and it refers to its
+ * segment through an offset_ptr too, so an allocated_value using a
+ * mapped_allocator can itself be stored inside the segment and remain valid
+ * when the file is mapped again at a different address.
+ *
+ * Two mapped_allocators compare equal if they refer to the same segment.
+ */
+template <typename T>
+class mapped_allocator {
+    template <typename U>
+    friend class mapped_allocator;
+
+public:
+    using value_type = T;
+    using pointer = offset_ptr<T>;
+    using const_pointer = offset_ptr<const T>;
+    using void_pointer = offset_ptr<void>;
+    using const_void_pointer = offset_ptr<const void>;
+    using difference_type = std::ptrdiff_t;
+    using size_type = std::size_t;
+
+    explicit mapped_allocator(detail::segment_header* header) noexcept
+        : header_(header)
+    {}
+
+    template <typename U>
+    mapped_allocator(const mapped_allocator<U>& other) noexcept
+        : header_(other.header_)
+    {}
+
+    pointer allocate(std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+            detail::throw_bad_alloc();
+        }
+        return pointer(static_cast<T*>(header_->allocate(n * sizeof(T), alignof(T))));
+    }
+
+    void deallocate(pointer p, std::size_t n) noexcept
+    {
+        header_->deallocate(p.get(), n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const mapped_allocator<U>& other) const noexcept
+    {
+        return header_ == other.header_;
+    }
+
+    template <typename U>
+    bool operator!=(const mapped_allocator<U>& other) const noexcept
+    {
+        return header_ != other.header_;
+    }
+
+private:
+    offset_ptr<detail::segment_header> header_;
+};
+
+/**
+ * A file-backed heap whose contents survive process restarts.
+ *
+ * A mapped_segment maps a file into memory with MAP_SHARED and allocates
+ * from it through mapped_allocator. Objects are published under a name
+ * with construct_root(), and can be retrieved by a later process with
+ * find_root(), without any deserialisation step.
+ *
+ * Objects stored in a segment must not contain raw pointers: any memory
+ * they own should be allocated from the segment via a mapped_allocator,
+ * such as a tcb::allocated_value<T, tcb::mapped_allocator<T>>.
+ *
+ * When a segment is opened, the header's magic number, format version and
+ * size are checked, along with the caller's own user_version. A segment
+ * which was closed cleanly also has its checksum verified; one which was
+ * not (because the process crashed, for example) has its allocator
+ * metadata checked for consistency instead. A mapped_segment_error is
+ * thrown if any check fails, or the program aborts if exceptions are
+ * disabled.
+ *
+ * The checksum covers the header, with the root registry, and the root
+ * objects themselves, but not the blocks they own elsewhere in the
+ * segment: corruption there is not detected.
+ *
+ * This class is not thread safe.
+ */
+class mapped_segment {
+    using header_t = detail::segment_header;
+
+public:
+    /**
+     * Opens the segment stored at path, creating it with the given size if
+     * it does not exist.
+     */
+    mapped_segment(const std::string& path, std::size_t size,
+                   std::uint32_t user_version = 0)
+    {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) {
+            detail::throw_system_error(errno, path);
+        }
+
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            fail_errno(path);
+        }
+
+        const bool create = st.st_size == 0;
+        if (create) {
+            if (size < header_t::data_start()) {
+                size = header_t::data_start();
+            }
+            if (::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+                fail_errno(path);
+            }
+        } else {
+            size = static_cast<std::size_t>(st.st_size);
+        }
+        size_ = size;
+
+        void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED) {
+            fail_errno(path);
+        }
+        header_ = static_cast<header_t*>(p);
+
+        if (create) {
+            std::memset(header_, 0, sizeof(header_t));
+            header_->magic = header_t::magic_value;
+            header_->version = header_t::format_version;
+            header_->user_version = user_version;
+            header_->size = size_;
+            header_->top = header_t::data_start();
+        } else {
+            validate(path, user_version);
+        }
+    }
+
+    mapped_segment(const mapped_segment&) = delete;
+    mapped_segment& operator=(const mapped_segment&) = delete;
+
+    /// Marks the segment as cleanly closed, flushes it and unmaps it.
+    ~mapped_segment()
+    {
+        if (header_) {
+            flush();
+            ::munmap(header_, size_);
+        }
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    /**
+     * Writes all changes back to the file, marking the segment clean. The
+     * mark is cleared by the next allocation or deallocation, so a segment
+     * which is not modified after a flush reopens with a checksum check,
+     * even if the process then crashes.
+     */
+    void flush()
+    {
+        header_->clean = 1;
+        header_->checksum = header_->compute_checksum();
+        ::msync(header_, size_, MS_SYNC);
+    }
+
+    /// Returns an allocator which allocates from this segment.
+    template <typename T = char>
+    mapped_allocator<T> get_allocator() const noexcept
+    {
+        return mapped_allocator<T>(header_);
+    }
+
+    /**
+     * Constructs a T in the segment from the given arguments and registers
+     * it under name. Throws mapped_segment_error if the name is already in
+     * use or the registry is full.
+     */
+    template <typename T, typename... Args>
+    T& construct_root(const std::string& name, Args&&... args)
+    {
+        if (name.size() >= header_t::max_root_name) {
+            detail::throw_segment_error("root name too long: " + name);
+        }
+        if (find_entry(name)) {
+            detail::throw_segment_error("root already exists: " + name);
+        }
+
+        header_t::root_entry* slot = nullptr;
+        for (auto& e : header_->roots) {
+            if (e.offset == 0) {
+                slot = &e;
+                break;
+            }
+        }
+        if (!slot) {
+            detail::throw_segment_error("too many roots");
+        }
+
+        void* p = header_->allocate(sizeof(T), alignof(T));
+        T* obj = nullptr;
+        TRY {
+            obj = ::new (p) T(std::forward<Args>(args)...);
+        } CATCH (...) {
+            header_->deallocate(p, sizeof(T));
+            THROW;
+        }
+
+        std::memset(slot->name, 0, sizeof(slot->name));
+        std::memcpy(slot->name, name.data(), name.size());
+        slot->size = sizeof(T);
+        slot->align = alignof(T);
+        slot->offset = static_cast<std::uint64_t>(static_cast<char*>(p) - header_->base());
+        return *obj;
+    }
+
+    /**
+     * Returns the root object registered under name, or nullptr if there is
+     * none. Throws mapped_segment_error if the stored object's size or
+     * alignment does not match T.
+     */
+    template <typename T>
+    T* find_root(const std::string& name) const
+    {
+        auto e = find_entry(name);
+        if (!e) {
+            return nullptr;
+        }
+        if (e->size != sizeof(T) || e->align != alignof(T)) {
+            detail::throw_segment_error("root type mismatch: " + name);
+        }
+        return reinterpret_cast<T*>(header_->base() + e->offset);
+    }
+
+    /// Destroys and unregisters the root registered under name, if any.
+    template <typename T>
+    void destroy_root(const std::string& name)
+    {
+        if (auto obj = find_root<T>(name)) {
+            obj->~T();
+            header_->deallocate(obj, sizeof(T));
+            auto e = find_entry(name);
+            std::memset(e, 0, sizeof(*e));
+        }
+    }
+
+    /**
+     * Checks the allocator metadata and root registry for consistency,
+     * returning false if any offset lies outside the segment or a free
+     * list is cyclic.
+     */
+    bool check() const noexcept
+    {
+        const auto start = header_t::data_start();
+        if (header_->top < start || header_->top > header_->size) {
+            return false;
+        }
+        for (std::size_t i = 0; i < header_t::num_free_lists; i++) {
+            const auto block = (i + 1) * header_t::granularity;
+            auto off = header_->free_lists[i];
+            std::size_t steps = 0;
+            while (off != 0) {
+                if (off < start || off + block > header_->top ||
+                    ++steps > header_->size / header_t::granularity) {
+                    return false;
+                }
+                std::memcpy(&off, header_->base() + off, sizeof(off));
+            }
+        }
+        for (const auto& e : header_->roots) {
+            if (e.offset != 0 && (e.offset < start || e.offset + e.size > header_->top)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// Returns the size of the segment in bytes.
+    std::size_t size() const noexcept { return size_; }
+
+    /// Returns the number of bytes below the allocation top.
+    std::size_t used() const noexcept { return static_cast<std::size_t>(header_->top); }
+
+    /// Returns the user version the segment was created with.
+    std::uint32_t user_version() const noexcept { return header_->user_version; }
+
+private:
+    [[noreturn]] void fail_errno(const std::string& what)
+    {
+        const int err = errno;
+        ::close(fd_);
+        fd_ = -1;
+        detail::throw_system_error(err, what);
+    }
+
+    [[noreturn]] void fail(const std::string& what)
+    {
+        ::munmap(header_, size_);
+        header_ = nullptr;
+        ::close(fd_);
+        fd_ = -1;
+        detail::throw_segment_error(what);
+    }
+
+    void validate(const std::string& path, std::uint32_t user_version)
+    {
+        if (size_ < sizeof(header_t) || header_->magic != header_t::magic_value) {
+            fail(path + ": not a mapped segment");
+        }
+        if (header_->version != header_t::format_version) {
+            fail(path + ": unsupported format version " + std::to_string(header_->version));
+        }
+        if (header_->user_version != user_version) {
+            fail(path + ": user version " + std::to_string(header_->user_version) +
+                 " does not match expected version " + std::to_string(user_version));
+        }
+        if (header_->size != size_) {
+            fail(path + ": file size does not match header");
+        }
+        if (header_->clean == 1 && header_->checksum != header_->compute_checksum()) {
+            fail(path + ": header checksum mismatch");
+        }
+        if (!check()) {
+            fail(path + ": segment metadata is inconsistent");
+        }
+    }
+
+    const header_t::root_entry* find_entry(const std::string& name) const noexcept
+    {
+        for (const auto& e : header_->roots) {
+            if (e.offset != 0 && std::strncmp(e.name, name.c_str(), sizeof(e.name)) == 0) {
+                return &e;
+            }
+        }
+        return nullptr;
+    }
+
+    header_t::root_entry* find_entry(const std::string& name) noexcept
+    {
+        return const_cast<header_t::root_entry*>(
+                static_cast<const mapped_segment*>(this)->find_entry(name));
+    }
+
+    int fd_ = -1;
+    std::size_t size_ = 0;
+    header_t* header_ = nullptr;
+};
+
+}
+
+#undef TRY
+#undef CATCH
+#undef THROW
+
+#endif
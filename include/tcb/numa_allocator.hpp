@@ -0,0 +1,500 @@
+
+#ifndef TCB_NUMA_ALLOCATOR_HPP_INCLUDED
+#define TCB_NUMA_ALLOCATOR_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+
+namespace tcb {
+
+/**
+ * The machine's NUMA nodes and the CPUs belonging to each, as described by
+ * sysfs.
+ *
+ * Each directory nodeN under the sysfs root is one node, and its cpulist
+ * file lists that node's CPUs (for example "0-7,16-23"). If the root does
+ * not exist -- on non-Linux systems, or in containers which hide it -- the
+ * topology is a single node 0 containing every CPU.
+ */
+class numa_topology {
+public:
+    explicit numa_topology(const std::string& sysfs_root = "/sys/devices/system/node")
+    {
+        if (DIR* dir = ::opendir(sysfs_root.c_str())) {
+            while (const dirent* entry = ::readdir(dir)) {
+                int id;
+                char tail;
+                if (std::sscanf(entry->d_name, "node%d%c", &id, &tail) == 1 && id >= 0) {
+                    add_node(id, read_file(sysfs_root + "/" + entry->d_name + "/cpulist"));
+                }
+            }
+            ::closedir(dir);
+        }
+        if (nodes_.empty()) {
+            nodes_.push_back(0);
+        }
+        std::sort(nodes_.begin(), nodes_.end());
+    }
+
+    /// Returns the topology of this machine.
+    static const numa_topology& system()
+    {
+        static const numa_topology topology;
+        return topology;
+    }
+
+    /// Returns the ids of the nodes, in ascending order.
+    const std::vector<int>& nodes() const noexcept { return nodes_; }
+
+    std::size_t node_count() const noexcept { return nodes_.size(); }
+
+    /// Returns true if there is more than one node.
+    bool is_numa() const noexcept { return nodes_.size() > 1; }
+
+    /// Returns the node containing cpu, or the first node if it is unknown.
+    int node_of_cpu(unsigned cpu) const noexcept
+    {
+        return cpu < cpu_nodes_.size() && cpu_nodes_[cpu] >= 0 ? cpu_nodes_[cpu] : nodes_.front();
+    }
+
+    /// Returns the node of the CPU the calling thread is running on.
+    int current_node() const noexcept
+    {
+#if defined(__linux__)
+        const int cpu = ::sched_getcpu();
+        if (cpu >= 0) {
+            return node_of_cpu(static_cast<unsigned>(cpu));
+        }
+#endif
+        return nodes_.front();
+    }
+
+    /// Returns the position of node in nodes(), or 0 if it is not a node.
+    std::size_t index_of(int node) const noexcept
+    {
+        const auto it = std::lower_bound(nodes_.begin(), nodes_.end(), node);
+        return it != nodes_.end() && *it == node ? std::size_t(it - nodes_.begin()) : 0;
+    }
+
+private:
+    static std::string read_file(const std::string& path)
+    {
+        std::string contents;
+        if (std::FILE* f = std::fopen(path.c_str(), "r")) {
+            char buf[256];
+            std::size_t n;
+            while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0) {
+                contents.append(buf, n);
+            }
+            std::fclose(f);
+        }
+        return contents;
+    }
+
+    // Parses a cpulist such as "0-3,8,10-11"
+    void add_node(int id, const std::string& cpulist)
+    {
+        nodes_.push_back(id);
+        const char* p = cpulist.c_str();
+        while (*p) {
+            unsigned first, last;
+            int used;
+            if (std::sscanf(p, "%u-%u%n", &first, &last, &used) == 2) {
+                p += used;
+            } else if (std::sscanf(p, "%u%n", &first, &used) == 1) {
+                last = first;
+                p += used;
+            } else {
+                break;
+            }
+            if (last >= cpu_nodes_.size()) {
+                cpu_nodes_.resize(last + 1, -1);
+            }
+            for (unsigned cpu = first; cpu <= last; ++cpu) {
+                cpu_nodes_[cpu] = id;
+            }
+            if (*p == ',') {
+                ++p;
+            }
+        }
+    }
+
+    std::vector<int> nodes_;
+    std::vector<int> cpu_nodes_;
+};
+
+/**
+ * Per-node memory arenas.
+ *
+ * Memory is obtained from the operating system in chunk_size chunks, each
+ * belonging to one node. On a machine with more than one node each chunk
+ * is bound to its node with mbind(MPOL_PREFERRED), so that its pages are
+ * placed there when first touched but may spill to other nodes rather than
+ * fail when the node is full. If binding fails, or there is only one node,
+ * chunks are left to the kernel's default policy and everything else works
+ * as before.
+ *
+ * Blocks of up to max_block_size bytes are carved from the chunks and
+ * recycled through per-size free lists; larger blocks get a mapping of
+ * their own. Any block may be freed from any thread. Each node has its own
+ * lock, so threads allocating on different nodes do not contend.
+ *
+ * Memory is returned to the operating system when the arena is destroyed.
+ */
+class numa_arena {
+    struct free_block {
+        free_block* next;
+    };
+
+    // Placed at the start of each chunk and large-block mapping
+    struct chunk_header {
+        numa_arena* owner;
+        int node;
+        std::size_t size;
+        chunk_header* next;
+        chunk_header* prev;
+    };
+
+    struct node_arena {
+        std::mutex mutex;
+        chunk_header* chunks = nullptr;
+        char* top = nullptr;
+        char* end = nullptr;
+        free_block* free_lists[256] = {};
+    };
+
+public:
+    static constexpr std::size_t chunk_size = std::size_t{1} << 20;
+    static constexpr std::size_t granularity = 16;
+    static constexpr std::size_t max_block_size = 4096;
+
+    /// Creates an arena for the given topology, which is copied.
+    explicit numa_arena(numa_topology topology = numa_topology::system())
+        : topology_(std::move(topology))
+    {
+        for (std::size_t i = 0; i < topology_.node_count(); ++i) {
+            nodes_.emplace_back(new node_arena);
+        }
+    }
+
+    numa_arena(const numa_arena&) = delete;
+    numa_arena& operator=(const numa_arena&) = delete;
+
+    ~numa_arena()
+    {
+        for (auto& n : nodes_) {
+            unmap_all(n->chunks);
+        }
+        unmap_all(large_);
+    }
+
+    /// Returns an arena for this machine's topology.
+    static numa_arena& system()
+    {
+        static numa_arena arena;
+        return arena;
+    }
+
+    const numa_topology& topology() const noexcept { return topology_; }
+
+    /**
+     * Allocates bytes bytes, aligned to granularity, from the given node's
+     * memory. If node is negative, the calling thread's current node is
+     * used.
+     */
+    void* allocate(std::size_t bytes, int node = -1)
+    {
+        if (node < 0) {
+            node = topology_.current_node();
+        }
+        if (bytes > max_block_size) {
+            return map_chunk(header_size + bytes, node, nullptr) + header_size;
+        }
+
+        const auto size = block_size(bytes);
+        auto& n = *nodes_[topology_.index_of(node)];
+        std::lock_guard<std::mutex> lock(n.mutex);
+        auto& head = n.free_lists[size / granularity - 1];
+        if (head) {
+            auto b = head;
+            head = b->next;
+            return b;
+        }
+        if (!n.top || n.end - n.top < static_cast<std::ptrdiff_t>(size)) {
+            const auto c = map_chunk(chunk_size, node, &n);
+            n.top = c + header_size;
+            n.end = c + chunk_size;
+        }
+        const auto p = n.top;
+        n.top += size;
+        return p;
+    }
+
+    /// Returns a block previously obtained from allocate(bytes), from any
+    /// thread.
+    void deallocate(void* p, std::size_t bytes) noexcept
+    {
+        const auto c = chunk_of(p);
+        if (bytes > max_block_size) {
+            {
+                std::lock_guard<std::mutex> lock(large_mutex_);
+                if (c->prev) {
+                    c->prev->next = c->next;
+                } else {
+                    large_ = c->next;
+                }
+                if (c->next) {
+                    c->next->prev = c->prev;
+                }
+            }
+            ::munmap(c, c->size);
+            return;
+        }
+        const auto size = block_size(bytes);
+        auto& n = *nodes_[topology_.index_of(c->node)];
+        std::lock_guard<std::mutex> lock(n.mutex);
+        auto b = static_cast<free_block*>(p);
+        auto& head = n.free_lists[size / granularity - 1];
+        b->next = head;
+        head = b;
+    }
+
+    /// Returns the node from whose memory p, a block from any numa_arena,
+    /// was allocated.
+    static int node_of(const void* p) noexcept { return chunk_of(p)->node; }
+
+    /// Returns the number of chunks which could not be bound to their node.
+    std::size_t bind_failures() const noexcept
+    {
+        return bind_failures_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr std::size_t header_size =
+            (sizeof(chunk_header) + granularity - 1) / granularity * granularity;
+
+    static std::size_t block_size(std::size_t bytes) noexcept
+    {
+        return bytes == 0 ? granularity : (bytes + granularity - 1) / granularity * granularity;
+    }
+
+    // Chunks and large mappings are aligned to chunk_size, and every block
+    // starts within the first chunk_size bytes of its mapping, so masking
+    // finds the header
+    static chunk_header* chunk_of(const void* p) noexcept
+    {
+        const auto addr = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<chunk_header*>(addr & ~std::uintptr_t(chunk_size - 1));
+    }
+
+    // Maps at least size bytes aligned to chunk_size, binds them to node,
+    // and links them into n's chunk list, or into the list of large blocks
+    // if n is null
+    char* map_chunk(std::size_t size, int node, node_arena* n)
+    {
+        const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+        size = (size + page - 1) / page * page;
+
+        const auto map_size = size + chunk_size;
+        void* p = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            detail::throw_bad_alloc();
+        }
+        const auto raw = reinterpret_cast<std::uintptr_t>(p);
+        const auto aligned = (raw + chunk_size - 1) & ~std::uintptr_t(chunk_size - 1);
+        if (aligned != raw) {
+            ::munmap(p, aligned - raw);
+        }
+        const auto tail = raw + map_size - (aligned + size);
+        if (tail != 0) {
+            ::munmap(reinterpret_cast<void*>(aligned + size), tail);
+        }
+
+        const auto base = reinterpret_cast<char*>(aligned);
+        if (topology_.is_numa() && !bind(base, size, node)) {
+            bind_failures_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Header writes happen after binding, so they fault in the right place
+        auto c = ::new (static_cast<void*>(base)) chunk_header{this, node, size, nullptr, nullptr};
+        if (n) {
+            c->next = n->chunks;
+            n->chunks = c;
+        } else {
+            std::lock_guard<std::mutex> lock(large_mutex_);
+            c->next = large_;
+            if (large_) {
+                large_->prev = c;
+            }
+            large_ = c;
+        }
+        return base;
+    }
+
+    static void unmap_all(chunk_header* c) noexcept
+    {
+        while (c) {
+            const auto next = c->next;
+            ::munmap(c, c->size);
+            c = next;
+        }
+    }
+
+    static bool bind(void* p, std::size_t size, int node) noexcept
+    {
+#if defined(__linux__) && defined(SYS_mbind)
+        constexpr int mpol_preferred = 1;
+        constexpr std::size_t bits = 8 * sizeof(unsigned long);
+        unsigned long mask[1024 / bits] = {};
+        if (node < 0 || static_cast<std::size_t>(node) >= 1024) {
+            return false;
+        }
+        mask[node / bits] = 1ul << (node % bits);
+        return ::syscall(SYS_mbind, p, size, mpol_preferred, mask, 1024, 0) == 0;
+#else
+        (void) p;
+        (void) size;
+        (void) node;
+        return false;
+#endif
+    }
+
+    numa_topology topology_;
+    std::vector<std::unique_ptr<node_arena>> nodes_;
+    std::mutex large_mutex_;
+    chunk_header* large_ = nullptr;
+    std::atomic<std::size_t> bind_failures_{0};
+};
+
+/**
+ * An allocator which places objects in a particular NUMA node's memory,
+ * using a numa_arena.
+ *
+ * A default-constructed numa_allocator allocates from the node of the CPU
+ * which calls allocate(). Allocators using the same arena compare equal,
+ * whichever node they target, and propagate with the values they
+ * allocated, so that an allocated_value keeps its node preference when it
+ * is moved or swapped.
+ */
+template <typename T>
+class numa_allocator {
+    static_assert(alignof(T) <= numa_arena::granularity,
+                  "numa_allocator does not support over-aligned types");
+
+    template <typename U>
+    friend class numa_allocator;
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    /// The node argument meaning "wherever the allocating thread runs".
+    static constexpr int local_node = -1;
+
+    numa_allocator() noexcept
+        : arena_(&numa_arena::system())
+    {}
+
+    /// Allocates from node, or locally if node is local_node.
+    explicit numa_allocator(int node, numa_arena& arena = numa_arena::system()) noexcept
+        : arena_(&arena), node_(node)
+    {}
+
+    template <typename U>
+    numa_allocator(const numa_allocator<U>& other) noexcept
+        : arena_(other.arena_), node_(other.node_)
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) {
+            detail::throw_bad_alloc();
+        }
+        return static_cast<T*>(arena_->allocate(n * sizeof(T), node_));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        arena_->deallocate(p, n * sizeof(T));
+    }
+
+    /// Returns the node this allocator targets, or local_node.
+    int node() const noexcept { return node_; }
+
+    numa_arena& arena() const noexcept { return *arena_; }
+
+private:
+    numa_arena* arena_;
+    int node_ = local_node;
+};
+
+template <typename T>
+constexpr int numa_allocator<T>::local_node;
+
+template <typename T, typename U>
+bool operator==(const numa_allocator<T>& lhs, const numa_allocator<U>& rhs) noexcept
+{
+    return &lhs.arena() == &rhs.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const numa_allocator<T>& lhs, const numa_allocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+/**
+ * Moves v's value into memory on the calling thread's current node, if it
+ * is not there already. Returns true if the value was moved.
+ *
+ * The value is move-constructed into a new allocation and the old one is
+ * freed, so references to it are invalidated. Afterwards v's allocator
+ * targets the new node.
+ */
+template <typename T>
+bool migrate_to_local_node(allocated_value<T, numa_allocator<T>>& v)
+{
+    const auto current = v.operator->();
+    if (!current) {
+        return false;
+    }
+    auto& arena = v.get_allocator().arena();
+    const int here = arena.topology().current_node();
+    if (numa_arena::node_of(current) == here) {
+        return false;
+    }
+
+    allocated_value<T, numa_allocator<T>> moved(std::allocator_arg,
+                                                numa_allocator<T>(here, arena),
+                                                in_place, std::move(*v));
+    swap(v, moved);
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+
+#ifndef TCB_OFFSET_PTR_HPP_INCLUDED
+#define TCB_OFFSET_PTR_HPP_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+
+namespace tcb {
+
+/**
+ * A pointer which stores the distance from itself to its target, rather
+ * than the target's address.
+ *
+ * As long as an offset_ptr and the object it points to move together -- for
+ * example because both live in the same memory-mapped file -- the pointer
+ * stays valid wherever the memory ends up mapped. This makes offset_ptr
+ * suitable as the pointer type of allocators for shared or persistent
+ * memory.
+ *
+ * Copying an offset_ptr recomputes the offset relative to the destination,
+ * so copies may be freely passed around in ordinary memory too.
+ */
+template <typename T>
+class offset_ptr {
+    // An offset of 1 would point into the offset_ptr itself, so it can
+    // safely be used to represent null
+    static constexpr std::ptrdiff_t null_offset = 1;
+
+    template <typename U>
+    using add_ref_t = typename std::conditional<std::is_void<U>::value,
+                                                void, U&>::type;
+
+public:
+    using element_type = T;
+    using value_type = typename std::remove_cv<T>::type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = add_ref_t<T>;
+    using iterator_category = std::random_access_iterator_tag;
+
+    template <typename U>
+    using rebind = offset_ptr<U>;
+
+    offset_ptr() noexcept = default;
+
+    offset_ptr(std::nullptr_t) noexcept {}
+
+    offset_ptr(T* p) noexcept { set(p); }
+
+    offset_ptr(const offset_ptr& other) noexcept { set(other.get()); }
+
+    /// Converting constructor, available if U* is implicitly convertible to T*.
+    template <typename U,
+              typename = typename std::enable_if<
+                    std::is_convertible<U*, T*>::value>::type>
+    offset_ptr(const offset_ptr<U>& other) noexcept { set(other.get()); }
+
+    /// Explicit conversion, as with static_cast<T*>(void_ptr).
+    template <typename U,
+              typename = typename std::enable_if<
+                    !std::is_convertible<U*, T*>::value &&
+                    std::is_void<typename std::remove_cv<U>::type>::value>::type,
+              typename = void>
+    explicit offset_ptr(const offset_ptr<U>& other) noexcept
+    {
+        set(static_cast<T*>(other.get()));
+    }
+
+    offset_ptr& operator=(const offset_ptr& other) noexcept
+    {
+        set(other.get());
+        return *this;
+    }
+
+    offset_ptr& operator=(T* p) noexcept
+    {
+        set(p);
+        return *this;
+    }
+
+    offset_ptr& operator=(std::nullptr_t) noexcept
+    {
+        offset_ = null_offset;
+        return *this;
+    }
+
+    /// Returns the raw address of the target.
+    T* get() const noexcept
+    {
+        if (offset_ == null_offset) {
+            return nullptr;
+        }
+        return reinterpret_cast<T*>(reinterpret_cast<std::uintptr_t>(this) + offset_);
+    }
+
+    template <typename U = T>
+    add_ref_t<U> operator*() const noexcept { return *get(); }
+
+    T* operator->() const noexcept { return get(); }
+
+    template <typename U = T>
+    add_ref_t<U> operator[](difference_type n) const noexcept { return get()[n]; }
+
+    explicit operator bool() const noexcept { return offset_ != null_offset; }
+
+    /// Returns an offset_ptr to r, for std::pointer_traits.
+    template <typename U = T,
+              typename = typename std::enable_if<!std::is_void<U>::value>::type>
+    static offset_ptr pointer_to(U& r) noexcept
+    {
+        return offset_ptr(std::addressof(r));
+    }
+
+    offset_ptr& operator+=(difference_type n) noexcept { set(get() + n); return *this; }
+    offset_ptr& operator-=(difference_type n) noexcept { set(get() - n); return *this; }
+    offset_ptr& operator++() noexcept { return *this += 1; }
+    offset_ptr& operator--() noexcept { return *this -= 1; }
+    offset_ptr operator++(int) noexcept { auto tmp = *this; ++*this; return tmp; }
+    offset_ptr operator--(int) noexcept { auto tmp = *this; --*this; return tmp; }
+
+    friend offset_ptr operator+(offset_ptr p, difference_type n) noexcept { return p += n; }
+    friend offset_ptr operator+(difference_type n, offset_ptr p) noexcept { return p += n; }
+    friend offset_ptr operator-(offset_ptr p, difference_type n) noexcept { return p -= n; }
+    friend difference_type operator-(const offset_ptr& a, const offset_ptr& b) noexcept
+    {
+        return a.get() - b.get();
+    }
+
+    friend bool operator==(const offset_ptr& a, const offset_ptr& b) noexcept { return a.get() == b.get(); }
+    friend bool operator!=(const offset_ptr& a, const offset_ptr& b) noexcept { return a.get() != b.get(); }
+    friend bool operator<(const offset_ptr& a, const offset_ptr& b) noexcept { return a.get() < b.get(); }
+    friend bool operator<=(const offset_ptr& a, const offset_ptr& b) noexcept { return a.get() <= b.get(); }
+    friend bool operator>(const offset_ptr& a, const offset_ptr& b) noexcept { return a.get() > b.get(); }
+    friend bool operator>=(const offset_ptr& a, const offset_ptr& b) noexcept { return a.get() >= b.get(); }
+
+    friend bool operator==(const offset_ptr& a, std::nullptr_t) noexcept { return !a; }
+    friend bool operator==(std::nullptr_t, const offset_ptr& a) noexcept { return !a; }
+    friend bool operator!=(const offset_ptr& a, std::nullptr_t) noexcept { return bool(a); }
+    friend bool operator!=(std::nullptr_t, const offset_ptr& a) noexcept { return bool(a); }
+
+private:
+    void set(T* p) noexcept
+    {
+        if (p == nullptr) {
+            offset_ = null_offset;
+        } else {
+            offset_ = static_cast<std::ptrdiff_t>(reinterpret_cast<std::uintptr_t>(p) -
+                                                  reinterpret_cast<std::uintptr_t>(this));
+        }
+    }
+
+    std::ptrdiff_t offset_ = null_offset;
+};
+
+}
+
+#endif
@@ -0,0 +1,237 @@
+
+#ifndef TCB_PARALLEL_CLONE_HPP_INCLUDED
+#define TCB_PARALLEL_CLONE_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+#include "work_stealing_pool.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tcb {
+
+/*
+ * Parallel deep copies
+ *
+ * parallel_clone() copies a tree of values -- allocated_values holding
+ * structs holding vectors of allocated_values, and so on -- using every
+ * worker of a work_stealing_pool. The structure is walked through
+ * clone_traits<T>::clone(ctx, value), which returns a copy of value:
+ *
+ *  - by default a value is copied with its copy constructor;
+ *  - allocated_value<T, A> allocates a new box and clones T into it;
+ *  - std::vector<T, A> clones its elements in parallel, unless they are
+ *    trivially copyable;
+ *  - other types owning children should specialise clone_traits and clone
+ *    their members with ctx.clone(). See
+ *    test/test_allocated_value_parallel_clone.cpp for an example.
+ *
+ * The copy of each allocator is chosen by worker_allocator_traits<A>. By
+ * default this is select_on_container_copy_construction(), so the
+ * allocator will be used from several threads at once and must be safe to
+ * use that way. Allocators which can hand out a separate instance to each
+ * worker, such as a per-thread arena, should specialise
+ * worker_allocator_traits instead.
+ */
+
+class clone_context;
+
+template <typename T, typename = void>
+struct clone_traits {
+    static T clone(clone_context&, const T& value) { return value; }
+};
+
+template <typename A, typename = void>
+struct worker_allocator_traits {
+    /// Returns the allocator to be used by the copy of a value allocated
+    /// with a, when the copy is made by the given worker.
+    static A select(const A& a, std::size_t /*worker*/)
+    {
+        return std::allocator_traits<A>::select_on_container_copy_construction(a);
+    }
+};
+
+/**
+ * The state passed through a parallel_clone(), identifying the worker
+ * making the copy.
+ */
+class clone_context {
+public:
+    explicit clone_context(work_stealing_pool::worker& w) noexcept : worker_(&w) {}
+
+    /// Returns a copy of value, made through clone_traits.
+    template <typename T>
+    T clone(const T& value)
+    {
+        return clone_traits<T>::clone(*this, value);
+    }
+
+    /// Returns the allocator this worker should use for a copy of a value
+    /// allocated with a.
+    template <typename A>
+    A allocator_for(const A& a) const
+    {
+        return worker_allocator_traits<A>::select(a, worker_index());
+    }
+
+    /// Returns the index of the worker making the copy.
+    std::size_t worker_index() const noexcept { return worker_->index(); }
+
+    /// Returns true if other workers may share the work.
+    bool is_parallel() const noexcept { return worker_->pool().size() > 1; }
+
+    /**
+     * Calls f(ctx, i) for each i in [first, last), in parallel, where ctx is
+     * the context of the worker making that call.
+     */
+    template <typename F>
+    void for_each(std::size_t first, std::size_t last, F& f)
+    {
+        with_context<F> g{&f};
+        worker_->for_each(first, last, g);
+    }
+
+private:
+    template <typename F>
+    struct with_context {
+        void operator()(work_stealing_pool::worker& w, std::size_t i) const
+        {
+            clone_context ctx(w);
+            (*f)(ctx, i);
+        }
+
+        F* f;
+    };
+
+    work_stealing_pool::worker* worker_;
+};
+
+namespace detail {
+
+// Storage for n values which may be constructed in any order, by any
+// thread, and are destroyed if still here at the end
+template <typename T>
+class clone_staging {
+public:
+    explicit clone_staging(std::size_t n)
+        : storage_(new storage_type[n]),
+          constructed_(n, 0)
+    {}
+
+    clone_staging(const clone_staging&) = delete;
+    clone_staging& operator=(const clone_staging&) = delete;
+
+    ~clone_staging()
+    {
+        for (std::size_t i = 0; i < constructed_.size(); ++i) {
+            if (constructed_[i]) {
+                (*this)[i].~T();
+            }
+        }
+    }
+
+    void construct(std::size_t i, T&& value)
+    {
+        ::new (static_cast<void*>(&storage_[i])) T(std::move(value));
+        constructed_[i] = 1;
+    }
+
+    T& operator[](std::size_t i) noexcept { return *reinterpret_cast<T*>(&storage_[i]); }
+
+private:
+    using storage_type = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    std::unique_ptr<storage_type[]> storage_;
+    // One byte per element, so that workers never write to the same object
+    std::vector<char> constructed_;
+};
+
+template <typename T, typename A>
+struct vector_cloner {
+    void operator()(clone_context& ctx, std::size_t i) const
+    {
+        staging->construct(i, ctx.clone((*source)[i]));
+    }
+
+    const std::vector<T, A>* source;
+    clone_staging<T>* staging;
+};
+
+}
+
+// allocated_value<T> is cloned into a new box, holding a clone of T
+template <typename T, typename A>
+struct clone_traits<allocated_value<T, A>> {
+    static allocated_value<T, A> clone(clone_context& ctx, const allocated_value<T, A>& value)
+    {
+        return allocated_value<T, A>(std::allocator_arg, ctx.allocator_for(value.get_allocator()),
+                                     in_place, ctx.clone(*value));
+    }
+};
+
+// Vector elements are cloned in parallel into a staging area, then moved
+// into the new vector. A single worker clones them straight into place.
+template <typename T, typename A>
+struct clone_traits<std::vector<T, A>> {
+    static std::vector<T, A> clone(clone_context& ctx, const std::vector<T, A>& value)
+    {
+        return clone(ctx, value, std::is_trivially_copyable<T>{});
+    }
+
+private:
+    static std::vector<T, A> clone(clone_context& ctx, const std::vector<T, A>& value,
+                                   std::true_type)
+    {
+        return std::vector<T, A>(value.begin(), value.end(),
+                                 ctx.allocator_for(value.get_allocator()));
+    }
+
+    static std::vector<T, A> clone(clone_context& ctx, const std::vector<T, A>& value,
+                                   std::false_type)
+    {
+        std::vector<T, A> out(ctx.allocator_for(value.get_allocator()));
+        out.reserve(value.size());
+        if (!ctx.is_parallel()) {
+            for (const auto& elem : value) {
+                out.push_back(ctx.clone(elem));
+            }
+            return out;
+        }
+
+        detail::clone_staging<T> staging(value.size());
+        detail::vector_cloner<T, A> cloner{&value, &staging};
+        ctx.for_each(0, value.size(), cloner);
+        for (std::size_t i = 0; i < value.size(); ++i) {
+            out.push_back(std::move(staging[i]));
+        }
+        return out;
+    }
+};
+
+/**
+ * Returns a deep copy of value, made by the workers of pool.
+ *
+ * Equivalent to copy-constructing value, except that allocators are chosen
+ * by worker_allocator_traits, and that the work is spread across the pool.
+ * Any allocated_value in the tree must hold a value. If copying any part of
+ * the tree throws, everything copied so far is destroyed and the exception
+ * is rethrown.
+ */
+template <typename T>
+T parallel_clone(const T& value, work_stealing_pool& pool)
+{
+    detail::clone_staging<T> result(1);
+    pool.run([&](work_stealing_pool::worker& w) {
+        clone_context ctx(w);
+        result.construct(0, ctx.clone(value));
+    });
+    return std::move(result[0]);
+}
+
+}
+
+#endif
@@ -0,0 +1,281 @@
+
+#ifndef TCB_PMR_OBJECT_POOL_RESOURCE_HPP_INCLUDED
+#define TCB_PMR_OBJECT_POOL_RESOURCE_HPP_INCLUDED
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+namespace tcb {
+namespace pmr {
+
+template <typename T, typename Resource>
+class typed_resource_allocator;
+
+namespace detail {
+
+/*
+ * Blocks are handed out in seven size classes: 16, 32, 64, ..., 1024 bytes.
+ * Every block is aligned to at least alignof(std::max_align_t); anything
+ * larger or more strictly aligned than that goes straight to upstream.
+ */
+constexpr std::size_t pool_min_block = 16;
+constexpr std::size_t pool_num_classes = 7;
+constexpr std::size_t pool_max_block = pool_min_block << (pool_num_classes - 1);
+constexpr std::size_t pool_alignment = alignof(std::max_align_t);
+
+static_assert(pool_min_block % pool_alignment == 0,
+              "the smallest size class must preserve max_align_t alignment");
+
+inline std::size_t pool_class_for(std::size_t bytes) noexcept
+{
+    std::size_t i = 0;
+    while ((pool_min_block << i) < bytes) {
+        ++i;
+    }
+    return i;
+}
+
+/*
+ * The free list and bump region for a single size class.
+ *
+ * Allocation pops the free list if it is non-empty, otherwise carves the
+ * next block from the current chunk; only when the chunk is exhausted is
+ * upstream consulted. Each step is O(1).
+ */
+class size_class_pool {
+    struct free_block {
+        free_block* next;
+    };
+
+    struct alignas(pool_alignment) chunk {
+        chunk* next;
+        std::size_t size;
+    };
+
+public:
+    void* allocate(std::size_t block_size, std::size_t chunk_size,
+                   std::pmr::memory_resource* upstream)
+    {
+        if (free_) {
+            auto b = free_;
+            free_ = b->next;
+            return b;
+        }
+        if (static_cast<std::size_t>(end_ - bump_) < block_size) {
+            refill(block_size, chunk_size, upstream);
+        }
+        void* p = bump_;
+        bump_ += block_size;
+        return p;
+    }
+
+    void deallocate(void* p) noexcept
+    {
+        auto b = static_cast<free_block*>(p);
+        b->next = free_;
+        free_ = b;
+    }
+
+    void release(std::pmr::memory_resource* upstream) noexcept
+    {
+        while (chunks_) {
+            auto c = chunks_;
+            chunks_ = c->next;
+            upstream->deallocate(c, c->size, pool_alignment);
+        }
+        free_ = nullptr;
+        bump_ = end_ = nullptr;
+    }
+
+private:
+    void refill(std::size_t block_size, std::size_t chunk_size,
+                std::pmr::memory_resource* upstream)
+    {
+        const auto blocks = chunk_size > block_size ? chunk_size / block_size : 1;
+        const auto bytes = sizeof(chunk) + blocks * block_size;
+        auto c = static_cast<chunk*>(upstream->allocate(bytes, pool_alignment));
+        c->next = chunks_;
+        c->size = bytes;
+        chunks_ = c;
+        bump_ = reinterpret_cast<char*>(c + 1);
+        end_ = bump_ + blocks * block_size;
+    }
+
+    free_block* free_ = nullptr;
+    char* bump_ = nullptr;
+    char* end_ = nullptr;
+    chunk* chunks_ = nullptr;
+};
+
+}
+
+/**
+ * A pooling memory resource tuned for the single-object allocations made by
+ * allocated_value.
+ *
+ * Unlike std::pmr::unsynchronized_pool_resource there is no per-call search
+ * for a pool: the size class is found with a short shift loop and the
+ * allocation itself is a free-list pop or a pointer bump. Requests larger
+ * than 1KiB, or with alignment stricter than alignof(std::max_align_t), are
+ * forwarded to the upstream resource.
+ *
+ * Memory is only returned to upstream when release() is called or the
+ * resource is destroyed.
+ *
+ * This class is not thread safe; see synchronized_object_pool_resource.
+ */
+class unsynchronized_object_pool_resource final : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t default_chunk_size = 64 * 1024;
+
+    /**
+     * Constructs a pool which obtains chunks of approximately chunk_size bytes
+     * from upstream.
+     */
+    explicit unsynchronized_object_pool_resource(
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+            std::size_t chunk_size = default_chunk_size) noexcept
+        : upstream_(upstream),
+          chunk_size_(chunk_size)
+    {}
+
+    unsynchronized_object_pool_resource(const unsynchronized_object_pool_resource&) = delete;
+    unsynchronized_object_pool_resource& operator=(const unsynchronized_object_pool_resource&) = delete;
+
+    ~unsynchronized_object_pool_resource() { release(); }
+
+    /// Returns all pooled memory to upstream, whether or not it is in use.
+    void release() noexcept
+    {
+        for (auto& p : pools_) {
+            p.release(upstream_);
+        }
+    }
+
+    /// Returns the resource from which chunks are obtained.
+    std::pmr::memory_resource* upstream_resource() const noexcept
+    {
+        return upstream_;
+    }
+
+private:
+    template <typename, typename>
+    friend class typed_resource_allocator;
+
+    static constexpr std::size_t pool_alignment = detail::pool_alignment;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (bytes > detail::pool_max_block || alignment > pool_alignment) {
+            return upstream_->allocate(bytes, alignment);
+        }
+        const auto i = detail::pool_class_for(bytes);
+        return pools_[i].allocate(detail::pool_min_block << i, chunk_size_, upstream_);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        if (bytes > detail::pool_max_block || alignment > pool_alignment) {
+            return upstream_->deallocate(p, bytes, alignment);
+        }
+        pools_[detail::pool_class_for(bytes)].deallocate(p);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t chunk_size_;
+    std::array<detail::size_class_pool, detail::pool_num_classes> pools_{};
+};
+
+/**
+ * A thread-safe version of unsynchronized_object_pool_resource.
+ *
+ * Each size class is guarded by its own mutex, so threads allocating
+ * objects of different sizes do not contend with each other. Large
+ * requests are forwarded to upstream without taking any lock, so upstream
+ * must itself be thread-safe.
+ */
+class synchronized_object_pool_resource final : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t default_chunk_size =
+            unsynchronized_object_pool_resource::default_chunk_size;
+
+    explicit synchronized_object_pool_resource(
+            std::pmr::memory_resource* upstream = std::pmr::get_default_resource(),
+            std::size_t chunk_size = default_chunk_size) noexcept
+        : upstream_(upstream),
+          chunk_size_(chunk_size)
+    {}
+
+    synchronized_object_pool_resource(const synchronized_object_pool_resource&) = delete;
+    synchronized_object_pool_resource& operator=(const synchronized_object_pool_resource&) = delete;
+
+    ~synchronized_object_pool_resource() { release(); }
+
+    /// Returns all pooled memory to upstream, whether or not it is in use.
+    void release() noexcept
+    {
+        for (std::size_t i = 0; i < detail::pool_num_classes; ++i) {
+            std::lock_guard<std::mutex> lock(pools_[i].mutex);
+            pools_[i].pool.release(upstream_);
+        }
+    }
+
+    /// Returns the resource from which chunks are obtained.
+    std::pmr::memory_resource* upstream_resource() const noexcept
+    {
+        return upstream_;
+    }
+
+private:
+    template <typename, typename>
+    friend class typed_resource_allocator;
+
+    static constexpr std::size_t pool_alignment = detail::pool_alignment;
+
+    // Keep each class's lock on its own cache line
+    struct alignas(64) locked_pool {
+        std::mutex mutex;
+        detail::size_class_pool pool;
+    };
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        if (bytes > detail::pool_max_block || alignment > pool_alignment) {
+            return upstream_->allocate(bytes, alignment);
+        }
+        const auto i = detail::pool_class_for(bytes);
+        std::lock_guard<std::mutex> lock(pools_[i].mutex);
+        return pools_[i].pool.allocate(detail::pool_min_block << i, chunk_size_, upstream_);
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        if (bytes > detail::pool_max_block || alignment > pool_alignment) {
+            return upstream_->deallocate(p, bytes, alignment);
+        }
+        const auto i = detail::pool_class_for(bytes);
+        std::lock_guard<std::mutex> lock(pools_[i].mutex);
+        pools_[i].pool.deallocate(p);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t chunk_size_;
+    std::array<locked_pool, detail::pool_num_classes> pools_{};
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,239 @@
+
+#ifndef TCB_PMR_STATS_RESOURCE_HPP_INCLUDED
+#define TCB_PMR_STATS_RESOURCE_HPP_INCLUDED
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+
+namespace tcb {
+namespace pmr {
+
+#ifndef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+# if !(defined(__cpp_exceptions) || defined(_CPPUNWIND))
+#   define TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+# endif
+#endif
+
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+#define TRY
+#define CATCH(X) if (false)
+#define THROW
+#else
+#define TRY try
+#define CATCH catch
+#define THROW throw
+#endif
+
+template <typename T, typename Resource>
+class typed_resource_allocator;
+
+/**
+ * A point-in-time copy of the counters kept by a stats_resource.
+ *
+ * Each counter is read individually, so a snapshot taken while other
+ * threads are allocating is not guaranteed to be a consistent cut across
+ * all of its members.
+ */
+struct allocation_stats {
+    static constexpr std::size_t histogram_buckets = 32;
+
+    /// Bytes currently allocated through the resource.
+    std::size_t live_bytes = 0;
+    /// High-water mark of live_bytes since construction or reset_peak().
+    std::size_t peak_bytes = 0;
+    /// Number of allocations not yet deallocated.
+    std::size_t live_allocations = 0;
+    /// Total number of calls to allocate().
+    std::size_t total_allocations = 0;
+    /// Total number of bytes ever requested.
+    std::size_t total_bytes = 0;
+
+    /// Bucket i counts allocations whose size s satisfies 2^(i-1) < s <= 2^i.
+    std::array<std::size_t, histogram_buckets> size_histogram{};
+
+    /// Number of allocations selected for lifetime sampling.
+    std::size_t sampled_allocations = 0;
+    /// Bucket i counts sampled lifetimes l (in nanoseconds) satisfying
+    /// 2^(i-1) < l <= 2^i.
+    std::array<std::size_t, histogram_buckets> lifetime_histogram{};
+};
+
+/**
+ * A memory resource which forwards all requests to an upstream resource,
+ * recording statistics about them along the way.
+ *
+ * Counting is done with relaxed atomics, so a stats_resource may be shared
+ * between threads if its upstream resource can be. Giving each interesting
+ * allocated_value member its own stats_resource makes it easy to see where
+ * memory is going.
+ *
+ * Allocation lifetimes are recorded for a sample of the allocations only.
+ * Whether an allocation is sampled is decided from a hash of its sequence
+ * number, so a sample rate of N records roughly one allocation in N,
+ * whatever addresses the upstream resource hands out and without locking
+ * in step with any periodic allocation pattern. Deallocations look the
+ * block up among the live samples, taking a lock, only while there are
+ * any. A sample rate of zero disables lifetime tracking altogether.
+ */
+class stats_resource final : public std::pmr::memory_resource {
+    using clock = std::chrono::steady_clock;
+    static constexpr std::size_t buckets = allocation_stats::histogram_buckets;
+
+public:
+    /**
+     * Constructs a stats_resource forwarding to upstream, sampling the
+     * lifetimes of approximately one in lifetime_sample_rate allocations.
+     */
+    explicit stats_resource(std::pmr::memory_resource* upstream
+                                = std::pmr::get_default_resource(),
+                            std::size_t lifetime_sample_rate = 0) noexcept
+        : upstream_(upstream),
+          sample_rate_(lifetime_sample_rate)
+    {}
+
+    stats_resource(const stats_resource&) = delete;
+    stats_resource& operator=(const stats_resource&) = delete;
+
+    /// Returns the resource to which requests are forwarded.
+    std::pmr::memory_resource* upstream_resource() const noexcept
+    {
+        return upstream_;
+    }
+
+    /// Returns a copy of the current counters.
+    allocation_stats snapshot() const
+    {
+        allocation_stats s;
+        s.live_bytes = live_bytes_.load(std::memory_order_relaxed);
+        s.peak_bytes = peak_bytes_.load(std::memory_order_relaxed);
+        s.live_allocations = live_allocations_.load(std::memory_order_relaxed);
+        s.total_allocations = total_allocations_.load(std::memory_order_relaxed);
+        s.total_bytes = total_bytes_.load(std::memory_order_relaxed);
+        s.sampled_allocations = sampled_allocations_.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < buckets; ++i) {
+            s.size_histogram[i] = size_histogram_[i].load(std::memory_order_relaxed);
+            s.lifetime_histogram[i] = lifetime_histogram_[i].load(std::memory_order_relaxed);
+        }
+        return s;
+    }
+
+    /// Resets the peak byte count to the current number of live bytes.
+    void reset_peak() noexcept
+    {
+        peak_bytes_.store(live_bytes_.load(std::memory_order_relaxed),
+                          std::memory_order_relaxed);
+    }
+
+private:
+    template <typename, typename>
+    friend class typed_resource_allocator;
+
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override
+    {
+        void* p = upstream_->allocate(bytes, alignment);
+
+        const auto live = live_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto peak = peak_bytes_.load(std::memory_order_relaxed);
+        while (peak < live &&
+               !peak_bytes_.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {}
+        live_allocations_.fetch_add(1, std::memory_order_relaxed);
+        const auto sequence = total_allocations_.fetch_add(1, std::memory_order_relaxed);
+        total_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        size_histogram_[bucket_for(bytes)].fetch_add(1, std::memory_order_relaxed);
+
+        if (is_sampled(sequence)) {
+            // Losing a sample is preferable to failing the allocation
+            TRY {
+                std::lock_guard<std::mutex> lock(samples_mutex_);
+                samples_[p] = clock::now();
+                live_samples_.fetch_add(1, std::memory_order_relaxed);
+                sampled_allocations_.fetch_add(1, std::memory_order_relaxed);
+            } CATCH (...) {}
+        }
+
+        return p;
+    }
+
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+    {
+        // A sampled block stays counted until it is deallocated, after its
+        // allocation, so if the count is zero p was not sampled
+        if (live_samples_.load(std::memory_order_relaxed) != 0) {
+            std::lock_guard<std::mutex> lock(samples_mutex_);
+            auto it = samples_.find(p);
+            if (it != samples_.end()) {
+                const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        clock::now() - it->second).count();
+                lifetime_histogram_[bucket_for(static_cast<std::size_t>(ns))]
+                        .fetch_add(1, std::memory_order_relaxed);
+                samples_.erase(it);
+                live_samples_.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+
+        live_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+        live_allocations_.fetch_sub(1, std::memory_order_relaxed);
+
+        upstream_->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    // Mixes the sequence number with the splitmix64 finaliser before
+    // picking a residue, so that samples are not evenly spaced
+    bool is_sampled(std::uint64_t sequence) const noexcept
+    {
+        if (sample_rate_ == 0) {
+            return false;
+        }
+        auto h = sequence + 0x9E3779B97F4A7C15ull;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        h ^= h >> 31;
+        return h % sample_rate_ == 0;
+    }
+
+    static std::size_t bucket_for(std::size_t n) noexcept
+    {
+        std::size_t i = 0;
+        while (i < buckets - 1 && (std::size_t{1} << i) < n) {
+            ++i;
+        }
+        return i;
+    }
+
+    std::pmr::memory_resource* upstream_;
+    std::size_t sample_rate_;
+
+    std::atomic<std::size_t> live_bytes_{0};
+    std::atomic<std::size_t> peak_bytes_{0};
+    std::atomic<std::size_t> live_allocations_{0};
+    std::atomic<std::size_t> total_allocations_{0};
+    std::atomic<std::size_t> total_bytes_{0};
+    std::atomic<std::size_t> sampled_allocations_{0};
+    std::array<std::atomic<std::size_t>, buckets> size_histogram_{};
+    std::array<std::atomic<std::size_t>, buckets> lifetime_histogram_{};
+
+    std::atomic<std::size_t> live_samples_{0};
+    std::mutex samples_mutex_;
+    std::unordered_map<void*, clock::time_point> samples_;
+};
+
+}
+}
+
+#undef TRY
+#undef CATCH
+#undef THROW
+
+#endif
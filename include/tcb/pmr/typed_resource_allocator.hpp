@@ -0,0 +1,136 @@
+
+#ifndef TCB_PMR_TYPED_RESOURCE_ALLOCATOR_HPP_INCLUDED
+#define TCB_PMR_TYPED_RESOURCE_ALLOCATOR_HPP_INCLUDED
+
+#include "../allocated_value.hpp"
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+
+namespace tcb {
+namespace pmr {
+
+/**
+ * An allocator which, like std::pmr::polymorphic_allocator, holds a pointer
+ * to a memory resource -- but one whose concrete type is known statically.
+ *
+ * Resource must be a final class derived from std::pmr::memory_resource, and
+ * must grant friendship to typed_resource_allocator so that its
+ * do_allocate() and do_deallocate() members can be called directly, without
+ * virtual dispatch. All of the resources in tcb::pmr do so.
+ *
+ * A typed_resource_allocator converts implicitly to any
+ * std::pmr::polymorphic_allocator, and the two compare equal whenever their
+ * resources do.
+ *
+ * Unlike polymorphic_allocator, construct() does not perform uses-allocator
+ * construction, and copy construction of a container keeps the same
+ * resource rather than switching to the default resource.
+ */
+template <typename T, typename Resource>
+class typed_resource_allocator {
+    static_assert(std::is_base_of<std::pmr::memory_resource, Resource>::value,
+                  "Resource must be derived from std::pmr::memory_resource");
+    static_assert(std::is_final<Resource>::value,
+                  "Resource must be a final class");
+
+public:
+    using value_type = T;
+    using resource_type = Resource;
+
+    /// Constructs an allocator which uses the supplied resource.
+    typed_resource_allocator(Resource* resource) noexcept
+        : resource_(resource)
+    {}
+
+    /// Rebinding constructor.
+    template <typename U>
+    typed_resource_allocator(const typed_resource_allocator<U, Resource>& other) noexcept
+        : resource_(other.resource())
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) {
+            tcb::detail::throw_bad_array_new_length();
+        }
+        return static_cast<T*>(resource_->Resource::do_allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        resource_->Resource::do_deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    /// Returns the resource in use by this allocator.
+    Resource* resource() const noexcept { return resource_; }
+
+    /// Converts to a polymorphic_allocator using the same resource.
+    template <typename U>
+    operator std::pmr::polymorphic_allocator<U>() const noexcept
+    {
+        return std::pmr::polymorphic_allocator<U>(resource_);
+    }
+
+private:
+    Resource* resource_;
+};
+
+template <typename T, typename U, typename Resource>
+bool operator==(const typed_resource_allocator<T, Resource>& lhs,
+                const typed_resource_allocator<U, Resource>& rhs) noexcept
+{
+    return *lhs.resource() == *rhs.resource();
+}
+
+template <typename T, typename U, typename Resource>
+bool operator!=(const typed_resource_allocator<T, Resource>& lhs,
+                const typed_resource_allocator<U, Resource>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+template <typename T, typename U, typename Resource>
+bool operator==(const typed_resource_allocator<T, Resource>& lhs,
+                const std::pmr::polymorphic_allocator<U>& rhs) noexcept
+{
+    return *lhs.resource() == *rhs.resource();
+}
+
+template <typename T, typename U, typename Resource>
+bool operator!=(const typed_resource_allocator<T, Resource>& lhs,
+                const std::pmr::polymorphic_allocator<U>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+template <typename T, typename U, typename Resource>
+bool operator==(const std::pmr::polymorphic_allocator<T>& lhs,
+                const typed_resource_allocator<U, Resource>& rhs) noexcept
+{
+    return *lhs.resource() == *rhs.resource();
+}
+
+template <typename T, typename U, typename Resource>
+bool operator!=(const std::pmr::polymorphic_allocator<T>& lhs,
+                const typed_resource_allocator<U, Resource>& rhs) noexcept
+{
+    return !(lhs == rhs);
+}
+
+/**
+ * An allocated_value whose storage comes from a memory resource of the
+ * statically-known type Resource, avoiding virtual calls on construction
+ * and destruction.
+ */
+template <typename T, typename Resource>
+using typed_allocated_value =
+        ::tcb::allocated_value<T, typed_resource_allocator<T, Resource>>;
+
+}
+}
+
+#endif
@@ -0,0 +1,538 @@
+
+#ifndef TCB_SLOT_PTR_HPP_INCLUDED
+#define TCB_SLOT_PTR_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace tcb {
+
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+#define TRY
+#define CATCH(X) if (false)
+#define THROW
+#else
+#define TRY try
+#define CATCH catch
+#define THROW throw
+#endif
+
+/**
+ * A growable table of slots for objects of type T, indexed by 32-bit
+ * integers.
+ *
+ * There is one table for each combination of T and Tag; use distinct tag
+ * types to keep unrelated populations apart. Slot 0 is never allocated, so
+ * that index 0 can represent null.
+ *
+ * The slots are stored contiguously, so the address of slot i is one load
+ * of the table's base address away. When the table grows, and when
+ * reserve() or shrink_to_fit() is called, the slots are moved to new
+ * storage; indices are unaffected, but raw pointers and references to
+ * objects in the table are invalidated.
+ *
+ * Growth happens inside allocate(), perhaps while the caller holds a
+ * reference to the object it is about to copy into the new slot. So there
+ * the live objects are copied, or memcpy'd if T is trivially copyable,
+ * and the old storage is kept, with the originals, until the table is
+ * next modified, to be read from in the meantime. Only move-only types are
+ * moved. reserve() and shrink_to_fit() move the objects if T is nothrow
+ * move constructible, and free the old storage at once.
+ *
+ * The table is a static object, shared by every slot_allocator<T, Tag> in
+ * the program, and is not thread safe: allocations, deallocations and
+ * dereferences for a given T and Tag must not race with one another.
+ */
+template <typename T, typename Tag = void>
+class slot_table {
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "slot_table does not support over-aligned types");
+    static_assert(std::is_trivially_copyable<T>::value ||
+                  std::is_copy_constructible<T>::value ||
+                  std::is_nothrow_move_constructible<T>::value,
+                  "slot_table requires T to be copy or nothrow move constructible");
+
+    union slot {
+        std::uint32_t next_free;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    using word = std::uint64_t;
+    static constexpr std::size_t word_bits = 64;
+
+public:
+    /// The largest number of slots a table may hold, including slot 0.
+    static constexpr std::size_t max_slots = std::numeric_limits<std::uint32_t>::max();
+
+    constexpr slot_table() noexcept = default;
+
+    slot_table(const slot_table&) = delete;
+    slot_table& operator=(const slot_table&) = delete;
+
+    ~slot_table()
+    {
+        release_retired();
+        ::operator delete(slots_);
+    }
+
+    /// Returns the table for T and Tag.
+    static slot_table& instance() noexcept { return table_; }
+
+    /// Returns the address of slot index.
+    T* address(std::uint32_t index) const noexcept
+    {
+        return reinterpret_cast<T*>(slots_[index].storage);
+    }
+
+    /// Returns the index of the slot holding *p.
+    std::uint32_t index_of(const T* p) const noexcept
+    {
+        return static_cast<std::uint32_t>(reinterpret_cast<const slot*>(p) - slots_);
+    }
+
+    /// Allocates a slot, growing the table if necessary, and returns its
+    /// index.
+    std::uint32_t allocate()
+    {
+        release_retired();
+        std::uint32_t index;
+        if (free_ != 0) {
+            index = free_;
+            free_ = slots_[index].next_free;
+        } else {
+            if (used_ == capacity_) {
+                grow(capacity_ < 64 ? 64 : 2 * std::size_t(capacity_));
+            }
+            index = used_++;
+        }
+        set_live(index, true);
+        ++live_count_;
+        return index;
+    }
+
+    /// Frees a slot previously returned by allocate().
+    void deallocate(std::uint32_t index) noexcept
+    {
+        release_retired();
+        set_live(index, false);
+        slots_[index].next_free = free_;
+        free_ = index;
+        --live_count_;
+    }
+
+    /// Ensures capacity for n slots, including slot 0.
+    void reserve(std::size_t n)
+    {
+        release_retired();
+        if (n > capacity_) {
+            grow(n, false);
+        }
+    }
+
+    /// Moves the table into storage just large enough for its highest live
+    /// slot.
+    void shrink_to_fit()
+    {
+        release_retired();
+        std::uint32_t end = used_;
+        while (end > 1 && !is_live(end - 1)) {
+            --end;
+        }
+        if (end == capacity_) {
+            return;
+        }
+        relocate(end, false);
+        used_ = end;
+
+        // Rebuild the free list, which may have referred to removed slots
+        free_ = 0;
+        for (std::uint32_t i = end; i-- > 1; ) {
+            if (!is_live(i)) {
+                slots_[i].next_free = free_;
+                free_ = i;
+            }
+        }
+    }
+
+    /// Returns the number of allocated slots.
+    std::size_t live() const noexcept { return live_count_; }
+
+    /// Returns the number of slots in the current storage.
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    /// Returns the bytes of storage used by the table.
+    std::size_t bytes() const noexcept
+    {
+        return capacity_ == 0 ? 0 : block_size(capacity_);
+    }
+
+private:
+    static std::size_t words_for(std::size_t n) noexcept
+    {
+        return (n + word_bits - 1) / word_bits;
+    }
+
+    // The live bits follow the slots in the same allocation
+    static std::size_t live_offset(std::size_t n) noexcept
+    {
+        return (n * sizeof(slot) + alignof(word) - 1) / alignof(word) * alignof(word);
+    }
+
+    static std::size_t block_size(std::size_t n) noexcept
+    {
+        return live_offset(n) + words_for(n) * sizeof(word);
+    }
+
+    static bool is_live(const word* live, std::uint32_t i) noexcept
+    {
+        return (live[i / word_bits] >> (i % word_bits)) & 1;
+    }
+
+    bool is_live(std::uint32_t i) const noexcept { return is_live(live_, i); }
+
+    void set_live(std::uint32_t i, bool live) noexcept
+    {
+        const auto bit = word(1) << (i % word_bits);
+        if (live) {
+            live_[i / word_bits] |= bit;
+        } else {
+            live_[i / word_bits] &= ~bit;
+        }
+    }
+
+    void grow(std::size_t n, bool keep_originals = true)
+    {
+        if (n > max_slots) {
+            if (capacity_ == max_slots) {
+                detail::throw_bad_alloc();
+            }
+            n = max_slots;
+        }
+        const bool first = capacity_ == 0;
+        relocate(static_cast<std::uint32_t>(n), keep_originals);
+        if (first) {
+            used_ = 1;
+        }
+    }
+
+    // Carries the first min(used_, n) slots into new storage of n slots.
+    // If keep_originals is true, the old storage is retired rather than
+    // freed, and remains readable until release_retired() is called.
+    void relocate(std::uint32_t n, bool keep_originals)
+    {
+        auto block = static_cast<char*>(::operator new(block_size(n)));
+        auto slots = reinterpret_cast<slot*>(block);
+        auto live = reinterpret_cast<word*>(block + live_offset(n));
+        std::memset(live, 0, words_for(n) * sizeof(word));
+
+        const auto keep = n < used_ ? n : used_;
+        if (keep > 0) {
+            TRY {
+                transfer(slots, keep, keep_originals, std::is_trivially_copyable<T>{},
+                         std::is_copy_constructible<T>{});
+            } CATCH (...) {
+                ::operator delete(block);
+                THROW;
+            }
+            std::memcpy(live, live_, words_for(keep) * sizeof(word));
+        }
+
+        if (keep_originals && keep > 0) {
+            retired_ = slots_;
+            retired_live_ = live_;
+            retired_used_ = keep;
+        } else {
+            ::operator delete(slots_);
+        }
+        slots_ = slots;
+        live_ = live;
+        capacity_ = n;
+    }
+
+    template <typename CopyConstructible>
+    void transfer(slot* to, std::uint32_t n, bool, std::true_type /*trivially copyable*/,
+                  CopyConstructible) noexcept
+    {
+        std::memcpy(to, slots_, n * sizeof(slot));
+    }
+
+    void transfer(slot* to, std::uint32_t n, bool keep_originals,
+                  std::false_type /*trivially copyable*/, std::true_type /*copy constructible*/)
+    {
+        if (!keep_originals && std::is_nothrow_move_constructible<T>::value) {
+            move_slots(to, n);
+            return;
+        }
+        copy_slots(to, n);
+        if (!keep_originals) {
+            destroy_slots(slots_, live_, n);
+        }
+    }
+
+    void transfer(slot* to, std::uint32_t n, bool, std::false_type /*trivially copyable*/,
+                  std::false_type /*copy constructible*/) noexcept
+    {
+        move_slots(to, n);
+    }
+
+    void move_slots(slot* to, std::uint32_t n) noexcept
+    {
+        for (std::uint32_t i = 0; i < n; ++i) {
+            if (is_live(i)) {
+                auto from = address(i);
+                ::new (static_cast<void*>(to[i].storage)) T(std::move(*from));
+                from->~T();
+            } else {
+                to[i].next_free = slots_[i].next_free;
+            }
+        }
+    }
+
+    // Leaves the originals alone; if a copy throws, the copies made so far
+    // are destroyed
+    void copy_slots(slot* to, std::uint32_t n)
+    {
+        std::uint32_t i = 0;
+        TRY {
+            for (; i < n; ++i) {
+                if (is_live(i)) {
+                    ::new (static_cast<void*>(to[i].storage)) T(*address(i));
+                } else {
+                    to[i].next_free = slots_[i].next_free;
+                }
+            }
+        } CATCH (...) {
+            destroy_slots(to, live_, i);
+            THROW;
+        }
+    }
+
+    static void destroy_slots(slot* slots, const word* live, std::uint32_t n) noexcept
+    {
+        if (std::is_trivially_destructible<T>::value) {
+            return;
+        }
+        for (std::uint32_t i = 0; i < n; ++i) {
+            if (is_live(live, i)) {
+                reinterpret_cast<T*>(slots[i].storage)->~T();
+            }
+        }
+    }
+
+    // Destroys the originals left behind by the last growth
+    void release_retired() noexcept
+    {
+        if (!retired_) {
+            return;
+        }
+        destroy_slots(retired_, retired_live_, retired_used_);
+        ::operator delete(retired_);
+        retired_ = nullptr;
+    }
+
+    static slot_table table_;
+
+    slot* slots_ = nullptr;
+    word* live_ = nullptr;
+    slot* retired_ = nullptr;
+    const word* retired_live_ = nullptr;
+    std::uint32_t capacity_ = 0;
+    std::uint32_t used_ = 0;
+    std::uint32_t free_ = 0;
+    std::uint32_t live_count_ = 0;
+    std::uint32_t retired_used_ = 0;
+};
+
+// Constant-initialised, so instance() needs no guard variable
+template <typename T, typename Tag>
+slot_table<T, Tag> slot_table<T, Tag>::table_;
+
+template <typename T, typename Tag>
+constexpr std::size_t slot_table<T, Tag>::max_slots;
+
+/**
+ * A 32-bit pointer to an object in a slot_table.
+ *
+ * A slot_ptr holds the index of its target in slot_table<T, Tag>, so it is
+ * half the size of a raw pointer on 64-bit platforms, and stays valid when
+ * the table moves its storage. Dereferencing it costs one extra load, of
+ * the table's base address.
+ *
+ * Only single objects can be addressed, so pointer arithmetic is not
+ * supported. A slot_ptr<void, Tag> can be converted back to the typed
+ * pointer it came from, but cannot be dereferenced.
+ */
+template <typename T, typename Tag = void>
+class slot_ptr {
+    template <typename U, typename G>
+    friend class slot_ptr;
+
+    using table_type = slot_table<typename std::remove_cv<T>::type, Tag>;
+
+    template <typename U>
+    using add_ref_t = typename std::conditional<std::is_void<U>::value,
+                                                void, U&>::type;
+
+public:
+    using element_type = T;
+    using difference_type = std::ptrdiff_t;
+
+    template <typename U>
+    using rebind = slot_ptr<U, Tag>;
+
+    slot_ptr() noexcept = default;
+
+    slot_ptr(std::nullptr_t) noexcept {}
+
+    /// Constructs a slot_ptr to slot index of the table.
+    explicit slot_ptr(std::uint32_t index) noexcept
+        : index_(index)
+    {}
+
+    /// Converting constructor, available if U* is implicitly convertible to T*.
+    template <typename U,
+              typename = typename std::enable_if<
+                    std::is_convertible<U*, T*>::value>::type>
+    slot_ptr(const slot_ptr<U, Tag>& other) noexcept
+        : index_(other.index_)
+    {}
+
+    /// Explicit conversion, as with static_cast<T*>(void_ptr).
+    template <typename U,
+              typename = typename std::enable_if<
+                    !std::is_convertible<U*, T*>::value &&
+                    std::is_void<typename std::remove_cv<U>::type>::value>::type,
+              typename = void>
+    explicit slot_ptr(const slot_ptr<U, Tag>& other) noexcept
+        : index_(other.index_)
+    {}
+
+    /// Returns the slot index, or 0 if this is null.
+    std::uint32_t index() const noexcept { return index_; }
+
+    /// Returns the current address of the target.
+    template <typename U = T,
+              typename = typename std::enable_if<!std::is_void<U>::value>::type>
+    U* get() const noexcept
+    {
+        return index_ ? table_type::instance().address(index_) : nullptr;
+    }
+
+    template <typename U = T,
+              typename = typename std::enable_if<!std::is_void<U>::value>::type>
+    add_ref_t<U> operator*() const noexcept
+    {
+        return *table_type::instance().address(index_);
+    }
+
+    template <typename U = T,
+              typename = typename std::enable_if<!std::is_void<U>::value>::type>
+    U* operator->() const noexcept
+    {
+        return table_type::instance().address(index_);
+    }
+
+    explicit operator bool() const noexcept { return index_ != 0; }
+
+    /// Returns a slot_ptr to r, which must be in slot_table<T, Tag>, for
+    /// std::pointer_traits.
+    template <typename U = T,
+              typename = typename std::enable_if<!std::is_void<U>::value>::type>
+    static slot_ptr pointer_to(U& r) noexcept
+    {
+        return slot_ptr(table_type::instance().index_of(std::addressof(r)));
+    }
+
+    friend bool operator==(const slot_ptr& a, const slot_ptr& b) noexcept
+    {
+        return a.index_ == b.index_;
+    }
+
+    friend bool operator!=(const slot_ptr& a, const slot_ptr& b) noexcept
+    {
+        return a.index_ != b.index_;
+    }
+
+    friend bool operator==(const slot_ptr& a, std::nullptr_t) noexcept { return !a; }
+    friend bool operator==(std::nullptr_t, const slot_ptr& a) noexcept { return !a; }
+    friend bool operator!=(const slot_ptr& a, std::nullptr_t) noexcept { return bool(a); }
+    friend bool operator!=(std::nullptr_t, const slot_ptr& a) noexcept { return bool(a); }
+
+private:
+    std::uint32_t index_ = 0;
+};
+
+/**
+ * A stateless allocator which places single objects in slot_table<T, Tag>
+ * and returns 32-bit slot_ptrs to them.
+ *
+ * With this allocator, allocated_value<T, slot_allocator<T>> is four bytes
+ * in size. Like the table, the allocator must not be used for the same T
+ * and Tag on several threads at once.
+ *
+ * Every slot_allocator<T, Tag> compares equal, but is_always_equal is
+ * false, so that generic code does not take it as a promise that any copy
+ * may be used anywhere: all of them share the one table.
+ */
+template <typename T, typename Tag = void>
+class slot_allocator {
+public:
+    using value_type = T;
+    using pointer = slot_ptr<T, Tag>;
+    using const_pointer = slot_ptr<const T, Tag>;
+    using void_pointer = slot_ptr<void, Tag>;
+    using const_void_pointer = slot_ptr<const void, Tag>;
+    using is_always_equal = std::false_type;
+
+    template <typename U>
+    struct rebind {
+        using other = slot_allocator<U, Tag>;
+    };
+
+    slot_allocator() = default;
+
+    template <typename U>
+    slot_allocator(const slot_allocator<U, Tag>&) noexcept {}
+
+    /// Allocates a single T. Throws std::bad_alloc if n != 1.
+    pointer allocate(std::size_t n)
+    {
+        if (n != 1) {
+            detail::throw_bad_alloc();
+        }
+        return pointer(slot_table<T, Tag>::instance().allocate());
+    }
+
+    void deallocate(pointer p, std::size_t) noexcept
+    {
+        slot_table<T, Tag>::instance().deallocate(p.index());
+    }
+};
+
+template <typename T, typename U, typename Tag>
+bool operator==(const slot_allocator<T, Tag>&, const slot_allocator<U, Tag>&) noexcept
+{
+    return true;
+}
+
+template <typename T, typename U, typename Tag>
+bool operator!=(const slot_allocator<T, Tag>&, const slot_allocator<U, Tag>&) noexcept
+{
+    return false;
+}
+
+}
+
+#undef TRY
+#undef CATCH
+#undef THROW
+
+#endif
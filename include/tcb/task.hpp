@@ -0,0 +1,391 @@
+
+#ifndef TCB_TASK_HPP_INCLUDED
+#define TCB_TASK_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace tcb {
+
+/*
+ * Coroutine frames with allocators
+ *
+ * A promise type deriving from allocator_promise<Alloc> has its coroutine
+ * frames allocated with an Alloc. The allocator is passed to the coroutine
+ * as a leading std::allocator_arg, std::allocator_arg_t pair, after the
+ * object parameter in the case of a member function:
+ *
+ *     task<int, my_alloc<int>> f(std::allocator_arg_t, my_alloc<int> a, int x);
+ *
+ * Calls without the allocator arguments use a default-constructed Alloc,
+ * if it has a default constructor. The allocator is rebound to allocate
+ * whole blocks of __STDCPP_DEFAULT_NEW_ALIGNMENT__ bytes, and a copy is
+ * stored after the frame, where it is found again when the frame is freed.
+ * As with allocated_value, nothing is stored for empty, default
+ * constructible allocators, which are created anew instead.
+ */
+
+namespace detail {
+
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) frame_block {
+    unsigned char bytes[__STDCPP_DEFAULT_NEW_ALIGNMENT__];
+};
+
+}
+
+template <typename Alloc>
+class allocator_promise {
+    using block_allocator =
+        typename std::allocator_traits<Alloc>::template rebind_alloc<detail::frame_block>;
+    using block_traits = std::allocator_traits<block_allocator>;
+
+    static constexpr bool stores_allocator =
+        !(std::is_empty_v<block_allocator> && std::is_default_constructible_v<block_allocator>);
+
+    // The allocator is stored at the first suitably aligned offset after
+    // the frame
+    static constexpr std::size_t allocator_offset(std::size_t size) noexcept
+    {
+        constexpr auto align = alignof(block_allocator);
+        return (size + align - 1) / align * align;
+    }
+
+    static constexpr std::size_t blocks_for(std::size_t size) noexcept
+    {
+        const auto bytes = stores_allocator ? allocator_offset(size) + sizeof(block_allocator)
+                                            : size;
+        return (bytes + sizeof(detail::frame_block) - 1) / sizeof(detail::frame_block);
+    }
+
+    static void* allocate_frame(block_allocator alloc, std::size_t size)
+    {
+        void* frame = detail::to_address(block_traits::allocate(alloc, blocks_for(size)));
+        if constexpr (stores_allocator) {
+            ::new (static_cast<unsigned char*>(frame) + allocator_offset(size))
+                block_allocator(std::move(alloc));
+        }
+        return frame;
+    }
+
+public:
+    static_assert(alignof(block_allocator) <= alignof(detail::frame_block),
+                  "over-aligned allocators cannot be stored in a coroutine frame");
+
+    /// Allocates a frame with a default-constructed allocator.
+    static void* operator new(std::size_t size)
+        requires std::default_initializable<block_allocator>
+    {
+        return allocate_frame(block_allocator(), size);
+    }
+
+    // The overloads taking an allocator are always inlined: without
+    // optimisation, GCC otherwise sees frames freed by the non-template
+    // operator delete below after being allocated by an operator new
+    // template, and warns falsely under -Wmismatched-new-delete, since it
+    // compares the two functions' names.
+
+    /// Allocates the frame of a coroutine called with an allocator.
+    template <typename... Args>
+    [[gnu::always_inline]]
+    static void* operator new(std::size_t size, std::allocator_arg_t, const Alloc& alloc,
+                              const Args&...)
+    {
+        return allocate_frame(block_allocator(alloc), size);
+    }
+
+    /// Allocates the frame of a member function coroutine called with an
+    /// allocator.
+    template <typename This, typename... Args>
+    [[gnu::always_inline]]
+    static void* operator new(std::size_t size, const This&, std::allocator_arg_t,
+                              const Alloc& alloc, const Args&...)
+    {
+        return allocate_frame(block_allocator(alloc), size);
+    }
+
+    static void operator delete(void* frame, std::size_t size) noexcept
+    {
+        auto free_frame = [&](block_allocator& alloc) {
+            using pointer = typename block_traits::pointer;
+            block_traits::deallocate(
+                alloc,
+                std::pointer_traits<pointer>::pointer_to(*static_cast<detail::frame_block*>(frame)),
+                blocks_for(size));
+        };
+
+        if constexpr (stores_allocator) {
+            auto* stored = std::launder(reinterpret_cast<block_allocator*>(
+                static_cast<unsigned char*>(frame) + allocator_offset(size)));
+            block_allocator alloc(std::move(*stored));
+            stored->~block_allocator();
+            free_frame(alloc);
+        } else {
+            block_allocator alloc;
+            free_frame(alloc);
+        }
+    }
+};
+
+/// Results larger than this many bytes are returned from a task through an
+/// allocated_value, rather than being held in the coroutine frame.
+inline constexpr std::size_t task_inline_result_limit = 64;
+
+template <typename T = void, typename Alloc = std::allocator<std::byte>>
+class task;
+
+namespace detail {
+
+template <typename T, typename Alloc>
+class task_promise_base : public allocator_promise<Alloc> {
+public:
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+
+    struct final_awaiter {
+        bool await_ready() const noexcept { return false; }
+
+        template <typename P>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) const noexcept
+        {
+            if (auto c = h.promise().continuation()) {
+                return c;
+            }
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    final_awaiter final_suspend() const noexcept { return {}; }
+
+    std::coroutine_handle<> continuation() const noexcept { return continuation_; }
+    void set_continuation(std::coroutine_handle<> c) noexcept { continuation_ = c; }
+
+private:
+    std::coroutine_handle<> continuation_;
+};
+
+// Holds T itself, or an allocated_value<T> if T is large
+template <typename T, typename Alloc>
+class task_promise : public task_promise_base<T, Alloc> {
+public:
+    using value_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+    static constexpr bool is_boxed = sizeof(T) > task_inline_result_limit;
+    using boxed_type = allocated_value<T, value_allocator>;
+
+    task_promise() requires std::default_initializable<value_allocator> = default;
+
+    // The allocator arguments are seen by the promise as well as by
+    // operator new, so that large results can use the same allocator
+    template <typename... Args>
+    task_promise(std::allocator_arg_t, const Alloc& alloc, const Args&...)
+        : alloc_(alloc)
+    {}
+
+    template <typename This, typename... Args>
+    task_promise(const This&, std::allocator_arg_t, const Alloc& alloc, const Args&...)
+        : alloc_(alloc)
+    {}
+
+    task<T, Alloc> get_return_object() noexcept;
+
+    void unhandled_exception() noexcept
+    {
+        result_.template emplace<std::exception_ptr>(std::current_exception());
+    }
+
+    template <typename U = T>
+        requires std::constructible_from<T, U&&>
+    void return_value(U&& value)
+    {
+        if constexpr (is_boxed) {
+            result_.template emplace<1>(std::allocator_arg, alloc_, in_place,
+                                        std::forward<U>(value));
+        } else {
+            result_.template emplace<1>(std::forward<U>(value));
+        }
+    }
+
+    T& result() &
+    {
+        rethrow_if_failed();
+        if constexpr (is_boxed) {
+            return *std::get<1>(result_);
+        } else {
+            return std::get<1>(result_);
+        }
+    }
+
+    T&& result() && { return std::move(result()); }
+
+    boxed_type take() requires is_boxed
+    {
+        rethrow_if_failed();
+        return std::move(std::get<1>(result_));
+    }
+
+private:
+    void rethrow_if_failed() const
+    {
+        if (const auto* e = std::get_if<std::exception_ptr>(&result_)) {
+            std::rethrow_exception(*e);
+        }
+    }
+
+    using stored_type = std::conditional_t<is_boxed, boxed_type, T>;
+
+    [[no_unique_address]] value_allocator alloc_;
+    std::variant<std::monostate, stored_type, std::exception_ptr> result_;
+};
+
+template <typename Alloc>
+class task_promise<void, Alloc> : public task_promise_base<void, Alloc> {
+public:
+    static constexpr bool is_boxed = false;
+
+    task<void, Alloc> get_return_object() noexcept;
+
+    void unhandled_exception() noexcept { error_ = std::current_exception(); }
+
+    void return_void() noexcept {}
+
+    void result() const
+    {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+    }
+
+private:
+    std::exception_ptr error_;
+};
+
+}
+
+/**
+ * A lazily started coroutine returning a T, whose frame is allocated with
+ * an Alloc.
+ *
+ * A task does not run until it is awaited, or started with start(). Once
+ * it completes, whoever is awaiting it is resumed, by symmetric transfer,
+ * with the result or the exception which escaped the coroutine.
+ *
+ * co_await on an lvalue task yields a reference to the result, which lives
+ * as long as the task; on an rvalue task, it yields the result by value.
+ *
+ * Results larger than task_inline_result_limit bytes are constructed in
+ * an allocated_value using the task's allocator, keeping the frame small.
+ * take() hands over that allocated_value without moving the result again.
+ */
+template <typename T, typename Alloc>
+class [[nodiscard]] task {
+public:
+    using promise_type = detail::task_promise<T, Alloc>;
+    using value_type = T;
+    using allocator_type = Alloc;
+
+    task(task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+    task& operator=(task&& other) noexcept
+    {
+        if (this != &other) {
+            destroy();
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+
+    ~task() { destroy(); }
+
+    /// Returns true once the coroutine has finished.
+    bool done() const noexcept { return !handle_ || handle_.done(); }
+
+    /// Runs the coroutine from a caller which is not itself a coroutine,
+    /// until it completes or first suspends.
+    void start() { handle_.resume(); }
+
+    /// Returns the result of a completed task, rethrowing any exception
+    /// which escaped the coroutine.
+    decltype(auto) get() & { return handle_.promise().result(); }
+    /// @overload
+    decltype(auto) get() && { return std::move(handle_.promise()).result(); }
+
+    /// Takes the allocated_value holding a large result.
+    auto take()
+        requires promise_type::is_boxed
+    {
+        return handle_.promise().take();
+    }
+
+    auto operator co_await() & noexcept { return awaiter<false>{handle_}; }
+    auto operator co_await() && noexcept { return awaiter<true>{handle_}; }
+
+private:
+    friend promise_type;
+
+    // Awaiting a temporary task destroys it, with its frame, at the end of
+    // the co_await expression, so the result is returned by value
+    template <bool Rvalue>
+    struct awaiter {
+        using result_type =
+            std::conditional_t<Rvalue, T, decltype(std::declval<promise_type&>().result())>;
+
+        bool await_ready() const noexcept { return !handle || handle.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle.promise().set_continuation(awaiting);
+            return handle;
+        }
+
+        result_type await_resume()
+        {
+            if constexpr (Rvalue) {
+                return std::move(handle.promise()).result();
+            } else {
+                return handle.promise().result();
+            }
+        }
+
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    explicit task(std::coroutine_handle<promise_type> h) noexcept : handle_(h) {}
+
+    void destroy() noexcept
+    {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T, typename Alloc>
+task<T, Alloc> task_promise<T, Alloc>::get_return_object() noexcept
+{
+    return task<T, Alloc>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+template <typename Alloc>
+task<void, Alloc> task_promise<void, Alloc>::get_return_object() noexcept
+{
+    return task<void, Alloc>(std::coroutine_handle<task_promise>::from_promise(*this));
+}
+
+}
+
+}
+
+#endif
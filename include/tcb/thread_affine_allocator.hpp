@@ -0,0 +1,320 @@
+
+#ifndef TCB_THREAD_AFFINE_ALLOCATOR_HPP_INCLUDED
+#define TCB_THREAD_AFFINE_ALLOCATOR_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace tcb {
+
+namespace detail {
+
+class return_queue;
+
+// Returns a block taken from a return queue to the allocator which made it
+using release_fn = void (*)(return_queue&, void*, std::size_t);
+
+// Written over the start of a block returned from a foreign thread. The
+// block may be less aligned than this struct, so it is accessed by memcpy.
+struct returned_block {
+    void* next;
+    std::size_t n;
+    release_fn release;
+};
+
+// Blocks freed on foreign threads, waiting to be passed back to the
+// underlying allocator by the owning thread. Any thread may push; only the
+// owner pops, by taking the whole list at once, so there is no ABA problem.
+//
+// One queue is shared by an adaptor and all of its copies and rebinds, so
+// each block records how to free itself.
+class return_queue {
+public:
+    explicit return_queue(std::thread::id owner) noexcept : owner_(owner) {}
+
+    return_queue(const return_queue&) = delete;
+    return_queue& operator=(const return_queue&) = delete;
+
+    virtual ~return_queue() = default;
+
+    std::thread::id owner() const noexcept { return owner_; }
+
+    void push(void* p, std::size_t n, release_fn release) noexcept
+    {
+        returned_block b{head_.load(std::memory_order_relaxed), n, release};
+        do {
+            std::memcpy(p, &b, sizeof(b));
+        } while (!head_.compare_exchange_weak(b.next, p, std::memory_order_release,
+                                              std::memory_order_relaxed));
+        pending_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Returns every queued block to its allocator. Owner thread only.
+    std::size_t drain() noexcept
+    {
+        if (!head_.load(std::memory_order_relaxed)) {
+            return 0;
+        }
+        void* p = head_.exchange(nullptr, std::memory_order_acquire);
+        std::size_t count = 0;
+        while (p) {
+            returned_block b;
+            std::memcpy(&b, p, sizeof(b));
+            b.release(*this, p, b.n);
+            p = b.next;
+            ++count;
+        }
+        pending_.fetch_sub(count, std::memory_order_relaxed);
+        return count;
+    }
+
+    std::size_t pending() const noexcept
+    {
+        return pending_.load(std::memory_order_relaxed);
+    }
+
+private:
+    const std::thread::id owner_;
+    std::atomic<void*> head_{nullptr};
+    std::atomic<std::size_t> pending_{0};
+};
+
+// Holds the underlying allocator, rebound to bytes, from which each block's
+// release function makes an allocator of the block's own type
+template <typename ByteAlloc>
+class allocator_return_queue : public return_queue {
+public:
+    allocator_return_queue(const ByteAlloc& alloc, std::thread::id owner)
+        : return_queue(owner), alloc_(alloc)
+    {}
+
+    // Blocks still queued are leaked, rather than freed on the wrong
+    // thread. The owner's registry keeps the queue alive until the owning
+    // thread exits, so this only happens to blocks returned after that.
+    ~allocator_return_queue()
+    {
+        if (std::this_thread::get_id() == owner()) {
+            drain();
+        }
+    }
+
+    const ByteAlloc& underlying() const noexcept { return alloc_; }
+
+private:
+    ByteAlloc alloc_;
+};
+
+// The queues created on a thread. Holding a reference to each means that
+// the last reference to a queue is dropped on the owning thread, where the
+// queue's destructor can drain it, unless the owning thread has exited.
+class return_queue_registry {
+public:
+    return_queue_registry() = default;
+    return_queue_registry(const return_queue_registry&) = delete;
+    return_queue_registry& operator=(const return_queue_registry&) = delete;
+
+    static return_queue_registry& local()
+    {
+        static thread_local return_queue_registry registry;
+        return registry;
+    }
+
+    void add(std::shared_ptr<return_queue> q)
+    {
+        if (queues_.size() == queues_.capacity()) {
+            release_orphans();
+        }
+        queues_.push_back(std::move(q));
+    }
+
+    // Drains every queue, and releases those no adaptor refers to any more
+    std::size_t drain_all() noexcept
+    {
+        std::size_t count = 0;
+        for (auto& q : queues_) {
+            count += q->drain();
+        }
+        release_orphans();
+        return count;
+    }
+
+private:
+    void release_orphans() noexcept
+    {
+        auto out = queues_.begin();
+        for (auto& q : queues_) {
+            if (q.use_count() == 1) {
+                // No adaptor can copy it any more; destroying it here
+                // drains it on the owning thread
+                q.reset();
+            } else {
+                *out++ = std::move(q);
+            }
+        }
+        queues_.erase(out, queues_.end());
+    }
+
+    std::vector<std::shared_ptr<return_queue>> queues_;
+};
+
+}
+
+/**
+ * Returns the blocks queued for every thread_affine_allocator owned by the
+ * calling thread, including those whose adaptors have all been destroyed,
+ * to their underlying allocators. Returns the number of blocks freed.
+ */
+inline std::size_t drain_thread_affine_allocators() noexcept
+{
+    return detail::return_queue_registry::local().drain_all();
+}
+
+/**
+ * An allocator adaptor which makes a thread-affine allocator safe to
+ * deallocate from other threads.
+ *
+ * Some allocators, such as arena and stack allocators, may only be used on
+ * the thread which owns their memory. Wrapping one in a
+ * thread_affine_allocator records the thread which constructed the
+ * adaptor as the owner. Deallocations on the owning thread go straight to
+ * the underlying allocator. A deallocation on any other thread instead
+ * pushes the block onto a lock-free return queue, and the owner passes
+ * the queued blocks back to the underlying allocator at the start of its
+ * next allocate(), or when it calls drain().
+ *
+ * An allocated_value using this adaptor can therefore be moved to another
+ * thread, and destroyed there, without copying its value.
+ *
+ * The underlying allocator must use raw pointers. Each block is made large
+ * enough to hold a queue link, so very small single objects may take more
+ * space than they would otherwise.
+ *
+ * Blocks are only ever freed on the owning thread. The adaptor and all of
+ * its copies and rebinds share one return queue, which is also held by a
+ * registry on the owning thread, so destroying the last copy of the adaptor
+ * on another thread does not free anything there. Blocks queued after the
+ * owner has destroyed its copies are freed by
+ * drain_thread_affine_allocators(), by the owner's next construction of a
+ * thread_affine_allocator, or when the owning thread exits; blocks
+ * returned after the owning thread has exited are leaked. As before, the
+ * owner should drain before the underlying memory goes away.
+ */
+template <typename Alloc>
+class thread_affine_allocator {
+    using traits = std::allocator_traits<Alloc>;
+    using byte_allocator = typename traits::template rebind_alloc<unsigned char>;
+    using queue_type = detail::allocator_return_queue<byte_allocator>;
+
+    template <typename A>
+    friend class thread_affine_allocator;
+
+public:
+    using value_type = typename traits::value_type;
+    using underlying_allocator = Alloc;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    static_assert(std::is_same<typename traits::pointer, value_type*>::value,
+                  "thread_affine_allocator requires an allocator with raw pointers");
+
+    template <typename U>
+    struct rebind {
+        using other = thread_affine_allocator<typename traits::template rebind_alloc<U>>;
+    };
+
+    /// Wraps alloc, with the calling thread as the owner.
+    thread_affine_allocator(const Alloc& alloc)
+        : alloc_(alloc),
+          queue_(std::make_shared<queue_type>(byte_allocator(alloc), std::this_thread::get_id()))
+    {
+        detail::return_queue_registry::local().add(queue_);
+    }
+
+    /// Rebinding constructor. The result has the same owner, and shares the
+    /// return queue of other.
+    template <typename A>
+    thread_affine_allocator(const thread_affine_allocator<A>& other) noexcept
+        : alloc_(other.alloc_), queue_(other.queue_)
+    {}
+
+    /// Allocates from the underlying allocator, first draining the return
+    /// queue if called on the owning thread.
+    value_type* allocate(std::size_t n)
+    {
+        if (on_owner_thread()) {
+            queue_->drain();
+        }
+        return traits::allocate(alloc_, block_size(n));
+    }
+
+    /// Frees p directly on the owning thread, and queues it otherwise.
+    void deallocate(value_type* p, std::size_t n) noexcept
+    {
+        if (on_owner_thread()) {
+            traits::deallocate(alloc_, p, block_size(n));
+        } else {
+            queue_->push(static_cast<void*>(p), block_size(n), &release);
+        }
+    }
+
+    /// Returns queued blocks to the underlying allocator. Must be called on
+    /// the owning thread. Returns the number of blocks freed.
+    std::size_t drain() noexcept { return queue_->drain(); }
+
+    /// Returns the number of blocks waiting in the return queue.
+    std::size_t pending() const noexcept { return queue_->pending(); }
+
+    /// Returns the id of the owning thread.
+    std::thread::id owner() const noexcept { return queue_->owner(); }
+
+    bool on_owner_thread() const noexcept
+    {
+        return std::this_thread::get_id() == queue_->owner();
+    }
+
+    const Alloc& underlying() const noexcept { return alloc_; }
+
+    friend bool operator==(const thread_affine_allocator& lhs,
+                           const thread_affine_allocator& rhs) noexcept
+    {
+        return lhs.owner() == rhs.owner() && lhs.underlying() == rhs.underlying();
+    }
+
+    friend bool operator!=(const thread_affine_allocator& lhs,
+                           const thread_affine_allocator& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+private:
+    // Elements to request so that the block can hold a queue link
+    static std::size_t block_size(std::size_t n) noexcept
+    {
+        constexpr std::size_t min_n = (sizeof(detail::returned_block) + sizeof(value_type) - 1) /
+                                      sizeof(value_type);
+        return n < min_n ? min_n : n;
+    }
+
+    // Frees a block from the queue, with an Alloc made from the queue's
+    static void release(detail::return_queue& q, void* p, std::size_t n) noexcept
+    {
+        Alloc alloc(static_cast<queue_type&>(q).underlying());
+        traits::deallocate(alloc, static_cast<value_type*>(p), n);
+    }
+
+    Alloc alloc_;
+    std::shared_ptr<queue_type> queue_;
+};
+
+}
+
+#endif
@@ -0,0 +1,494 @@
+
+#ifndef TCB_VALUE_SOA_HPP_INCLUDED
+#define TCB_VALUE_SOA_HPP_INCLUDED
+
+#include "allocated_value.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace tcb {
+
+/**
+ * Lists the data members of T which a value_soa<T> stores, as a tuple of
+ * pointers to members. Specialise this for each type to be stored, e.g.
+ *
+ *     template <>
+ *     struct tcb::soa_fields<particle> {
+ *         static constexpr auto members =
+ *                 std::make_tuple(&particle::x, &particle::y, &particle::mass);
+ *     };
+ *
+ * Members which are not listed are not stored, and are value-initialised
+ * when an element is copied out.
+ */
+template <typename T>
+struct soa_fields;
+
+/**
+ * A view of one field of every element of a value_soa.
+ *
+ * The data is aligned to value_soa's alignment and the underlying storage
+ * extends to a multiple of that many bytes, so vectorised loops may use
+ * aligned loads and may read (but not write) past size() up to the end of
+ * the final block. Such padding reads as zero.
+ */
+template <typename M>
+class field_span {
+public:
+    using element_type = M;
+    using value_type = std::remove_cv_t<M>;
+    using iterator = M*;
+
+    constexpr field_span(M* data, std::size_t size) noexcept
+        : data_(data), size_(size)
+    {}
+
+    constexpr M* data() const noexcept { return data_; }
+    constexpr std::size_t size() const noexcept { return size_; }
+    constexpr bool empty() const noexcept { return size_ == 0; }
+
+    constexpr M* begin() const noexcept { return data_; }
+    constexpr M* end() const noexcept { return data_ + size_; }
+
+    constexpr M& operator[](std::size_t i) const noexcept { return data_[i]; }
+
+private:
+    M* data_;
+    std::size_t size_;
+};
+
+namespace detail {
+
+// The unit in which field arrays are allocated
+struct alignas(64) soa_block {
+    unsigned char bytes[64];
+};
+
+template <typename P>
+struct member_pointer_traits;
+
+template <typename C, typename M>
+struct member_pointer_traits<M C::*> {
+    using class_type = C;
+    using member_type = M;
+};
+
+}
+
+/**
+ * A sequence of T stored as a structure of arrays.
+ *
+ * Each field listed in soa_fields<T> is kept in its own contiguous array,
+ * obtained from a rebound copy of Alloc, so a loop which touches one field
+ * of many elements reads only that field's memory and can be vectorised.
+ * field<&T::member>() returns a field_span over one such array.
+ *
+ * Elements are not stored as T objects. operator[] returns a reference
+ * proxy, which converts to a copy of the element, and copy_out() returns
+ * the element as an independent allocated_value<T, Alloc>. Either way the
+ * copy is unaffected by later changes to the container.
+ *
+ * Assignment and swap follow Alloc's propagation traits, as
+ * allocated_value's do: where the allocator does not propagate and the
+ * two allocators compare unequal, the elements are copied into storage
+ * from the container's own allocator instead.
+ *
+ * Every listed field must be trivially copyable, and T must be default
+ * constructible.
+ */
+template <typename T, typename Alloc = std::allocator<T>>
+class value_soa {
+    static constexpr auto members = soa_fields<T>::members;
+    static constexpr std::size_t num_fields = std::tuple_size<decltype(members)>::value;
+
+    template <std::size_t I>
+    using member_pointer_t = std::remove_cv_t<std::tuple_element_t<I, decltype(members)>>;
+
+    using alloc_traits = std::allocator_traits<Alloc>;
+    using block_alloc = typename alloc_traits::template rebind_alloc<detail::soa_block>;
+    using block_traits = std::allocator_traits<block_alloc>;
+    using block_pointer = typename block_traits::pointer;
+
+    using indices = std::make_index_sequence<num_fields>;
+
+public:
+    using value_type = T;
+    using allocator_type = Alloc;
+    using size_type = std::size_t;
+
+    /// Alignment, in bytes, of every field array.
+    static constexpr std::size_t alignment = alignof(detail::soa_block);
+
+    /// The type of the Ith listed field.
+    template <std::size_t I>
+    using field_type = typename detail::member_pointer_traits<member_pointer_t<I>>::member_type;
+
+    /// A proxy for one element, returned by the non-const operator[].
+    class reference {
+    public:
+        /// Returns a copy of the element.
+        operator T() const { return soa_->get(index_); }
+
+        /// Overwrites the element's fields with those of value.
+        reference& operator=(const T& value)
+        {
+            soa_->set(index_, value);
+            return *this;
+        }
+
+        /// Returns a reference to one field of the element.
+        template <auto Member>
+        auto& get() const noexcept { return soa_->template field<Member>()[index_]; }
+
+    private:
+        friend class value_soa;
+
+        reference(value_soa* soa, std::size_t index) noexcept
+            : soa_(soa), index_(index)
+        {}
+
+        value_soa* soa_;
+        std::size_t index_;
+    };
+
+    value_soa() = default;
+
+    explicit value_soa(const allocator_type& alloc)
+        : alloc_(alloc)
+    {}
+
+    value_soa(const value_soa& other)
+        : value_soa(other, alloc_traits::select_on_container_copy_construction(other.alloc_))
+    {}
+
+    /// Copies other, using the given allocator.
+    value_soa(const value_soa& other, const allocator_type& alloc)
+        : alloc_(alloc)
+    {
+        reserve(other.size_);
+        copy_fields_from(other, indices{});
+        size_ = other.size_;
+    }
+
+    value_soa(value_soa&& other) noexcept
+        : alloc_(std::move(other.alloc_)),
+          blocks_(other.blocks_),
+          size_(other.size_),
+          capacity_(other.capacity_)
+    {
+        other.blocks_ = {};
+        other.size_ = 0;
+        other.capacity_ = 0;
+    }
+
+    value_soa& operator=(const value_soa& other)
+    {
+        if (this != &other) {
+            if constexpr (alloc_traits::propagate_on_container_copy_assignment::value) {
+                value_soa temp(other, other.alloc_);
+                swap_storage(temp);
+                std::swap(alloc_, temp.alloc_);
+            } else {
+                value_soa temp(other, alloc_);
+                swap_storage(temp);
+            }
+        }
+        return *this;
+    }
+
+    value_soa& operator=(value_soa&& other)
+        noexcept(alloc_traits::propagate_on_container_move_assignment::value ||
+                 alloc_traits::is_always_equal::value)
+    {
+        if (this == &other) {
+            return *this;
+        }
+        if constexpr (alloc_traits::propagate_on_container_move_assignment::value) {
+            value_soa temp(std::move(other));
+            swap_storage(temp);
+            std::swap(alloc_, temp.alloc_);
+        } else if (alloc_ == other.alloc_) {
+            value_soa temp(std::move(other));
+            swap_storage(temp);
+        } else {
+            // The fields are trivially copyable, so moving is copying
+            value_soa temp(other, alloc_);
+            swap_storage(temp);
+        }
+        return *this;
+    }
+
+    ~value_soa()
+    {
+        deallocate_all(blocks_, capacity_, indices{});
+    }
+
+    void swap(value_soa& other)
+        noexcept(alloc_traits::propagate_on_container_swap::value ||
+                 alloc_traits::is_always_equal::value)
+    {
+        if constexpr (alloc_traits::propagate_on_container_swap::value) {
+            std::swap(alloc_, other.alloc_);
+            swap_storage(other);
+        } else if (alloc_ == other.alloc_) {
+            swap_storage(other);
+        } else {
+            // Each side's elements are copied into storage from the other
+            // side's allocator
+            value_soa mine(other, alloc_);
+            value_soa theirs(*this, other.alloc_);
+            swap_storage(mine);
+            other.swap_storage(theirs);
+        }
+    }
+
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return capacity_; }
+    bool empty() const noexcept { return size_ == 0; }
+
+    allocator_type get_allocator() const { return alloc_; }
+
+    /// Ensures capacity for at least n elements.
+    void reserve(std::size_t n)
+    {
+        if (n <= capacity_) {
+            return;
+        }
+        std::array<block_pointer, num_fields> blocks{};
+        allocate_all(blocks, n, indices{});
+        move_fields(blocks, indices{});
+        deallocate_all(blocks_, capacity_, indices{});
+        blocks_ = blocks;
+        capacity_ = n;
+    }
+
+    void push_back(const T& value)
+    {
+        if (size_ == capacity_) {
+            reserve(capacity_ == 0 ? alignment : 2 * capacity_);
+        }
+        set(size_, value);
+        ++size_;
+    }
+
+    /// Removes the last element, which must exist, zeroing its fields.
+    void pop_back() noexcept
+    {
+        assert(size_ > 0);
+        --size_;
+        zero_fields(size_, 1, indices{});
+    }
+
+    /// Removes every element, zeroing their fields.
+    void clear() noexcept
+    {
+        zero_fields(0, size_, indices{});
+        size_ = 0;
+    }
+
+    /// Returns a copy of element i.
+    T get(std::size_t i) const
+    {
+        T value{};
+        get_fields(value, i, indices{});
+        return value;
+    }
+
+    /// Overwrites the fields of element i with those of value.
+    void set(std::size_t i, const T& value) noexcept
+    {
+        set_fields(value, i, indices{});
+    }
+
+    /// Returns a copy of element i.
+    T operator[](std::size_t i) const { return get(i); }
+
+    /// Returns a proxy for element i.
+    reference operator[](std::size_t i) noexcept { return reference(this, i); }
+
+    /// Returns a copy of element i in its own allocation.
+    allocated_value<T, Alloc> copy_out(std::size_t i) const
+    {
+        return allocated_value<T, Alloc>(std::allocator_arg, alloc_, in_place, get(i));
+    }
+
+    /// Returns a span over the Ith listed field of every element.
+    template <std::size_t I>
+    field_span<field_type<I>> field() noexcept
+    {
+        return {data<I>(), size_};
+    }
+
+    /// @overload
+    template <std::size_t I>
+    field_span<const field_type<I>> field() const noexcept
+    {
+        return {data<I>(), size_};
+    }
+
+    /// Returns a span over the field Member (which must be listed) of
+    /// every element.
+    template <auto Member, typename = std::enable_if_t<
+                  std::is_member_object_pointer<decltype(Member)>::value>>
+    auto field() noexcept
+    {
+        constexpr auto index = index_of<Member>(indices{});
+        static_assert(index < num_fields, "member is not listed in soa_fields<T>");
+        return field<index>();
+    }
+
+    /// @overload
+    template <auto Member, typename = std::enable_if_t<
+                  std::is_member_object_pointer<decltype(Member)>::value>>
+    auto field() const noexcept
+    {
+        constexpr auto index = index_of<Member>(indices{});
+        static_assert(index < num_fields, "member is not listed in soa_fields<T>");
+        return field<index>();
+    }
+
+private:
+    // Returns the position of Member in the field list, or num_fields
+    template <auto Member, std::size_t... Is>
+    static constexpr std::size_t index_of(std::index_sequence<Is...>)
+    {
+        std::size_t index = num_fields;
+        ((same_member<Member>(std::get<Is>(members)) ? (index = Is, true) : false) || ...);
+        return index;
+    }
+
+    template <auto Member, typename P>
+    static constexpr bool same_member(P p)
+    {
+        if constexpr (std::is_same<decltype(Member), P>::value) {
+            return p == Member;
+        } else {
+            return false;
+        }
+    }
+
+    static constexpr std::size_t blocks_for(std::size_t n, std::size_t size) noexcept
+    {
+        return (n * size + sizeof(detail::soa_block) - 1) / sizeof(detail::soa_block);
+    }
+
+    template <std::size_t I>
+    field_type<I>* data() const noexcept
+    {
+        if (!blocks_[I]) {
+            return nullptr;
+        }
+        return reinterpret_cast<field_type<I>*>(detail::to_address(blocks_[I]));
+    }
+
+    template <std::size_t... Is>
+    void allocate_all(std::array<block_pointer, num_fields>& blocks, std::size_t n,
+                      std::index_sequence<Is...>)
+    {
+        static_assert((std::is_trivially_copyable<field_type<Is>>::value && ...),
+                      "value_soa fields must be trivially copyable");
+
+        // Frees any arrays already allocated if a later one fails
+        struct guard {
+            value_soa* self;
+            std::array<block_pointer, num_fields>& blocks;
+            std::size_t n;
+            bool done;
+            ~guard() { if (!done) { self->deallocate_all(blocks, n, indices{}); } }
+        };
+
+        block_alloc a(alloc_);
+        guard g{this, blocks, n, false};
+        ((blocks[Is] = block_traits::allocate(a, blocks_for(n, sizeof(field_type<Is>))),
+          std::memset(detail::to_address(blocks[Is]), 0,
+                      blocks_for(n, sizeof(field_type<Is>)) * sizeof(detail::soa_block))), ...);
+        g.done = true;
+    }
+
+    template <std::size_t... Is>
+    void deallocate_all(std::array<block_pointer, num_fields>& blocks, std::size_t n,
+                        std::index_sequence<Is...>) noexcept
+    {
+        block_alloc a(alloc_);
+        ((blocks[Is] ? block_traits::deallocate(a, blocks[Is],
+                                                blocks_for(n, sizeof(field_type<Is>)))
+                     : void()), ...);
+        blocks = {};
+    }
+
+    template <std::size_t... Is>
+    void move_fields(std::array<block_pointer, num_fields>& blocks,
+                     std::index_sequence<Is...>) noexcept
+    {
+        if (size_ == 0) {
+            return;
+        }
+        (std::memcpy(detail::to_address(blocks[Is]), data<Is>(),
+                     size_ * sizeof(field_type<Is>)), ...);
+    }
+
+    template <std::size_t... Is>
+    void copy_fields_from(const value_soa& other, std::index_sequence<Is...>) noexcept
+    {
+        if (other.size_ == 0) {
+            return;
+        }
+        (std::memcpy(data<Is>(), other.template data<Is>(),
+                     other.size_ * sizeof(field_type<Is>)), ...);
+    }
+
+    template <std::size_t... Is>
+    void zero_fields(std::size_t first, std::size_t count, std::index_sequence<Is...>) noexcept
+    {
+        if (count == 0) {
+            return;
+        }
+        (std::memset(static_cast<void*>(data<Is>() + first), 0,
+                     count * sizeof(field_type<Is>)), ...);
+    }
+
+    // Swaps everything but the allocators
+    void swap_storage(value_soa& other) noexcept
+    {
+        using std::swap;
+        swap(blocks_, other.blocks_);
+        swap(size_, other.size_);
+        swap(capacity_, other.capacity_);
+    }
+
+    template <std::size_t... Is>
+    void get_fields(T& value, std::size_t i, std::index_sequence<Is...>) const noexcept
+    {
+        ((value.*std::get<Is>(members) = data<Is>()[i]), ...);
+    }
+
+    template <std::size_t... Is>
+    void set_fields(const T& value, std::size_t i, std::index_sequence<Is...>) noexcept
+    {
+        (::new (static_cast<void*>(data<Is>() + i))
+                field_type<Is>(value.*std::get<Is>(members)), ...);
+    }
+
+    Alloc alloc_{};
+    std::array<block_pointer, num_fields> blocks_{};
+    std::size_t size_ = 0;
+    std::size_t capacity_ = 0;
+};
+
+template <typename T, typename A>
+void swap(value_soa<T, A>& first, value_soa<T, A>& second) noexcept(noexcept(first.swap(second)))
+{
+    first.swap(second);
+}
+
+}
+
+#endif
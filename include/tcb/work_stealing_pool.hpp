@@ -0,0 +1,348 @@
+
+#ifndef TCB_WORK_STEALING_POOL_HPP_INCLUDED
+#define TCB_WORK_STEALING_POOL_HPP_INCLUDED
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace tcb {
+
+#ifndef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+# if !(defined(__cpp_exceptions) || defined(_CPPUNWIND))
+#   define TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+# endif
+#endif
+
+#ifdef TCB_ALLOCATED_VALUE_NO_EXCEPTIONS
+#define TRY
+#define CATCH(X) if (false)
+#define THROW
+#else
+#define TRY try
+#define CATCH catch
+#define THROW throw
+#endif
+
+/**
+ * A fork-join thread pool with work stealing.
+ *
+ * run() executes a function on the calling thread, which acts as worker 0
+ * for the duration of the call, while the pool's own threads steal any work
+ * it forks. Work is forked with worker::for_each(), which splits an index
+ * range in half, leaves one half where other workers can steal it and
+ * carries on with the other, then waits for the stolen half before
+ * returning. Ranges are only split while the worker has nothing else on
+ * offer to thieves, so forking costs little when every worker is busy.
+ *
+ * Each worker keeps its forked tasks in a deque, taking them back from the
+ * end while thieves steal from the front, so a thief takes the largest
+ * outstanding piece of work. A worker waiting for a stolen task steals from
+ * others in the meantime.
+ *
+ * Calls to run() are serialised, and must not be made from inside a task.
+ */
+class work_stealing_pool {
+public:
+    class worker;
+
+    /// Creates a pool of the given number of workers, counting the thread
+    /// which calls run().
+    explicit work_stealing_pool(std::size_t workers = default_size());
+
+    work_stealing_pool(const work_stealing_pool&) = delete;
+    work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+    ~work_stealing_pool();
+
+    /// Returns the number of workers, including the calling thread.
+    std::size_t size() const noexcept { return workers_.size(); }
+
+    /**
+     * Calls f(w) on this thread, where w is worker 0, with the other workers
+     * stealing whatever it forks. Exceptions thrown by f, or by any task it
+     * forks, propagate out of run().
+     */
+    template <typename F>
+    void run(F&& f);
+
+    /// Calls f(w, i) for each i in [first, last), in parallel.
+    template <typename F>
+    void for_each(std::size_t first, std::size_t last, F&& f);
+
+    static std::size_t default_size() noexcept
+    {
+        const auto n = std::thread::hardware_concurrency();
+        return n > 0 ? n : 1;
+    }
+
+private:
+    void thread_main(worker& w);
+
+    // Runs one task stolen from another worker, if there is one
+    bool help(worker& self);
+
+    std::vector<std::unique_ptr<worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::mutex run_mutex_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> running_{false};
+    bool stop_ = false;
+};
+
+/**
+ * One of a work_stealing_pool's workers.
+ *
+ * A worker is only ever used by the thread it belongs to, and is passed to
+ * every function the pool runs.
+ */
+class work_stealing_pool::worker {
+    friend class work_stealing_pool;
+
+public:
+    /// Returns this worker's index, in [0, pool().size()).
+    std::size_t index() const noexcept { return index_; }
+
+    work_stealing_pool& pool() const noexcept { return *pool_; }
+
+    /**
+     * Calls f(w, i) for each i in [first, last), where w is the worker
+     * running that call, and returns once every call has finished. f may
+     * itself fork further work through w.
+     *
+     * If any call throws, the remaining calls in its half of the range are
+     * skipped and the exception is rethrown once the other half is done.
+     */
+    template <typename F>
+    void for_each(std::size_t first, std::size_t last, F& f)
+    {
+        while (first != last) {
+            if (last - first > 1 && should_split()) {
+                const auto mid = first + (last - first) / 2;
+                range_task<F> right(mid, last, f);
+                push(right);
+                TRY {
+                    for_each(first, mid, f);
+                } CATCH (...) {
+                    // The rest of the range is abandoned unless already stolen
+                    if (!take_back(right)) {
+                        wait(right);
+                    }
+                    THROW;
+                }
+                join(right);
+                return;
+            }
+            f(*this, first++);
+        }
+    }
+
+private:
+    // A piece of forked work. Tasks live in the stack frame which forked
+    // them, and that frame waits for them before returning.
+    struct task {
+        explicit task(void (*run)(task&, worker&)) noexcept : run(run) {}
+
+        void (*run)(task&, worker&);
+        std::exception_ptr error;
+        std::atomic<bool> done{false};
+    };
+
+    template <typename F>
+    struct range_task : task {
+        range_task(std::size_t first, std::size_t last, F& f) noexcept
+            : task(&execute), first(first), last(last), f(&f)
+        {}
+
+        static void execute(task& t, worker& w)
+        {
+            auto& self = static_cast<range_task&>(t);
+            w.for_each(self.first, self.last, *self.f);
+        }
+
+        std::size_t first;
+        std::size_t last;
+        F* f;
+    };
+
+    worker(work_stealing_pool& pool, std::size_t index) : pool_(&pool), index_(index) {}
+
+    // Only split when there is nothing already waiting to be stolen
+    bool should_split() const noexcept
+    {
+        return pool_->size() > 1 && queued_.load(std::memory_order_relaxed) == 0;
+    }
+
+    void push(task& t)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(&t);
+        queued_.store(tasks_.size(), std::memory_order_relaxed);
+    }
+
+    // Takes t back if it has not been stolen. Anything forked after t has
+    // already been joined, so if t is still here it is at the back.
+    bool take_back(task& t)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty() || tasks_.back() != &t) {
+            return false;
+        }
+        tasks_.pop_back();
+        queued_.store(tasks_.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    task* steal()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (tasks_.empty()) {
+            return nullptr;
+        }
+        task* t = tasks_.front();
+        tasks_.pop_front();
+        queued_.store(tasks_.size(), std::memory_order_relaxed);
+        return t;
+    }
+
+    void execute(task& t) noexcept
+    {
+        TRY {
+            t.run(t, *this);
+        } CATCH (...) {
+            t.error = std::current_exception();
+        }
+        // The forking frame may return as soon as it sees this
+        t.done.store(true, std::memory_order_release);
+    }
+
+    // Helps out with other work until the thief running t has finished it
+    void wait(task& t)
+    {
+        while (!t.done.load(std::memory_order_acquire)) {
+            if (!pool_->help(*this)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Runs t here if it is still ours, and otherwise waits for it
+    void join(task& t)
+    {
+        if (take_back(t)) {
+            execute(t);
+        } else {
+            wait(t);
+        }
+        if (t.error) {
+            std::rethrow_exception(t.error);
+        }
+    }
+
+    work_stealing_pool* pool_;
+    const std::size_t index_;
+    std::mutex mutex_;
+    std::deque<task*> tasks_;
+    std::atomic<std::size_t> queued_{0};
+};
+
+inline work_stealing_pool::work_stealing_pool(std::size_t workers)
+{
+    if (workers == 0) {
+        workers = 1;
+    }
+    workers_.reserve(workers);
+    for (std::size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back(new worker(*this, i));
+    }
+    threads_.reserve(workers - 1);
+    for (std::size_t i = 1; i < workers; ++i) {
+        threads_.emplace_back(&work_stealing_pool::thread_main, this, std::ref(*workers_[i]));
+    }
+}
+
+inline work_stealing_pool::~work_stealing_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& t : threads_) {
+        t.join();
+    }
+}
+
+template <typename F>
+void work_stealing_pool::run(F&& f)
+{
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+
+    struct finish_run {
+        ~finish_run() { pool.running_.store(false, std::memory_order_release); }
+        work_stealing_pool& pool;
+    };
+
+    if (!threads_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            running_.store(true, std::memory_order_release);
+        }
+        wake_.notify_all();
+    }
+    const finish_run finish{*this};
+    f(*workers_[0]);
+}
+
+template <typename F>
+void work_stealing_pool::for_each(std::size_t first, std::size_t last, F&& f)
+{
+    run([&](worker& w) { w.for_each(first, last, f); });
+}
+
+inline void work_stealing_pool::thread_main(worker& w)
+{
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            wake_.wait(lock, [this] {
+                return stop_ || running_.load(std::memory_order_acquire);
+            });
+            if (stop_) {
+                return;
+            }
+        }
+        while (running_.load(std::memory_order_acquire)) {
+            if (!help(w)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+inline bool work_stealing_pool::help(worker& self)
+{
+    const auto n = workers_.size();
+    for (std::size_t i = 1; i < n; ++i) {
+        if (worker::task* t = workers_[(self.index() + i) % n]->steal()) {
+            self.execute(*t);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+#undef TRY
+#undef CATCH
+#undef THROW
+
+#endif
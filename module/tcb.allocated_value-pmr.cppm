@@ -0,0 +1,17 @@
+
+/*
+ * The :pmr partition of tcb.allocated_value, matching
+ * <tcb/pmr/allocated_value.hpp>.
+ */
+
+module;
+
+#include <tcb/pmr/allocated_value.hpp>
+
+export module tcb.allocated_value:pmr;
+
+export namespace tcb::pmr {
+
+using tcb::pmr::allocated_value;
+
+}
@@ -0,0 +1,46 @@
+
+/*
+ * Module interface for tcb.allocated_value.
+ *
+ * This wraps the header, so importing the module and including
+ * <tcb/allocated_value.hpp> give the same entities, and the two may be
+ * mixed in one program. The pmr alias is provided by the :pmr partition,
+ * which is re-exported from here.
+ */
+
+module;
+
+#include <tcb/allocated_value.hpp>
+
+export module tcb.allocated_value;
+
+export import :pmr;
+
+export namespace tcb {
+
+using tcb::allocated_value;
+using tcb::is_allocated_value;
+using tcb::is_allocated_value_v;
+using tcb::is_reflexively_comparable;
+using tcb::in_place_t;
+using tcb::in_place;
+using tcb::make_allocated_value;
+using tcb::allocate_allocated_value;
+using tcb::swap;
+
+using tcb::operator==;
+using tcb::operator!=;
+#ifdef TCB_ALLOCATED_VALUE_HAS_THREE_WAY_COMPARISON
+using tcb::operator<=>;
+#else
+using tcb::operator<;
+using tcb::operator<=;
+using tcb::operator>;
+using tcb::operator>=;
+#endif
+
+using tcb::allocated_value_less;
+using tcb::allocated_value_equal_to;
+using tcb::allocated_value_hash;
+
+}
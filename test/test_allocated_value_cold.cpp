@@ -0,0 +1,170 @@
+
+#include <tcb/cold.hpp>
+
+#include "catch.hpp"
+
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+using tcb::cold;
+using tcb::cold_arena;
+
+namespace {
+
+struct rarely_used {
+    std::string description;
+    int history[16];
+};
+
+struct hot {
+    int key;
+    float score;
+    cold<rarely_used> details;
+};
+
+struct unsplit {
+    int key;
+    float score;
+    rarely_used details;
+};
+
+}
+
+static_assert(sizeof(cold<rarely_used>) == sizeof(void*), "");
+static_assert(cold<rarely_used>::hot_size() == sizeof(void*), "");
+static_assert(cold<rarely_used>::cold_size() == sizeof(rarely_used), "");
+static_assert(sizeof(hot) < sizeof(unsplit), "");
+
+TEST_CASE("cold<T> does not allocate until first written", "[cold]")
+{
+    const auto before = cold_arena::this_thread().stats().live_bytes;
+
+    hot h{1, 2.0f, {}};
+    REQUIRE_FALSE(h.details.has_value());
+
+    // Const access reads a shared default value
+    const auto& ch = h;
+    REQUIRE(ch.details->description.empty());
+    REQUIRE_FALSE(h.details.has_value());
+    REQUIRE(cold_arena::this_thread().stats().live_bytes == before);
+
+    h.details->description = "written";
+    REQUIRE(h.details.has_value());
+    REQUIRE(ch.details->description == "written");
+    REQUIRE(cold_arena::this_thread().stats().live_bytes > before);
+
+    h.details.reset();
+    REQUIRE_FALSE(h.details.has_value());
+    REQUIRE(cold_arena::this_thread().stats().live_bytes == before);
+}
+
+TEST_CASE("cold<T> has value semantics", "[cold]")
+{
+    cold<std::string> a;
+    cold<std::string> b = a;
+    REQUIRE_FALSE(b.has_value());
+
+    *a = "hello";
+    cold<std::string> c = a;
+    REQUIRE(*c == "hello");
+    REQUIRE(&*c != &*a);
+
+    cold<std::string> d = std::move(c);
+    REQUIRE(*d == "hello");
+    REQUIRE_FALSE(c.has_value());
+
+    b = d;
+    REQUIRE(*b == "hello");
+    b = cold<std::string>{};
+    REQUIRE_FALSE(b.has_value());
+
+    b = std::string("world");
+    REQUIRE(*b == "world");
+    REQUIRE(b.emplace(3, 'x') == "xxx");
+}
+
+TEST_CASE("Cold blocks are packed together", "[cold]")
+{
+    std::vector<cold<int>> values(100);
+    for (auto& v : values) {
+        *v = 1;
+    }
+
+    // Consecutive allocations are adjacent, rather than each carrying a
+    // general-purpose allocator's per-block overhead
+    int adjacent = 0;
+    for (std::size_t i = 1; i < values.size(); ++i) {
+        const auto gap = reinterpret_cast<const char*>(&*values[i]) -
+                         reinterpret_cast<const char*>(&*values[i - 1]);
+        adjacent += gap == 16;
+    }
+    REQUIRE(adjacent > 90);
+}
+
+TEST_CASE("Cold blocks are reused after being freed", "[cold]")
+{
+    cold<int> a;
+    *a = 1;
+    const int* first = &*a;
+    a.reset();
+
+    cold<int> b;
+    *b = 2;
+    REQUIRE(&*b == first);
+}
+
+TEST_CASE("Cold data may be freed by another thread", "[cold]")
+{
+    std::vector<cold<std::string>> values(1000);
+
+    std::thread([&] {
+        for (auto& v : values) {
+            *v = "allocated on another thread";
+        }
+    }).join();
+
+    // The allocating thread has exited; freeing here must release its chunks
+    for (auto& v : values) {
+        REQUIRE(*v == "allocated on another thread");
+        v.reset();
+    }
+}
+
+TEST_CASE("Blocks freed by another thread return to the allocating arena", "[cold]")
+{
+    auto& arena = cold_arena::this_thread();
+    std::vector<cold<int>> values(100);
+    std::set<const int*> addresses;
+    for (auto& v : values) {
+        *v = 1;
+        addresses.insert(&*v);
+    }
+    const auto live = arena.stats().live_bytes;
+
+    std::thread([&values] {
+        for (auto& v : values) {
+            v.reset();
+        }
+    }).join();
+    REQUIRE(arena.stats().live_bytes == live - 100 * cold_arena::granularity);
+
+    // The next allocation takes the blocks back, and reuses one
+    cold<int> c;
+    *c = 2;
+    REQUIRE(arena.stats().live_bytes == live - 99 * cold_arena::granularity);
+    REQUIRE(addresses.count(&*c) == 1);
+}
+
+TEST_CASE("Large cold values fall back to operator new", "[cold]")
+{
+    struct big {
+        char data[4096];
+    };
+
+    cold<big> b;
+    b->data[4095] = 'x';
+    REQUIRE(b.has_value());
+    REQUIRE(b->data[4095] == 'x');
+}
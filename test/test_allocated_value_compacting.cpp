@@ -0,0 +1,222 @@
+
+#include <tcb/compacting_arena.hpp>
+
+#include "catch.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+template <typename T>
+using compact_value = tcb::allocated_value<T, tcb::compacting_allocator<T>>;
+
+namespace {
+
+struct record {
+    std::string name;
+    int id;
+};
+
+// Its move constructor throws once moves_left reaches zero
+struct fragile {
+    explicit fragile(int v) : v(v) {}
+
+    fragile(fragile&& other) : v(other.v)
+    {
+        if (moves_left >= 0 && moves_left-- == 0) {
+            throw std::runtime_error("move failed");
+        }
+    }
+
+    int v;
+
+    static int moves_left;
+};
+
+int fragile::moves_left = -1;
+
+// Fills an arena, then frees all but every stride'th value
+template <typename T, typename F>
+std::vector<compact_value<T>> fragment(tcb::compacting_arena<T>& arena,
+                                       std::size_t n, std::size_t stride, F make)
+{
+    std::vector<compact_value<T>> all;
+    for (std::size_t i = 0; i < n; ++i) {
+        all.emplace_back(make(i), arena);
+    }
+    std::vector<compact_value<T>> kept;
+    for (std::size_t i = 0; i < n; i += stride) {
+        kept.push_back(std::move(all[i]));
+    }
+    return kept;
+}
+
+}
+
+TEST_CASE("compacting arena allocation", "[compacting]")
+{
+    tcb::compacting_arena<int> arena;
+    {
+        const compact_value<int> a(1, arena);
+        const compact_value<int> b(2, arena);
+        REQUIRE(*a == 1);
+        REQUIRE(*b == 2);
+        REQUIRE(arena.live() == 2);
+        REQUIRE(arena.slab_count() == 1);
+
+        const auto c = a;
+        REQUIRE(*c == 1);
+        REQUIRE(arena.live() == 3);
+    }
+    REQUIRE(arena.live() == 0);
+}
+
+TEST_CASE("compacting arena reuses freed slots", "[compacting]")
+{
+    tcb::compacting_arena<int> arena;
+    const auto n = tcb::compacting_arena<int>::slots_per_slab;
+    {
+        auto values = fragment(arena, n, 2, [](std::size_t i) { return int(i); });
+        REQUIRE(arena.slab_count() == 1);
+        for (std::size_t i = 0; i < n / 2; ++i) {
+            values.emplace_back(-1, arena);
+        }
+        REQUIRE(arena.slab_count() == 1);
+    }
+    REQUIRE(arena.live() == 0);
+}
+
+TEST_CASE("compact() releases sparse slabs and keeps handles valid", "[compacting]")
+{
+    tcb::compacting_arena<record> arena;
+    const auto n = 8 * tcb::compacting_arena<record>::slots_per_slab;
+
+    auto kept = fragment(arena, n, 8, [](std::size_t i) {
+        return record{"record " + std::to_string(i), int(i)};
+    });
+    REQUIRE(arena.slab_count() == 8);
+    REQUIRE(arena.live() == n / 8);
+
+    const auto* before = kept.back().operator->().get();
+    REQUIRE(arena.compact() == 7);
+    REQUIRE(arena.slab_count() == 1);
+    REQUIRE(arena.live() == n / 8);
+    REQUIRE(arena.occupancy() > 0.99);
+
+    // The handle now points at the value's new location
+    REQUIRE(kept.back().operator->().get() != before);
+    for (std::size_t i = 0; i < kept.size(); ++i) {
+        REQUIRE(kept[i]->id == int(i * 8));
+        REQUIRE(kept[i]->name == "record " + std::to_string(i * 8));
+    }
+
+    // Compacting a dense arena does nothing
+    REQUIRE(arena.compact() == 0);
+
+    kept.clear();
+    REQUIRE(arena.live() == 0);
+}
+
+TEST_CASE("compact_step() works incrementally", "[compacting]")
+{
+    tcb::compacting_arena<double> arena;
+    const auto per_slab = tcb::compacting_arena<double>::slots_per_slab;
+
+    auto kept = fragment(arena, 4 * per_slab, 4, [](std::size_t i) { return double(i); });
+    REQUIRE(arena.slab_count() == 4);
+
+    std::size_t steps = 0;
+    while (!arena.compact_step(16)) {
+        ++steps;
+    }
+    REQUIRE(steps > 1);
+    REQUIRE(arena.slab_count() == 1);
+    for (std::size_t i = 0; i < kept.size(); ++i) {
+        REQUIRE(*kept[i] == double(i * 4));
+    }
+}
+
+TEST_CASE("A throwing move leaves the arena consistent", "[compacting]")
+{
+    tcb::compacting_arena<fragile> arena;
+    const auto per_slab = tcb::compacting_arena<fragile>::slots_per_slab;
+
+    // One full slab, then a quarter of it freed, and one half-full slab
+    // whose unused slots are the compaction destination
+    std::vector<compact_value<fragile>> all;
+    for (std::size_t i = 0; i < per_slab + per_slab / 2; ++i) {
+        all.emplace_back(fragile(int(i)), arena);
+    }
+    REQUIRE(arena.slab_count() == 2);
+
+    std::vector<compact_value<fragile>> kept;
+    std::vector<int> expected;
+    for (std::size_t i = 0; i < all.size(); ++i) {
+        if (i >= per_slab || i % 4 == 0) {
+            kept.push_back(std::move(all[i]));
+            expected.push_back(int(i));
+        }
+    }
+    all.clear();
+
+    fragile::moves_left = 3;
+    REQUIRE_THROWS_AS(arena.compact(), const std::runtime_error&);
+    REQUIRE(arena.live() == kept.size());
+    for (std::size_t i = 0; i < kept.size(); ++i) {
+        REQUIRE(kept[i]->v == expected[i]);
+    }
+
+    fragile::moves_left = -1;
+    arena.compact();
+    REQUIRE(arena.slab_count() == 1);
+    for (std::size_t i = 0; i < kept.size(); ++i) {
+        REQUIRE(kept[i]->v == expected[i]);
+    }
+
+    // Every free slot in the remaining slab can still be allocated
+    const auto room = per_slab - arena.live();
+    for (std::size_t i = 0; i < room; ++i) {
+        kept.emplace_back(fragile(-1), arena);
+    }
+    REQUIRE(arena.slab_count() == 1);
+}
+
+TEST_CASE("compacted values support assignment, swap and emplace", "[compacting]")
+{
+    tcb::compacting_arena<std::string> arena;
+    const auto per_slab = tcb::compacting_arena<std::string>::slots_per_slab;
+
+    auto kept = fragment(arena, 3 * per_slab, 3, [](std::size_t i) { return std::to_string(i); });
+    arena.compact();
+
+    kept[0] = kept[1];
+    REQUIRE(*kept[0] == "3");
+    swap(kept[1], kept[2]);
+    REQUIRE(*kept[1] == "6");
+    REQUIRE(*kept[2] == "3");
+    kept[2].emplace("replaced");
+    REQUIRE(*kept[2] == "replaced");
+
+    compact_value<std::string> moved(std::move(kept[3]));
+    REQUIRE(*moved == "9");
+    REQUIRE(kept[3].operator->() == nullptr);
+}
+
+TEST_CASE("relocatable_ptr pointer traits", "[compacting]")
+{
+    using ptr = tcb::relocatable_ptr<int>;
+    tcb::compacting_arena<int> arena;
+
+    ptr p = arena.allocate();
+    *p = 7;
+    REQUIRE(std::pointer_traits<ptr>::pointer_to(*p) == p);
+
+    const tcb::relocatable_ptr<const int> cp = p;
+    REQUIRE(*cp == 7);
+    const tcb::relocatable_ptr<void> vp = p;
+    REQUIRE(static_cast<ptr>(vp) == p);
+
+    REQUIRE(ptr{} == nullptr);
+    REQUIRE(p != nullptr);
+    arena.deallocate(p);
+}
@@ -0,0 +1,110 @@
+
+#include <tcb/allocated_value.hpp>
+
+#include "catch.hpp"
+
+#include <array>
+
+#ifdef TCB_ALLOCATED_VALUE_HAS_CONSTEXPR
+
+using tcb::allocated_value;
+using tcb::make_allocated_value;
+
+namespace {
+
+struct point {
+    int x;
+    int y;
+
+    constexpr point() : x(0), y(0) {}
+    constexpr point(int x, int y) : x(x), y(y) {}
+
+    friend constexpr bool operator==(const point&, const point&) = default;
+    friend constexpr auto operator<=>(const point&, const point&) = default;
+};
+
+constexpr bool default_construct()
+{
+    allocated_value<int> a;
+    return *a == 0;
+}
+
+constexpr bool construct_in_place()
+{
+    auto a = make_allocated_value<point>(1, 2);
+    allocated_value<point> b(tcb::in_place, 3, 4);
+    return a->x == 1 && a->y == 2 && b.get() == point{3, 4};
+}
+
+constexpr bool copy_and_move()
+{
+    allocated_value<int> a(42);
+    allocated_value<int> b = a;
+    allocated_value<int> c = std::move(a);
+    return b == 42 && c == 42;
+}
+
+constexpr bool assign_and_swap()
+{
+    allocated_value<int> a(1);
+    allocated_value<int> b(2);
+    a = b;
+    b = 3;
+    a.swap(b);
+    swap(a, b);
+    allocated_value<int> c(4);
+    c = std::move(a);
+    return c == 2 && b == 3;
+}
+
+constexpr bool emplace()
+{
+    allocated_value<point> a;
+    a.emplace(5, 6);
+    return a.get() == point{5, 6};
+}
+
+constexpr bool compare()
+{
+    allocated_value<int> a(1);
+    allocated_value<int> b(2);
+    return a < b && a != b && a == a && a <= 1 && 2 > a &&
+           tcb::allocated_value_less{}(a, 2) && tcb::allocated_value_equal_to{}(b, 2);
+}
+
+// A table computed during constant evaluation. The allocated_values used to
+// build it are freed again before evaluation finishes, leaving plain data.
+constexpr std::array<int, 8> squares()
+{
+    std::array<int, 8> table{};
+    for (int i = 0; i < 8; ++i) {
+        auto v = make_allocated_value<int>(i * i);
+        table[i] = *v;
+    }
+    return table;
+}
+
+constexpr auto squares_table = squares();
+
+}
+
+static_assert(default_construct());
+static_assert(construct_in_place());
+static_assert(copy_and_move());
+static_assert(assign_and_swap());
+static_assert(emplace());
+static_assert(compare());
+static_assert(squares_table[7] == 49);
+
+TEST_CASE("constexpr functions can also be evaluated at run time", "[constexpr]")
+{
+    REQUIRE(default_construct());
+    REQUIRE(construct_in_place());
+    REQUIRE(copy_and_move());
+    REQUIRE(assign_and_swap());
+    REQUIRE(emplace());
+    REQUIRE(compare());
+    REQUIRE(squares() == squares_table);
+}
+
+#endif // TCB_ALLOCATED_VALUE_HAS_CONSTEXPR
@@ -0,0 +1,176 @@
+
+#include <tcb/destroy_parallel.hpp>
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using tcb::allocated_value;
+
+namespace {
+
+std::atomic<int> live_counted{0};
+
+struct counted {
+    explicit counted(int id) : id(id) { ++live_counted; }
+    counted(const counted& other) : id(other.id) { ++live_counted; }
+    ~counted() { --live_counted; }
+
+    int id;
+};
+
+// Shared by the copies of an exclusive_allocator
+struct exclusive_state {
+    std::atomic<int> active{0};
+    std::atomic<bool> overlapped{false};
+    std::atomic<int> deallocations{0};
+};
+
+// An allocator which notices being used on two threads at once
+template <typename T>
+struct exclusive_allocator {
+    using value_type = T;
+
+    explicit exclusive_allocator(exclusive_state& state) : state(&state) {}
+
+    template <typename U>
+    exclusive_allocator(const exclusive_allocator<U>& other) : state(other.state) {}
+
+    T* allocate(std::size_t n) { return std::allocator<T>().allocate(n); }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        if (state->active.fetch_add(1) != 0) {
+            state->overlapped = true;
+        }
+        std::this_thread::yield();
+        std::allocator<T>().deallocate(p, n);
+        ++state->deallocations;
+        --state->active;
+    }
+
+    friend bool operator==(const exclusive_allocator& lhs, const exclusive_allocator& rhs)
+    {
+        return lhs.state == rhs.state;
+    }
+
+    friend bool operator!=(const exclusive_allocator& lhs, const exclusive_allocator& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    exclusive_state* state;
+};
+
+// An exclusive_allocator which destroy_parallel() groups by hashing
+template <typename T>
+struct keyed_allocator : exclusive_allocator<T> {
+    explicit keyed_allocator(exclusive_state& state) : exclusive_allocator<T>(state) {}
+
+    template <typename U>
+    keyed_allocator(const keyed_allocator<U>& other) : exclusive_allocator<T>(other) {}
+
+    exclusive_state* resource() const { return this->state; }
+};
+
+template <typename Alloc>
+void check_interleaved_allocators()
+{
+    using value_t = allocated_value<counted, Alloc>;
+
+    // More allocators than are remembered as recent, in turn
+    std::vector<exclusive_state> states(50);
+    std::vector<value_t> values;
+    for (int i = 0; i < 5000; ++i) {
+        values.emplace_back(std::allocator_arg, Alloc(states[i % 50]), tcb::in_place, i);
+    }
+
+    tcb::work_stealing_pool pool(4);
+    tcb::destroy_parallel(values, pool);
+    REQUIRE(live_counted == 0);
+    for (const auto& state : states) {
+        REQUIRE(state.deallocations == 100);
+        REQUIRE_FALSE(state.overlapped);
+    }
+}
+
+}
+
+TEST_CASE("destroy_parallel destroys every value", "[destroy-parallel]")
+{
+    tcb::work_stealing_pool pool(4);
+    std::vector<allocated_value<counted>> values;
+    for (int i = 0; i < 10000; ++i) {
+        values.emplace_back(tcb::in_place, i);
+    }
+    // Moved-from elements are skipped
+    const auto kept = std::move(values[10]);
+    REQUIRE(live_counted == 10000);
+
+    tcb::destroy_parallel(values, pool);
+    REQUIRE(live_counted == 1);
+    REQUIRE(values.size() == 10000);
+    REQUIRE(values.front().operator->() == nullptr);
+    REQUIRE(values.back().operator->() == nullptr);
+
+    values.clear();
+    REQUIRE(kept->id == 10);
+}
+
+TEST_CASE("Values sharing an allocator are freed on one thread", "[destroy-parallel]")
+{
+    using value_t = allocated_value<counted, exclusive_allocator<counted>>;
+
+    std::vector<exclusive_state> states(3);
+    std::vector<value_t> values;
+    for (int i = 0; i < 3000; ++i) {
+        // Runs of each allocator, interleaved
+        auto& state = states[(i / 100) % 3];
+        values.emplace_back(std::allocator_arg, exclusive_allocator<counted>(state),
+                            tcb::in_place, i);
+    }
+
+    tcb::work_stealing_pool pool(4);
+    tcb::destroy_parallel(values, pool);
+    REQUIRE(live_counted == 0);
+    for (const auto& state : states) {
+        REQUIRE(state.deallocations == 1000);
+        REQUIRE_FALSE(state.overlapped);
+    }
+}
+
+TEST_CASE("Values from many interleaved allocators are grouped", "[destroy-parallel]")
+{
+    check_interleaved_allocators<exclusive_allocator<counted>>();
+}
+
+TEST_CASE("Allocators with a resource are grouped by its address", "[destroy-parallel]")
+{
+    static_assert(std::is_same<decltype(tcb::allocator_key<keyed_allocator<counted>>::key(
+                                   std::declval<const keyed_allocator<counted>&>())),
+                               const void*>::value,
+                  "");
+    check_interleaved_allocators<keyed_allocator<counted>>();
+}
+
+TEST_CASE("parallel_teardown destroys large containers in parallel", "[destroy-parallel]")
+{
+    tcb::work_stealing_pool pool(2);
+    {
+        tcb::parallel_teardown<std::vector<allocated_value<counted>>> values(pool, {}, 100);
+        for (int i = 0; i < 1000; ++i) {
+            values->emplace_back(tcb::in_place, i);
+        }
+        REQUIRE(values.get().size() == 1000);
+        REQUIRE((*values)[999]->id == 999);
+
+        // Small containers are destroyed as usual
+        tcb::parallel_teardown<std::vector<allocated_value<counted>>> small(pool);
+        small->emplace_back(tcb::in_place, 1);
+        REQUIRE(live_counted == 1001);
+    }
+    REQUIRE(live_counted == 0);
+}
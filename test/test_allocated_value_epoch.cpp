@@ -0,0 +1,158 @@
+
+#include <tcb/epoch.hpp>
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> live_tables{0};
+
+// Every entry holds the table's version, so a reader which sees a mix of
+// versions has read a table while it was being destroyed
+struct routing_table {
+    explicit routing_table(int version)
+        : routes(64, version)
+    {
+        ++live_tables;
+    }
+
+    routing_table(const routing_table& other)
+        : routes(other.routes)
+    {
+        ++live_tables;
+    }
+
+    ~routing_table()
+    {
+        for (auto& r : routes) {
+            r = -1;
+        }
+        --live_tables;
+    }
+
+    std::vector<int> routes;
+};
+
+}
+
+TEST_CASE("Retired values outlive the guards which could see them", "[epoch]")
+{
+    tcb::epoch domain;
+    {
+        tcb::allocated_value<routing_table> old(tcb::in_place, 1);
+        REQUIRE(live_tables == 1);
+
+        tcb::epoch::guard g(domain);
+        domain.retire(std::move(old));
+        for (int i = 0; i < 4; ++i) {
+            domain.collect();
+        }
+        REQUIRE(domain.pending() == 1);
+        REQUIRE(live_tables == 1);
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        domain.collect();
+    }
+    REQUIRE(domain.pending() == 0);
+    REQUIRE(live_tables == 0);
+}
+
+TEST_CASE("Guards may be nested", "[epoch]")
+{
+    tcb::epoch domain;
+    tcb::epoch::guard outer(domain);
+    {
+        tcb::epoch::guard inner(domain);
+        domain.retire(tcb::allocated_value<routing_table>(tcb::in_place, 1));
+    }
+    for (int i = 0; i < 4; ++i) {
+        domain.collect();
+    }
+    // The outer guard still protects the value
+    REQUIRE(domain.pending() == 1);
+}
+
+TEST_CASE("The domain destroys values still pending", "[epoch]")
+{
+    {
+        tcb::epoch domain;
+        tcb::epoch::guard g(domain);
+        domain.retire(tcb::allocated_value<routing_table>(tcb::in_place, 1));
+        REQUIRE(live_tables == 1);
+    }
+    REQUIRE(live_tables == 0);
+}
+
+TEST_CASE("epoch_cell publishes new values", "[epoch]")
+{
+    tcb::epoch domain;
+    {
+        tcb::epoch_cell<routing_table> cell(
+                domain, tcb::allocated_value<routing_table>(tcb::in_place, 1));
+        {
+            tcb::epoch::guard g(domain);
+            const auto& before = cell.load(g);
+            cell.store(tcb::allocated_value<routing_table>(tcb::in_place, 2));
+
+            REQUIRE(before.routes[0] == 1);
+            REQUIRE(cell.load(g).routes[0] == 2);
+        }
+        domain.collect();
+        domain.collect();
+        REQUIRE(live_tables == 1);
+    }
+    REQUIRE(live_tables == 0);
+}
+
+TEST_CASE("Readers never see a destroyed value", "[epoch]")
+{
+    const int readers = 4;
+    const int versions = 2000;
+
+    tcb::epoch domain;
+    tcb::epoch_cell<routing_table> cell(
+            domain, tcb::allocated_value<routing_table>(tcb::in_place, 0));
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&] {
+            int last = 0;
+            while (!done.load(std::memory_order_acquire)) {
+                tcb::epoch::guard g(domain);
+                const auto& table = cell.load(g);
+                const int version = table.routes.front();
+                for (int r : table.routes) {
+                    if (r != version) {
+                        ++torn;
+                    }
+                }
+                // Versions are published in order
+                if (version < last) {
+                    ++torn;
+                }
+                last = version;
+            }
+        });
+    }
+
+    for (int v = 1; v <= versions; ++v) {
+        cell.store(tcb::allocated_value<routing_table>(tcb::in_place, v));
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(torn == 0);
+    domain.collect();
+    domain.collect();
+    REQUIRE(domain.pending() == 0);
+    REQUIRE(live_tables == 1);
+}
@@ -0,0 +1,55 @@
+#include "test_fast_pimpl.hpp"
+
+#include "catch.hpp"
+
+/*
+ * Fast pimpl Tests
+ *
+ * As for the pimpl tests, but with the implementation stored inline using
+ * tcb::fast_pimpl. Uses the test_fast_pimpl class, whose implementation is
+ * separately compiled.
+ */
+static_assert(sizeof(test_fast_pimpl) == 48, "");
+
+TEST_CASE("fast pimpl construction", "[fast_pimpl]")
+{
+    REQUIRE_NOTHROW(test_fast_pimpl{});
+    const auto a = test_fast_pimpl{};
+    REQUIRE(a.get_value() == 0);
+    REQUIRE(a.get_name().empty());
+}
+
+TEST_CASE("fast pimpl copy construction", "[fast_pimpl]")
+{
+    const auto a = test_fast_pimpl{1, "one"};
+    const auto b = a;
+    REQUIRE(b.get_value() == 1);
+    REQUIRE(b.get_name() == "one");
+    REQUIRE(a.get_name() == "one");
+}
+
+TEST_CASE("fast pimpl move construction", "[fast_pimpl]")
+{
+    auto a = test_fast_pimpl{1, "a string too long for the small string buffer"};
+    const auto b = std::move(a);
+    REQUIRE(b.get_value() == 1);
+    REQUIRE(b.get_name() == "a string too long for the small string buffer");
+}
+
+TEST_CASE("fast pimpl copy assignment", "[fast_pimpl]")
+{
+    const auto a = test_fast_pimpl{1, "one"};
+    auto b = test_fast_pimpl{2, "two"};
+    REQUIRE_NOTHROW(b = a);
+    REQUIRE(b.get_value() == 1);
+    REQUIRE(b.get_name() == "one");
+}
+
+TEST_CASE("fast pimpl move assignment", "[fast_pimpl]")
+{
+    auto a = test_fast_pimpl{1, "one"};
+    auto b = test_fast_pimpl{2, "two"};
+    REQUIRE_NOTHROW(b = std::move(a));
+    REQUIRE(b.get_value() == 1);
+    REQUIRE(b.get_name() == "one");
+}
@@ -0,0 +1,157 @@
+
+#include <tcb/flat.hpp>
+
+#include "catch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using tcb::allocated_value;
+
+namespace {
+
+struct point {
+    int x;
+    int y;
+};
+
+struct message {
+    int id;
+    allocated_value<point> origin;
+    allocated_value<allocated_value<int>> nested;
+};
+
+struct flat_message {
+    int id;
+    tcb::flat_ref<point> origin;
+    tcb::flat_ref<tcb::flat_ref<int>> nested;
+};
+
+}
+
+// A user-defined type opts in by describing its flat form
+namespace tcb {
+
+template <>
+struct flat_traits<message> {
+    using flat_type = flat_message;
+
+    static void write(flat_writer& w, std::size_t at, const message& m)
+    {
+        w.write_member(at, &flat_message::id, m.id);
+        w.write_member(at, &flat_message::origin, m.origin);
+        w.write_member(at, &flat_message::nested, m.nested);
+    }
+
+    static bool check(flat_checker& c, const flat_message& f)
+    {
+        return c.check<decltype(message::origin)>(f.origin) &&
+               c.check<decltype(message::nested)>(f.nested);
+    }
+};
+
+}
+
+TEST_CASE("Flattening a trivially copyable value", "[flat]")
+{
+    const auto buf = tcb::flatten(point{1, 2});
+    REQUIRE(buf.size() == sizeof(point));
+    REQUIRE(buf.view()->x == 1);
+    REQUIRE(buf.view()->y == 2);
+}
+
+TEST_CASE("Flattening nested allocated_values", "[flat]")
+{
+    const allocated_value<allocated_value<int>> a{allocated_value<int>{3}};
+    const auto buf = tcb::flatten(a);
+    REQUIRE(***buf.view() == 3);
+}
+
+TEST_CASE("Flattening a user-defined type", "[flat]")
+{
+    const message m{7, allocated_value<point>{point{1, 2}},
+                    allocated_value<allocated_value<int>>{allocated_value<int>{3}}};
+
+    const auto buf = tcb::flatten(m);
+    const auto v = buf.view();
+    REQUIRE(v->id == 7);
+    REQUIRE(v->origin->x == 1);
+    REQUIRE(v->origin->y == 2);
+    REQUIRE(**v->nested == 3);
+}
+
+TEST_CASE("Flat buffers are relocatable", "[flat]")
+{
+    const message m{7, allocated_value<point>{point{1, 2}},
+                    allocated_value<allocated_value<int>>{allocated_value<int>{3}}};
+    const auto buf = tcb::flatten(m);
+
+    // Simulate receiving the bytes in some other buffer
+    std::vector<std::max_align_t> copy(buf.size() / sizeof(std::max_align_t) + 1);
+    std::memcpy(copy.data(), buf.data(), buf.size());
+
+    const tcb::flat_view<message> v{copy.data(), buf.size()};
+    REQUIRE(v->id == 7);
+    REQUIRE(v->origin->y == 2);
+    REQUIRE(**v->nested == 3);
+}
+
+TEST_CASE("flat_refs cannot be copied out of their buffer", "[flat]")
+{
+    static_assert(!std::is_copy_constructible<tcb::flat_ref<int>>::value, "");
+    static_assert(!std::is_copy_assignable<tcb::flat_ref<int>>::value, "");
+    static_assert(!std::is_copy_constructible<flat_message>::value, "");
+}
+
+TEST_CASE("Moved-from values are flattened as null references", "[flat]")
+{
+    message m{7, allocated_value<point>{point{1, 2}},
+              allocated_value<allocated_value<int>>{allocated_value<int>{3}}};
+    const auto moved = std::move(m.origin);
+
+    const auto buf = tcb::flatten(m);
+    const auto v = buf.view();
+    REQUIRE_FALSE(v->origin);
+    REQUIRE(v->nested);
+    REQUIRE(**v->nested == 3);
+    REQUIRE(tcb::flat_view<message>::is_valid(buf.data(), buf.size()));
+}
+
+TEST_CASE("flat_view rejects buffers which do not hold a valid value", "[flat]")
+{
+    const message m{7, allocated_value<point>{point{1, 2}},
+                    allocated_value<allocated_value<int>>{allocated_value<int>{3}}};
+    const auto buf = tcb::flatten(m);
+    std::vector<std::max_align_t> copy(buf.size() / sizeof(std::max_align_t) + 1);
+    std::memcpy(copy.data(), buf.data(), buf.size());
+    auto bytes = reinterpret_cast<char*>(copy.data());
+    using view = tcb::flat_view<message>;
+
+    REQUIRE(view::is_valid(bytes, buf.size()));
+
+    SECTION("truncated") {
+        REQUIRE_FALSE(view::is_valid(bytes, sizeof(flat_message) - 1));
+        REQUIRE_FALSE(view::is_valid(bytes, buf.size() - 1));
+        REQUIRE_THROWS_AS(view(bytes, buf.size() - 1), const tcb::flat_error&);
+    }
+
+    SECTION("misaligned") {
+        REQUIRE_FALSE(view::is_valid(bytes + 1, buf.size() - 1));
+    }
+
+    SECTION("offset out of range") {
+        const std::int64_t offset = 1 << 20;
+        std::memcpy(bytes + offsetof(flat_message, origin), &offset, sizeof(offset));
+        REQUIRE_FALSE(view::is_valid(bytes, buf.size()));
+    }
+
+    SECTION("backwards offset") {
+        const std::int64_t offset = -std::int64_t(offsetof(flat_message, origin));
+        std::memcpy(bytes + offsetof(flat_message, origin), &offset, sizeof(offset));
+        REQUIRE_FALSE(view::is_valid(bytes, buf.size()));
+    }
+}
@@ -0,0 +1,202 @@
+
+#include <tcb/allocated_value.hpp>
+#include <tcb/cached_hash.hpp>
+
+#include "catch.hpp"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+
+using tcb::allocated_value;
+
+namespace {
+
+int compare_count = 0;
+
+struct counted {
+    int i;
+};
+
+bool operator==(const counted& lhs, const counted& rhs)
+{
+    ++compare_count;
+    return lhs.i == rhs.i;
+}
+
+bool operator<(const counted& lhs, const counted& rhs)
+{
+    ++compare_count;
+    return lhs.i < rhs.i;
+}
+
+bool operator<=(const counted& lhs, const counted& rhs) { return !(rhs < lhs); }
+
+// As counted, but without opting in to the self-comparison shortcut
+struct counted_unopted {
+    int i;
+};
+
+bool operator==(const counted_unopted& lhs, const counted_unopted& rhs)
+{
+    ++compare_count;
+    return lhs.i == rhs.i;
+}
+
+struct unhashable {};
+
+struct counting_hash {
+    static int calls;
+
+    std::size_t operator()(const std::string& s) const
+    {
+        ++calls;
+        return std::hash<std::string>{}(s);
+    }
+};
+
+int counting_hash::calls = 0;
+
+}
+
+namespace tcb {
+
+template <>
+struct is_reflexively_comparable<counted> : std::true_type {};
+
+}
+
+TEST_CASE("std::hash forwards to the contained value", "[hash]")
+{
+    const allocated_value<std::string> a{"hello"};
+    REQUIRE(std::hash<allocated_value<std::string>>{}(a) == std::hash<std::string>{}("hello"));
+
+    std::unordered_set<allocated_value<std::string>> set;
+    set.insert(allocated_value<std::string>{"a"});
+    set.insert(allocated_value<std::string>{"a"});
+    set.insert(allocated_value<std::string>{"b"});
+    REQUIRE(set.size() == 2);
+}
+
+TEST_CASE("std::hash is disabled when the contained type's is", "[hash]")
+{
+    static_assert(std::is_default_constructible<std::hash<allocated_value<int>>>::value, "");
+    static_assert(!std::is_default_constructible<std::hash<allocated_value<unhashable>>>::value,
+                  "");
+    static_assert(!std::is_copy_constructible<std::hash<allocated_value<unhashable>>>::value, "");
+}
+
+TEST_CASE("Opted-in types skip comparing a handle with itself", "[hash]")
+{
+    const allocated_value<counted> a{counted{1}};
+    const allocated_value<counted> b{counted{1}};
+
+    compare_count = 0;
+    REQUIRE(a == a);
+    REQUIRE_FALSE(a < a);
+    REQUIRE(a <= a);
+    REQUIRE(compare_count == 0);
+
+    REQUIRE(a == b);
+    REQUIRE(compare_count == 1);
+}
+
+TEST_CASE("Other types compare a handle with itself as usual", "[hash]")
+{
+    const allocated_value<counted_unopted> a{counted_unopted{1}};
+
+    compare_count = 0;
+    REQUIRE(a == a);
+    REQUIRE(compare_count == 1);
+}
+
+TEST_CASE("Integers, enumerations and strings skip self-comparison by default", "[hash]")
+{
+    enum class colour { red };
+    static_assert(tcb::is_reflexively_comparable<int>::value, "");
+    static_assert(tcb::is_reflexively_comparable<colour>::value, "");
+    static_assert(tcb::is_reflexively_comparable<std::string>::value, "");
+    static_assert(tcb::is_reflexively_comparable<std::wstring>::value, "");
+    static_assert(!tcb::is_reflexively_comparable<double>::value, "");
+    static_assert(!tcb::is_reflexively_comparable<counted_unopted>::value, "");
+
+    const allocated_value<std::string> a{"hello"};
+    REQUIRE(a == a);
+    REQUIRE_FALSE(a != a);
+}
+
+TEST_CASE("Floating point self-comparison still sees NaN", "[hash]")
+{
+    const allocated_value<double> nan{std::numeric_limits<double>::quiet_NaN()};
+    REQUIRE_FALSE(nan == nan);
+    REQUIRE(nan != nan);
+}
+
+TEST_CASE("cached_hash computes the hash once", "[hash][cached-hash]")
+{
+    using value_t = allocated_value<tcb::cached_hash<std::string, counting_hash>>;
+
+    counting_hash::calls = 0;
+    const value_t a{tcb::in_place, "hello"};
+    REQUIRE_FALSE(a->has_cached_hash());
+
+    const auto h = std::hash<value_t>{}(a);
+    REQUIRE(h == std::hash<std::string>{}("hello"));
+    REQUIRE(std::hash<value_t>{}(a) == h);
+    REQUIRE(counting_hash::calls == 1);
+
+    // Copies carry the cached hash with them
+    const auto b = a;
+    REQUIRE(b->has_cached_hash());
+    REQUIRE(std::hash<value_t>{}(b) == h);
+    REQUIRE(counting_hash::calls == 1);
+}
+
+TEST_CASE("cached_hash is invalidated by mutable access", "[hash][cached-hash]")
+{
+    allocated_value<tcb::cached_hash<std::string>> a{tcb::in_place, "hello"};
+    const auto h1 = a->hash();
+
+    a->mutable_value() += " world";
+    REQUIRE_FALSE(a->has_cached_hash());
+    REQUIRE(a->hash() == std::hash<std::string>{}("hello world"));
+    REQUIRE(a->hash() != h1);
+}
+
+TEST_CASE("cached_hash compares hashes before values", "[hash][cached-hash]")
+{
+    const tcb::cached_hash<std::string> a{"a"};
+    const tcb::cached_hash<std::string> b{"b"};
+    const tcb::cached_hash<std::string> a2{"a"};
+
+    REQUIRE(a == a2);
+    a.hash();
+    b.hash();
+    REQUIRE(a != b);
+    REQUIRE(a < b);
+}
+
+TEST_CASE("Moving a cached_hash leaves no stale hash behind", "[hash][cached-hash]")
+{
+    const tcb::cached_hash<std::string> empty{""};
+    empty.hash();
+
+    tcb::cached_hash<std::string> a{"a value too long for the small string buffer"};
+    const auto h = a.hash();
+
+    tcb::cached_hash<std::string> b{std::move(a)};
+    REQUIRE(b.has_cached_hash());
+    REQUIRE(b.hash() == h);
+    REQUIRE_FALSE(a.has_cached_hash());
+    REQUIRE(a == empty);
+    REQUIRE(a.hash() == empty.hash());
+
+    b.hash();
+    a = std::move(b);
+    REQUIRE(a.has_cached_hash());
+    REQUIRE(a.hash() == h);
+    REQUIRE_FALSE(b.has_cached_hash());
+    REQUIRE(b == empty);
+}
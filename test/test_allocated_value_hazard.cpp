@@ -0,0 +1,138 @@
+
+#include <tcb/hazard_pointer.hpp>
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<int> live_configs{0};
+
+// Every entry holds the config's version, so a reader which sees a mix of
+// versions has read a config while it was being destroyed
+struct config {
+    explicit config(int version)
+        : values(32, version)
+    {
+        ++live_configs;
+    }
+
+    ~config()
+    {
+        for (auto& v : values) {
+            v = -1;
+        }
+        --live_configs;
+    }
+
+    std::vector<int> values;
+};
+
+}
+
+TEST_CASE("A hazard pointer keeps its value alive", "[hazard]")
+{
+    tcb::hazard_domain domain(1);
+    {
+        tcb::hazard_slot<config> slot(tcb::allocated_value<config>(tcb::in_place, 1), domain);
+
+        auto h = slot.protect();
+        slot.emplace(2);
+        domain.reclaim();
+        REQUIRE(domain.pending() == 1);
+        REQUIRE(h->values[0] == 1);
+        REQUIRE(slot.protect()->values[0] == 2);
+
+        h.reset();
+        domain.reclaim();
+        REQUIRE(domain.pending() == 0);
+        REQUIRE(live_configs == 1);
+    }
+    REQUIRE(live_configs == 0);
+}
+
+TEST_CASE("Retired values are reclaimed in batches", "[hazard]")
+{
+    tcb::hazard_domain domain(16);
+    tcb::hazard_slot<config> slot(tcb::allocated_value<config>(tcb::in_place, 0), domain);
+
+    for (int v = 1; v < 16; ++v) {
+        slot.emplace(v);
+    }
+    REQUIRE(domain.pending() == 15);
+
+    // The sixteenth retirement triggers a scan
+    slot.emplace(16);
+    REQUIRE(domain.pending() == 0);
+    REQUIRE(live_configs == 1);
+}
+
+TEST_CASE("A stalled reader holds back only its own value", "[hazard]")
+{
+    tcb::hazard_domain domain(8);
+    tcb::hazard_slot<config> slot(tcb::allocated_value<config>(tcb::in_place, 0), domain);
+
+    const auto stalled = slot.protect();
+    for (int v = 1; v <= 1000; ++v) {
+        slot.emplace(v);
+        REQUIRE(domain.pending() <= domain.scan_threshold());
+    }
+    REQUIRE(stalled->values[0] == 0);
+}
+
+TEST_CASE("hazard_slot stress", "[hazard]")
+{
+    const int readers = 4;
+    const int writers = 2;
+    const int versions = 2000;
+
+    tcb::hazard_domain domain(8);
+    tcb::hazard_slot<config> slot(tcb::allocated_value<config>(tcb::in_place, 0), domain);
+    std::atomic<bool> done{false};
+    std::atomic<int> torn{0};
+    std::atomic<std::size_t> max_pending{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < readers; ++t) {
+        threads.emplace_back([&] {
+            while (!done.load(std::memory_order_acquire)) {
+                const auto h = slot.protect();
+                const int version = h->values.front();
+                for (int v : h->values) {
+                    if (v != version) {
+                        ++torn;
+                    }
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> writer_threads;
+    for (int w = 0; w < writers; ++w) {
+        writer_threads.emplace_back([&] {
+            for (int v = 1; v <= versions; ++v) {
+                slot.emplace(v);
+                const auto p = domain.pending();
+                auto m = max_pending.load();
+                while (p > m && !max_pending.compare_exchange_weak(m, p)) {}
+            }
+        });
+    }
+    for (auto& t : writer_threads) {
+        t.join();
+    }
+    done.store(true, std::memory_order_release);
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(torn == 0);
+    // Bounded garbage: one batch plus one value per hazard record
+    REQUIRE(max_pending <= domain.scan_threshold() + readers + writers);
+    domain.reclaim();
+    REQUIRE(domain.pending() == 0);
+    REQUIRE(live_configs == 1);
+}
@@ -0,0 +1,84 @@
+
+#include <tcb/hugepage_arena.hpp>
+
+#include "catch.hpp"
+#include "test_types.hpp"
+
+#include <vector>
+
+template <typename T>
+using arena_value = tcb::allocated_value<T, tcb::arena_allocator<T>>;
+
+static_assert(!std::is_default_constructible<arena_value<int>>::value, "");
+
+TEST_CASE("hugepage arena construction", "[hugepage-arena]")
+{
+    tcb::hugepage_arena arena{8 << 20};
+    REQUIRE(arena.reserved() == 8 << 20);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(arena.data()) % tcb::hugepage_arena::huge_page_size == 0);
+
+    const auto a = arena_value<test_struct>(test_struct{"1", 2}, arena);
+    REQUIRE(a->str == "1");
+    REQUIRE(a->i == 2);
+    REQUIRE(arena.live() == tcb::hugepage_arena::granularity * 3);
+}
+
+TEST_CASE("hugepage arena copy and move", "[hugepage-arena]")
+{
+    tcb::hugepage_arena arena{8 << 20};
+
+    const auto a = arena_value<int>(3, arena);
+    const auto b = a;
+    REQUIRE(*b == 3);
+
+    auto c = arena_value<int>(4, arena);
+    const auto d = std::move(c);
+    REQUIRE(*d == 4);
+}
+
+TEST_CASE("hugepage arena reuses freed blocks", "[hugepage-arena]")
+{
+    tcb::hugepage_arena arena{8 << 20};
+
+    const auto a = arena_value<int>(1, arena);
+    const int* second = nullptr;
+    {
+        const auto b = arena_value<int>(2, arena);
+        const auto c = arena_value<int>(3, arena);
+        second = &*b;
+    }
+    const auto used = arena.used();
+    const auto d = arena_value<int>(4, arena);
+    REQUIRE(&*d == second);
+    REQUIRE(arena.used() == used + tcb::hugepage_arena::granularity);
+}
+
+TEST_CASE("hugepage arena trim", "[hugepage-arena]")
+{
+    tcb::hugepage_arena arena{8 << 20};
+
+    {
+        std::vector<arena_value<long>> values;
+        for (long i = 0; i < 10000; i++) {
+            values.emplace_back(i, arena);
+        }
+        REQUIRE(arena.used() > 0);
+    }
+    REQUIRE(arena.live() == 0);
+    REQUIRE(arena.used() == 0);
+    REQUIRE(arena.trim() > 0);
+    REQUIRE(arena.trim() == 0);
+}
+
+TEST_CASE("hugepage arena exhaustion", "[hugepage-arena]")
+{
+    tcb::hugepage_arena arena{1};
+    struct big { char c[4096]; };
+    std::vector<arena_value<big>> values;
+
+    REQUIRE_THROWS_AS([&] {
+        for (;;) {
+            values.emplace_back(big{}, arena);
+        }
+    }(), std::bad_alloc);
+}
@@ -0,0 +1,98 @@
+
+#include <tcb/interned_value.hpp>
+
+#include "catch.hpp"
+
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using pool_t = tcb::intern_pool<std::string>;
+
+TEST_CASE("Interning equal values shares storage", "[interned]")
+{
+    pool_t pool;
+
+    const auto a = pool.intern("hello");
+    const auto b = pool.intern(std::string("hel") + "lo");
+    const auto c = pool.intern("world");
+
+    REQUIRE(*a == "hello");
+    REQUIRE(&*a == &*b);
+    REQUIRE(a == b);
+    REQUIRE(a != c);
+    REQUIRE(pool.size() == 2);
+}
+
+TEST_CASE("Interned values are erased with their last handle", "[interned]")
+{
+    pool_t pool;
+    {
+        const auto a = pool.intern("hello");
+        {
+            const auto b = a;
+            auto c = pool.intern("hello");
+            const auto d = std::move(c);
+            REQUIRE(pool.size() == 1);
+        }
+        REQUIRE(pool.size() == 1);
+        REQUIRE(*a == "hello");
+    }
+    REQUIRE(pool.size() == 0);
+}
+
+TEST_CASE("Interned handles can be hashed", "[interned]")
+{
+    pool_t pool;
+    std::unordered_set<pool_t::handle> set;
+
+    set.insert(pool.intern("a"));
+    set.insert(pool.intern("b"));
+    set.insert(pool.intern("a"));
+
+    REQUIRE(set.size() == 2);
+    REQUIRE(set.count(pool.intern("b")) == 1);
+    REQUIRE(pool.intern("a").hash() == std::hash<std::string>{}("a"));
+}
+
+TEST_CASE("Handles from different pools compare by value", "[interned]")
+{
+    pool_t pool1;
+    pool_t pool2;
+
+    REQUIRE(pool1.intern("x") == pool2.intern("x"));
+    REQUIRE(pool1.intern("x") != pool2.intern("y"));
+}
+
+TEST_CASE("Interning from several threads", "[interned]")
+{
+    tcb::intern_pool<int> pool;
+    std::vector<std::thread> threads;
+    std::vector<std::vector<tcb::intern_pool<int>::handle>> results(4);
+
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&pool, &results, t] {
+            for (int round = 0; round < 100; round++) {
+                std::vector<tcb::intern_pool<int>::handle> local;
+                for (int i = 0; i < 100; i++) {
+                    local.push_back(pool.intern(i));
+                }
+                if (round == 99) {
+                    results[t] = std::move(local);
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    REQUIRE(pool.size() == 100);
+    for (int i = 0; i < 100; i++) {
+        REQUIRE(results[0][i] == results[3][i]);
+        REQUIRE(*results[1][i] == i);
+    }
+    results.clear();
+    REQUIRE(pool.size() == 0);
+}
@@ -0,0 +1,179 @@
+
+#include <tcb/mapped_segment.hpp>
+
+#include "catch.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+template <typename T>
+using mapped_value = tcb::allocated_value<T, tcb::mapped_allocator<T>>;
+
+struct record {
+    record(int id, int value, tcb::mapped_allocator<char> alloc)
+        : id(id),
+          value(value, alloc),
+          nested(mapped_value<int>(value * 2, alloc), alloc)
+    {}
+
+    int id;
+    mapped_value<int> value;
+    mapped_value<mapped_value<int>> nested;
+};
+
+// A scratch directory which is removed, with its contents, on destruction
+struct temp_dir {
+    temp_dir()
+    {
+        char tmpl[] = "/tmp/tcb_mapped_segment_XXXXXX";
+        path = ::mkdtemp(tmpl);
+    }
+
+    ~temp_dir()
+    {
+        std::system(("rm -rf " + path).c_str());
+    }
+
+    std::string file(const std::string& name) const { return path + "/" + name; }
+
+    std::string path;
+};
+
+void copy_file(const std::string& from, const std::string& to)
+{
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary);
+    out << in.rdbuf();
+}
+
+}
+
+TEST_CASE("mapped segment roots survive a fresh process", "[mapped-segment]")
+{
+    temp_dir dir;
+    const auto path = dir.file("state.seg");
+
+    const pid_t pid = ::fork();
+    REQUIRE(pid >= 0);
+    if (pid == 0) {
+        int status = 1;
+        try {
+            tcb::mapped_segment seg(path, 1 << 20, 7);
+            seg.construct_root<record>("record", 1, 42, seg.get_allocator());
+            status = 0;
+        } catch (...) {}
+        ::_exit(status);
+    }
+
+    int status = 0;
+    REQUIRE(::waitpid(pid, &status, 0) == pid);
+    REQUIRE(WIFEXITED(status));
+    REQUIRE(WEXITSTATUS(status) == 0);
+
+    // Map a copy alongside the original, so that at least one of them is
+    // at a different address from the one the child wrote
+    copy_file(path, dir.file("copy.seg"));
+    tcb::mapped_segment seg(path, 0, 7);
+    tcb::mapped_segment copy(dir.file("copy.seg"), 0, 7);
+
+    for (auto s : {&seg, &copy}) {
+        REQUIRE(s->check());
+        const auto r = s->find_root<record>("record");
+        REQUIRE(r != nullptr);
+        REQUIRE(r->id == 1);
+        REQUIRE(*r->value == 42);
+        REQUIRE(**r->nested == 84);
+    }
+}
+
+TEST_CASE("mapped segment values can be modified after reopening", "[mapped-segment]")
+{
+    temp_dir dir;
+    const auto path = dir.file("state.seg");
+
+    {
+        tcb::mapped_segment seg(path, 1 << 16);
+        seg.construct_root<record>("record", 1, 2, seg.get_allocator());
+    }
+    {
+        tcb::mapped_segment seg(path, 0);
+        auto r = seg.find_root<record>("record");
+        REQUIRE(r != nullptr);
+        *r->value = 3;
+        r->nested = mapped_value<mapped_value<int>>(
+                mapped_value<int>(4, seg.get_allocator()), seg.get_allocator());
+    }
+    {
+        tcb::mapped_segment seg(path, 0);
+        auto r = seg.find_root<record>("record");
+        REQUIRE(*r->value == 3);
+        REQUIRE(**r->nested == 4);
+
+        const auto used = seg.used();
+        seg.destroy_root<record>("record");
+        REQUIRE(seg.find_root<record>("record") == nullptr);
+        REQUIRE(seg.used() <= used);
+        REQUIRE(seg.check());
+    }
+}
+
+TEST_CASE("mapped segment rejects incompatible files", "[mapped-segment]")
+{
+    temp_dir dir;
+    const auto path = dir.file("state.seg");
+
+    {
+        tcb::mapped_segment seg(path, 1 << 16, 1);
+        seg.construct_root<int>("answer", 42);
+        REQUIRE_THROWS_AS(seg.construct_root<int>("answer", 43), tcb::mapped_segment_error);
+        REQUIRE_THROWS_AS(seg.find_root<long long>("answer"), tcb::mapped_segment_error);
+    }
+
+    SECTION("user version mismatch") {
+        REQUIRE_THROWS_AS(tcb::mapped_segment(path, 0, 2), tcb::mapped_segment_error);
+    }
+
+    SECTION("corrupt header") {
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(0);
+            f.put('X');
+        }
+        REQUIRE_THROWS_AS(tcb::mapped_segment(path, 0, 1), tcb::mapped_segment_error);
+    }
+
+    SECTION("corrupt root registry") {
+        // Still consistent, so only the checksum of the cleanly closed
+        // segment can catch it
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(offsetof(tcb::detail::segment_header, roots));
+            f.put('b');
+        }
+        REQUIRE_THROWS_AS(tcb::mapped_segment(path, 0, 1), tcb::mapped_segment_error);
+    }
+
+    SECTION("corrupt root object") {
+        // The root is the first allocation in the segment
+        {
+            std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+            f.seekp(static_cast<std::streamoff>(tcb::detail::segment_header::data_start()));
+            f.put('b');
+        }
+        REQUIRE_THROWS_AS(tcb::mapped_segment(path, 0, 1), tcb::mapped_segment_error);
+    }
+
+    SECTION("not a segment") {
+        const auto other = dir.file("other");
+        std::ofstream(other) << "hello";
+        REQUIRE_THROWS_AS(tcb::mapped_segment(other, 0), tcb::mapped_segment_error);
+    }
+}
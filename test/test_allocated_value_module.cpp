@@ -0,0 +1,42 @@
+
+#include "catch.hpp"
+
+#include <memory_resource>
+#include <set>
+#include <string>
+
+import tcb.allocated_value;
+
+using tcb::allocated_value;
+using tcb::make_allocated_value;
+
+TEST_CASE("allocated_value can be used through the module", "[module]")
+{
+    auto a = make_allocated_value<std::string>("hello");
+    allocated_value<std::string> b(std::string("world"));
+
+    REQUIRE(*a == "hello");
+    REQUIRE(a < b);
+    REQUIRE(a != b);
+
+    swap(a, b);
+    REQUIRE(*a == "world");
+    REQUIRE(tcb::is_allocated_value_v<decltype(a)>);
+}
+
+TEST_CASE("Transparent comparators are exported", "[module]")
+{
+    std::set<allocated_value<std::string>, tcb::allocated_value_less> set;
+    set.emplace(std::string("apple"));
+
+    REQUIRE(set.find(std::string("apple")) != set.end());
+}
+
+TEST_CASE("The pmr partition is exported", "[module]")
+{
+    std::pmr::monotonic_buffer_resource resource;
+    tcb::pmr::allocated_value<int> a(42, &resource);
+
+    REQUIRE(*a == 42);
+    REQUIRE(a.get_allocator().resource() == &resource);
+}
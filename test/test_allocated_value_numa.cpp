@@ -0,0 +1,166 @@
+
+#include <tcb/numa_allocator.hpp>
+
+#include "catch.hpp"
+#include "test_types.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template <typename T>
+using numa_value = tcb::allocated_value<T, tcb::numa_allocator<T>>;
+
+namespace {
+
+// A sysfs-like directory describing a made-up machine, removed on exit
+class fake_sysfs {
+public:
+    fake_sysfs()
+    {
+        char tmpl[] = "/tmp/tcb_numa_XXXXXX";
+        root_ = ::mkdtemp(tmpl);
+    }
+
+    ~fake_sysfs()
+    {
+        for (const auto& f : files_) {
+            std::remove(f.c_str());
+        }
+        for (auto it = dirs_.rbegin(); it != dirs_.rend(); ++it) {
+            ::rmdir(it->c_str());
+        }
+        ::rmdir(root_.c_str());
+    }
+
+    void add_node(int id, const char* cpulist)
+    {
+        const auto dir = root_ + "/node" + std::to_string(id);
+        ::mkdir(dir.c_str(), 0700);
+        dirs_.push_back(dir);
+        const auto file = dir + "/cpulist";
+        if (std::FILE* f = std::fopen(file.c_str(), "w")) {
+            std::fprintf(f, "%s\n", cpulist);
+            std::fclose(f);
+        }
+        files_.push_back(file);
+    }
+
+    const std::string& root() const { return root_; }
+
+private:
+    std::string root_;
+    std::vector<std::string> dirs_;
+    std::vector<std::string> files_;
+};
+
+}
+
+TEST_CASE("NUMA topology is read from sysfs", "[numa]")
+{
+    fake_sysfs sysfs;
+    sysfs.add_node(0, "0-3,8-11");
+    sysfs.add_node(2, "4-7,12");
+
+    const tcb::numa_topology topo(sysfs.root());
+    REQUIRE(topo.is_numa());
+    REQUIRE((topo.nodes() == std::vector<int>{0, 2}));
+    REQUIRE(topo.node_of_cpu(0) == 0);
+    REQUIRE(topo.node_of_cpu(9) == 0);
+    REQUIRE(topo.node_of_cpu(5) == 2);
+    REQUIRE(topo.node_of_cpu(12) == 2);
+    REQUIRE(topo.index_of(2) == 1);
+    // Unknown CPUs belong to the first node
+    REQUIRE(topo.node_of_cpu(100) == 0);
+}
+
+TEST_CASE("A missing sysfs tree gives a single node", "[numa]")
+{
+    const tcb::numa_topology topo("/nonexistent/sysfs/node");
+    REQUIRE_FALSE(topo.is_numa());
+    REQUIRE((topo.nodes() == std::vector<int>{0}));
+    REQUIRE(topo.current_node() == 0);
+}
+
+TEST_CASE("numa_allocator on this machine", "[numa]")
+{
+    const auto& topo = tcb::numa_topology::system();
+    REQUIRE(topo.node_count() >= 1);
+
+    numa_value<test_struct> a(test_struct{"1", 2});
+    REQUIRE(a->str == "1");
+    REQUIRE(tcb::numa_arena::node_of(a.operator->()) == topo.current_node());
+
+    // Large values get a mapping of their own
+    numa_value<std::array<char, 10000>> big{};
+    REQUIRE(tcb::numa_arena::node_of(big.operator->()) == topo.current_node());
+
+    auto b = a;
+    REQUIRE(b->str == "1");
+    REQUIRE(a.get_allocator() == b.get_allocator());
+}
+
+TEST_CASE("Values migrate to the local node", "[numa]")
+{
+    // On a single-node machine the second node cannot really be bound, so
+    // this exercises the fallback as well as the migration logic. Every
+    // CPU belongs to the first node, so this thread is always local to it.
+    fake_sysfs sysfs;
+    sysfs.add_node(0, "0-4095");
+    sysfs.add_node(1, "");
+    const tcb::numa_topology topo(sysfs.root());
+    tcb::numa_arena arena(topo);
+    const int here = topo.current_node();
+    REQUIRE(here == 0);
+
+    numa_value<test_struct> v(std::allocator_arg,
+                              tcb::numa_allocator<test_struct>(here + 1, arena),
+                              tcb::in_place, "remote", 7);
+    REQUIRE(tcb::numa_arena::node_of(v.operator->()) == here + 1);
+
+    REQUIRE(tcb::migrate_to_local_node(v));
+    REQUIRE(tcb::numa_arena::node_of(v.operator->()) == here);
+    REQUIRE(v->str == "remote");
+    REQUIRE(v->i == 7);
+    REQUIRE(v.get_allocator().node() == here);
+
+    // Already local
+    REQUIRE_FALSE(tcb::migrate_to_local_node(v));
+}
+
+TEST_CASE("numa_arena keeps its own copy of the topology", "[numa]")
+{
+    fake_sysfs sysfs;
+    sysfs.add_node(0, "0-4095");
+    sysfs.add_node(3, "");
+    tcb::numa_arena arena{tcb::numa_topology(sysfs.root())};
+    REQUIRE((arena.topology().nodes() == std::vector<int>{0, 3}));
+
+    void* p = arena.allocate(24, 3);
+    REQUIRE(tcb::numa_arena::node_of(p) == 3);
+    arena.deallocate(p, 24);
+}
+
+TEST_CASE("Large blocks are unmapped with their arena", "[numa]")
+{
+    // mincore() fails on addresses which are not mapped
+    const auto page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> residency(1);
+    void* kept_page = nullptr;
+    {
+        tcb::numa_arena arena;
+        void* freed = arena.allocate(10000);
+        void* kept = arena.allocate(20000);
+        arena.deallocate(freed, 10000);
+        kept_page = reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(kept) & ~(page - 1));
+        REQUIRE(::mincore(kept_page, page, residency.data()) == 0);
+    }
+    // Never freed, but gone along with the arena
+    REQUIRE(::mincore(kept_page, page, residency.data()) == -1);
+}
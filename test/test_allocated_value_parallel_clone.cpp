@@ -0,0 +1,218 @@
+
+#include <tcb/parallel_clone.hpp>
+
+#include "catch.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using tcb::allocated_value;
+
+namespace {
+
+struct tree_node {
+    int id;
+    std::string name;
+    std::vector<allocated_value<tree_node>> children;
+};
+
+allocated_value<tree_node> make_tree(int depth, int fanout, int& next_id)
+{
+    const int id = next_id++;
+    allocated_value<tree_node> node(tree_node{id, "node " + std::to_string(id), {}});
+    if (depth > 0) {
+        for (int i = 0; i < fanout; ++i) {
+            node->children.push_back(make_tree(depth - 1, fanout, next_id));
+        }
+    }
+    return node;
+}
+
+// Checks that copy has the same contents as original, sharing no storage
+bool same_tree(const allocated_value<tree_node>& original,
+               const allocated_value<tree_node>& copy)
+{
+    if (original.operator->() == copy.operator->() || original->id != copy->id ||
+        original->name != copy->name ||
+        original->children.size() != copy->children.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < original->children.size(); ++i) {
+        if (!same_tree(original->children[i], copy->children[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+struct worker_tagged_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = worker_tagged_allocator<U>;
+    };
+
+    worker_tagged_allocator() = default;
+
+    explicit worker_tagged_allocator(std::size_t worker) : worker(worker) {}
+
+    template <typename U>
+    worker_tagged_allocator(const worker_tagged_allocator<U>& other) : worker(other.worker) {}
+
+    std::size_t worker = std::size_t(-1);
+};
+
+std::atomic<int> live_fragile{0};
+
+struct fragile {
+    explicit fragile(int id) : id(id) { ++live_fragile; }
+
+    fragile(const fragile& other) : id(other.id)
+    {
+        if (id == 42) {
+            throw std::runtime_error("fragile");
+        }
+        ++live_fragile;
+    }
+
+    fragile(fragile&& other) noexcept : id(other.id) { ++live_fragile; }
+
+    ~fragile() { --live_fragile; }
+
+    int id;
+};
+
+}
+
+// A type owning children opts in by cloning its members through the context
+namespace tcb {
+
+template <>
+struct clone_traits<tree_node> {
+    static tree_node clone(clone_context& ctx, const tree_node& node)
+    {
+        return tree_node{node.id, node.name, ctx.clone(node.children)};
+    }
+};
+
+template <typename T>
+struct worker_allocator_traits<worker_tagged_allocator<T>> {
+    static worker_tagged_allocator<T> select(const worker_tagged_allocator<T>&,
+                                             std::size_t worker)
+    {
+        return worker_tagged_allocator<T>(worker);
+    }
+};
+
+}
+
+TEST_CASE("The pool visits every index once", "[parallel-clone]")
+{
+    tcb::work_stealing_pool pool(4);
+    REQUIRE(pool.size() == 4);
+
+    std::vector<std::atomic<int>> visits(1000);
+    for (auto& v : visits) {
+        v = 0;
+    }
+    std::atomic<bool> nested_ok{true};
+    pool.for_each(0, visits.size(), [&](tcb::work_stealing_pool::worker& w, std::size_t i) {
+        ++visits[i];
+        if (w.index() >= 4) {
+            nested_ok = false;
+        }
+        // Nested ranges are forked through the worker running the call
+        std::atomic<int> inner{0};
+        auto count = [&inner](tcb::work_stealing_pool::worker&, std::size_t) { ++inner; };
+        w.for_each(0, 10, count);
+        if (inner != 10) {
+            nested_ok = false;
+        }
+    });
+
+    for (const auto& v : visits) {
+        REQUIRE(v == 1);
+    }
+    REQUIRE(nested_ok);
+}
+
+TEST_CASE("Exceptions propagate out of the pool", "[parallel-clone]")
+{
+    tcb::work_stealing_pool pool(3);
+    REQUIRE_THROWS_AS(pool.for_each(0, 100, [](tcb::work_stealing_pool::worker&, std::size_t i) {
+        if (i == 77) {
+            throw std::runtime_error("77");
+        }
+    }), const std::runtime_error&);
+
+    // The pool is still usable afterwards
+    std::atomic<int> count{0};
+    pool.for_each(0, 100, [&count](tcb::work_stealing_pool::worker&, std::size_t) { ++count; });
+    REQUIRE(count == 100);
+}
+
+TEST_CASE("Cloning a tree in parallel", "[parallel-clone]")
+{
+    int next_id = 0;
+    const auto tree = make_tree(5, 4, next_id);
+
+    tcb::work_stealing_pool pool(4);
+    const auto copy = tcb::parallel_clone(tree, pool);
+    REQUIRE(same_tree(tree, copy));
+
+    // A single-worker pool copies on the calling thread
+    tcb::work_stealing_pool serial(1);
+    REQUIRE(same_tree(tree, tcb::parallel_clone(tree, serial)));
+}
+
+TEST_CASE("Types without clone_traits are copied", "[parallel-clone]")
+{
+    tcb::work_stealing_pool pool(2);
+
+    const allocated_value<std::string> s(std::string("copied"));
+    const auto s2 = tcb::parallel_clone(s, pool);
+    REQUIRE(*s2 == "copied");
+    REQUIRE(s2.operator->() != s.operator->());
+
+    const std::vector<int> ints{1, 2, 3};
+    REQUIRE(tcb::parallel_clone(ints, pool) == ints);
+}
+
+TEST_CASE("Each worker chooses its own allocator", "[parallel-clone]")
+{
+    using value_t = allocated_value<int, worker_tagged_allocator<int>>;
+    using vector_t = std::vector<value_t, worker_tagged_allocator<value_t>>;
+
+    vector_t values;
+    for (int i = 0; i < 500; ++i) {
+        values.emplace_back(i, worker_tagged_allocator<int>{});
+    }
+
+    tcb::work_stealing_pool pool(4);
+    const auto copy = tcb::parallel_clone(values, pool);
+    REQUIRE(copy.size() == values.size());
+    // The vector itself is copied by the calling thread, worker 0
+    REQUIRE(copy.get_allocator().worker == 0);
+    for (std::size_t i = 0; i < copy.size(); ++i) {
+        REQUIRE(*copy[i] == int(i));
+        REQUIRE(copy[i].get_allocator().worker < pool.size());
+    }
+}
+
+TEST_CASE("A throwing copy destroys everything cloned so far", "[parallel-clone]")
+{
+    {
+        std::vector<allocated_value<fragile>> values;
+        for (int i = 0; i < 100; ++i) {
+            values.emplace_back(tcb::in_place, i);
+        }
+        REQUIRE(live_fragile == 100);
+
+        tcb::work_stealing_pool pool(4);
+        REQUIRE_THROWS_AS(tcb::parallel_clone(values, pool), const std::runtime_error&);
+        REQUIRE(live_fragile == 100);
+    }
+    REQUIRE(live_fragile == 0);
+}
@@ -0,0 +1,80 @@
+
+#include <tcb/pmr/allocated_value.hpp>
+#include <tcb/pmr/object_pool_resource.hpp>
+#include <tcb/pmr/stats_resource.hpp>
+
+#include "catch.hpp"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+template <std::size_t N>
+struct blob {
+    char data[N];
+};
+
+}
+
+TEST_CASE("object pool resource construction", "[pmr][pool]")
+{
+    tcb::pmr::unsynchronized_object_pool_resource pool;
+
+    const tcb::pmr::allocated_value<std::string> a{"hello", &pool};
+    REQUIRE(*a == "hello");
+}
+
+TEST_CASE("object pool resource reuses freed blocks", "[pmr][pool]")
+{
+    tcb::pmr::unsynchronized_object_pool_resource pool;
+
+    const void* first = nullptr;
+    {
+        const tcb::pmr::allocated_value<int> a{1, &pool};
+        first = &*a;
+    }
+    const tcb::pmr::allocated_value<int> b{2, &pool};
+    REQUIRE(&*b == first);
+}
+
+TEST_CASE("object pool resource carves many blocks from one chunk", "[pmr][pool]")
+{
+    tcb::pmr::stats_resource upstream;
+    tcb::pmr::unsynchronized_object_pool_resource pool{&upstream, 4096};
+
+    std::vector<tcb::pmr::allocated_value<blob<32>>> values;
+    for (int i = 0; i < 100; i++) {
+        values.emplace_back(blob<32>{}, &pool);
+    }
+    REQUIRE(upstream.snapshot().total_allocations == 1);
+
+    values.clear();
+    pool.release();
+    REQUIRE(upstream.snapshot().live_bytes == 0);
+}
+
+TEST_CASE("object pool resource forwards large requests", "[pmr][pool]")
+{
+    tcb::pmr::stats_resource upstream;
+    tcb::pmr::unsynchronized_object_pool_resource pool{&upstream};
+
+    {
+        const tcb::pmr::allocated_value<blob<2000>> a{blob<2000>{}, &pool};
+        REQUIRE(upstream.snapshot().size_histogram[11] == 1);
+    }
+    REQUIRE(upstream.snapshot().live_bytes == 0);
+}
+
+TEST_CASE("object pool resource size classes are separate", "[pmr][pool]")
+{
+    tcb::pmr::synchronized_object_pool_resource pool;
+
+    const tcb::pmr::allocated_value<blob<16>> a{blob<16>{}, &pool};
+    const tcb::pmr::allocated_value<blob<1024>> b{blob<1024>{}, &pool};
+    const tcb::pmr::allocated_value<blob<16>> c{blob<16>{}, &pool};
+
+    const auto pa = reinterpret_cast<const char*>(&*a);
+    const auto pc = reinterpret_cast<const char*>(&*c);
+    REQUIRE(pc - pa == 16);
+}
@@ -0,0 +1,111 @@
+
+#include <tcb/pmr/allocated_value.hpp>
+#include <tcb/pmr/stats_resource.hpp>
+
+#include "catch.hpp"
+
+#include <cstddef>
+#include <memory_resource>
+#include <string>
+
+TEST_CASE("stats_resource counts live and peak bytes", "[pmr][stats]")
+{
+    tcb::pmr::stats_resource res;
+
+    {
+        tcb::pmr::allocated_value<long> a{1, &res};
+        tcb::pmr::allocated_value<long> b{2, &res};
+
+        const auto s = res.snapshot();
+        REQUIRE(s.live_bytes == 2 * sizeof(long));
+        REQUIRE(s.live_allocations == 2);
+        REQUIRE(s.total_allocations == 2);
+    }
+
+    const auto s = res.snapshot();
+    REQUIRE(s.live_bytes == 0);
+    REQUIRE(s.live_allocations == 0);
+    REQUIRE(s.peak_bytes == 2 * sizeof(long));
+    REQUIRE(s.total_bytes == 2 * sizeof(long));
+
+    res.reset_peak();
+    REQUIRE(res.snapshot().peak_bytes == 0);
+}
+
+TEST_CASE("stats_resource records a size histogram", "[pmr][stats]")
+{
+    struct big { char c[100]; };
+
+    tcb::pmr::stats_resource res;
+    tcb::pmr::allocated_value<char> a{'a', &res};
+    tcb::pmr::allocated_value<big> b{big{}, &res};
+
+    const auto s = res.snapshot();
+    REQUIRE(s.size_histogram[0] == 1);   // 1 byte
+    REQUIRE(s.size_histogram[7] == 1);   // 65..128 bytes
+}
+
+TEST_CASE("stats_resource samples lifetimes", "[pmr][stats]")
+{
+    tcb::pmr::stats_resource res{std::pmr::get_default_resource(), 1};
+
+    {
+        tcb::pmr::allocated_value<int> a{1, &res};
+    }
+
+    const auto s = res.snapshot();
+    REQUIRE(s.sampled_allocations == 1);
+
+    std::size_t recorded = 0;
+    for (auto n : s.lifetime_histogram) {
+        recorded += n;
+    }
+    REQUIRE(recorded == 1);
+}
+
+namespace {
+
+// Hands out the same block every time, as a pool might
+class one_block_resource : public std::pmr::memory_resource {
+    void* do_allocate(std::size_t, std::size_t) override { return block_; }
+    void do_deallocate(void*, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+    alignas(std::max_align_t) unsigned char block_[64];
+};
+
+}
+
+TEST_CASE("stats_resource samples recycled addresses at the sample rate", "[pmr][stats]")
+{
+    one_block_resource upstream;
+    tcb::pmr::stats_resource res{&upstream, 4};
+
+    for (int i = 0; i < 1000; ++i) {
+        tcb::pmr::allocated_value<int> a{i, &res};
+    }
+
+    const auto s = res.snapshot();
+    REQUIRE(s.sampled_allocations > 150);
+    REQUIRE(s.sampled_allocations < 350);
+
+    std::size_t recorded = 0;
+    for (auto n : s.lifetime_histogram) {
+        recorded += n;
+    }
+    REQUIRE(recorded == s.sampled_allocations);
+}
+
+TEST_CASE("stats_resource forwards to its upstream", "[pmr][stats]")
+{
+    tcb::pmr::stats_resource inner;
+    tcb::pmr::stats_resource outer{&inner};
+    REQUIRE(outer.upstream_resource() == &inner);
+
+    const tcb::pmr::allocated_value<std::string> a{"hello", &outer};
+    REQUIRE(*a == "hello");
+    REQUIRE(inner.snapshot().live_allocations == outer.snapshot().live_allocations);
+}
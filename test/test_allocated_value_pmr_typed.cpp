@@ -0,0 +1,76 @@
+
+#include <tcb/pmr/allocated_value.hpp>
+#include <tcb/pmr/object_pool_resource.hpp>
+#include <tcb/pmr/stats_resource.hpp>
+#include <tcb/pmr/typed_resource_allocator.hpp>
+
+#include "catch.hpp"
+
+#include <cstddef>
+#include <new>
+#include <string>
+
+using pool_t = tcb::pmr::unsynchronized_object_pool_resource;
+
+template <typename T>
+using pool_value = tcb::pmr::typed_allocated_value<T, pool_t>;
+
+static_assert(!std::is_default_constructible<pool_value<int>>::value, "");
+static_assert(sizeof(pool_value<int>) == sizeof(tcb::pmr::allocated_value<int>), "");
+
+TEST_CASE("typed_allocated_value construction", "[pmr][typed]")
+{
+    pool_t pool;
+    const pool_value<std::string> a{"hello", &pool};
+    REQUIRE(*a == "hello");
+    REQUIRE(a.get_allocator().resource() == &pool);
+}
+
+TEST_CASE("typed_allocated_value copy and move", "[pmr][typed]")
+{
+    pool_t pool;
+    const pool_value<int> a{3, &pool};
+    const auto b = a;
+    REQUIRE(*b == 3);
+    REQUIRE(b.get_allocator() == a.get_allocator());
+
+    auto c = pool_value<int>{4, &pool};
+    const auto d = std::move(c);
+    REQUIRE(*d == 4);
+}
+
+TEST_CASE("typed_resource_allocator calls through to its resource", "[pmr][typed]")
+{
+    tcb::pmr::stats_resource stats;
+    {
+        const tcb::pmr::typed_allocated_value<long, tcb::pmr::stats_resource> a{1, &stats};
+        REQUIRE(stats.snapshot().live_bytes == sizeof(long));
+    }
+    REQUIRE(stats.snapshot().live_bytes == 0);
+}
+
+TEST_CASE("typed_resource_allocator interoperates with polymorphic_allocator", "[pmr][typed]")
+{
+    pool_t pool1;
+    pool_t pool2;
+
+    const tcb::pmr::typed_resource_allocator<int, pool_t> typed{&pool1};
+    const std::pmr::polymorphic_allocator<long> poly = typed;
+
+    REQUIRE(poly.resource() == &pool1);
+    REQUIRE(typed == poly);
+    REQUIRE(poly == typed);
+    REQUIRE(typed != std::pmr::polymorphic_allocator<int>{&pool2});
+
+    const tcb::pmr::allocated_value<int> a{3, typed};
+    const pool_value<int> b{3, &pool2};
+    REQUIRE(a == b);
+}
+
+TEST_CASE("typed_resource_allocator rejects oversized requests", "[pmr][typed]")
+{
+    tcb::pmr::stats_resource stats;
+    tcb::pmr::typed_resource_allocator<long, tcb::pmr::stats_resource> alloc{&stats};
+    REQUIRE_THROWS_AS(alloc.allocate(std::size_t(-1) / 2), const std::bad_array_new_length&);
+    REQUIRE(stats.snapshot().total_allocations == 0);
+}
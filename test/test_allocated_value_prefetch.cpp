@@ -0,0 +1,98 @@
+
+#include <tcb/prefetch.hpp>
+
+#include "catch.hpp"
+
+#include <forward_list>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <vector>
+
+using tcb::allocated_value;
+
+namespace {
+
+std::vector<allocated_value<int>> make_values(int n)
+{
+    std::vector<allocated_value<int>> values;
+    for (int i = 0; i < n; ++i) {
+        values.emplace_back(i);
+    }
+    return values;
+}
+
+}
+
+TEST_CASE("for_each_prefetched visits every element in order", "[prefetch]")
+{
+    for (int n : {0, 1, 5, 16, 17, 100}) {
+        for (std::size_t distance : {0, 1, 4, 16, 200}) {
+            const auto values = make_values(n);
+            std::vector<int> seen;
+            tcb::for_each_prefetched(values, [&](const allocated_value<int>& v) {
+                seen.push_back(*v);
+            }, distance);
+
+            std::vector<int> expected(n);
+            std::iota(expected.begin(), expected.end(), 0);
+            REQUIRE(seen == expected);
+        }
+    }
+}
+
+TEST_CASE("for_each_prefetched can modify elements", "[prefetch]")
+{
+    auto values = make_values(50);
+    tcb::for_each_prefetched(values.begin(), values.end(),
+                             [](allocated_value<int>& v) { *v *= 2; });
+    REQUIRE(*values[49] == 98);
+}
+
+TEST_CASE("for_each_prefetched accepts forward ranges of pointers", "[prefetch]")
+{
+    std::forward_list<std::unique_ptr<int>> list;
+    for (int i = 0; i < 10; ++i) {
+        list.emplace_front(new int(i));
+    }
+
+    int sum = 0;
+    tcb::for_each_prefetched(list, [&](const std::unique_ptr<int>& p) { sum += *p; }, 3);
+    REQUIRE(sum == 45);
+}
+
+TEST_CASE("batch_get gathers values in order", "[prefetch]")
+{
+    for (int n : {0, 1, 7, 16, 33, 100}) {
+        for (std::size_t distance : {0, 1, 8, 16, 200}) {
+            const auto values = make_values(n);
+            std::vector<int> out(n, -1);
+            const auto end = tcb::batch_get(values, out.begin(), distance);
+
+            std::vector<int> expected(n);
+            std::iota(expected.begin(), expected.end(), 0);
+            REQUIRE(end == out.end());
+            REQUIRE(out == expected);
+        }
+    }
+}
+
+TEST_CASE("Moved-from handles are not prefetched", "[prefetch]")
+{
+    auto values = make_values(10);
+    auto moved = std::move(values[3]);
+
+    int visited = 0;
+    tcb::for_each_prefetched(values, [&](const allocated_value<int>&) { ++visited; }, 4);
+    REQUIRE(visited == 10);
+}
+
+TEST_CASE("batch_get accepts pointers and output iterators", "[prefetch]")
+{
+    const auto values = make_values(3);
+    const int* raw[] = {&*values[2], &*values[0], &*values[1]};
+
+    std::vector<int> out;
+    tcb::batch_get(std::begin(raw), std::end(raw), std::back_inserter(out), 2);
+    REQUIRE(out == (std::vector<int>{2, 0, 1}));
+}
@@ -0,0 +1,192 @@
+
+#include <tcb/slot_ptr.hpp>
+
+#include "catch.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Each test case uses its own tables
+struct basic_tag {};
+struct growth_tag {};
+struct copy_tag {};
+struct shrink_tag {};
+struct counted_tag {};
+struct move_only_tag {};
+struct traits_tag {};
+
+int live_counted = 0;
+
+struct counted {
+    explicit counted(int id) : id(id) { ++live_counted; }
+    counted(const counted& other) : id(other.id) { ++live_counted; }
+    ~counted() { --live_counted; }
+
+    int id;
+};
+
+template <typename T, typename Tag>
+using slot_value = tcb::allocated_value<T, tcb::slot_allocator<T, Tag>>;
+
+}
+
+static_assert(sizeof(tcb::slot_ptr<int>) == 4, "");
+static_assert(sizeof(slot_value<std::string, basic_tag>) == 4, "");
+
+TEST_CASE("slot_ptr handles", "[slot-ptr]")
+{
+    using table = tcb::slot_table<std::string, basic_tag>;
+    {
+        const slot_value<std::string, basic_tag> a("hello");
+        auto b = a;
+        REQUIRE(*b == "hello");
+        REQUIRE(table::instance().live() == 2);
+
+        b->append(" world");
+        REQUIRE(*a == "hello");
+        REQUIRE(*b == "hello world");
+
+        auto c = std::move(b);
+        REQUIRE(*c == "hello world");
+        REQUIRE(table::instance().live() == 2);
+    }
+    REQUIRE(table::instance().live() == 0);
+}
+
+TEST_CASE("slot_table growth moves values without invalidating handles", "[slot-ptr]")
+{
+    using table = tcb::slot_table<std::string, growth_tag>;
+
+    std::vector<slot_value<std::string, growth_tag>> values;
+    values.emplace_back("first value, too long for the small string buffer");
+    const auto* before = values.front().operator->().get();
+    const auto index = values.front().operator->().index();
+
+    for (int i = 1; i < 1000; ++i) {
+        values.emplace_back(std::to_string(i));
+    }
+    REQUIRE(table::instance().capacity() >= 1000);
+
+    // The storage has moved, but the handle still finds its value
+    REQUIRE(values.front().operator->().get() != before);
+    REQUIRE(values.front().operator->().index() == index);
+    REQUIRE(*values.front() == "first value, too long for the small string buffer");
+    for (int i = 1; i < 1000; ++i) {
+        REQUIRE(*values[i] == std::to_string(i));
+    }
+}
+
+TEST_CASE("Copying a value when the slot_table is full", "[slot-ptr]")
+{
+    using table = tcb::slot_table<std::string, copy_tag>;
+    auto& t = table::instance();
+
+    std::vector<slot_value<std::string, copy_tag>> values;
+    values.emplace_back("a value too long for the small string buffer");
+    while (t.live() + 1 < t.capacity()) {
+        values.emplace_back("x");
+    }
+    const auto capacity = t.capacity();
+
+    // The copy's slot is allocated while the source is being read
+    values.push_back(values.front());
+    REQUIRE(t.capacity() > capacity);
+    REQUIRE(*values.back() == "a value too long for the small string buffer");
+    REQUIRE(*values.front() == *values.back());
+}
+
+TEST_CASE("slot_table reuses slots and shrinks", "[slot-ptr]")
+{
+    using table = tcb::slot_table<int, shrink_tag>;
+    auto& t = table::instance();
+
+    std::vector<slot_value<int, shrink_tag>> values;
+    for (int i = 0; i < 500; ++i) {
+        values.emplace_back(i);
+    }
+    const auto capacity = t.capacity();
+
+    // Free the upper half
+    values.erase(values.begin() + 250, values.end());
+    REQUIRE(t.capacity() == capacity);
+    REQUIRE(t.live() == 250);
+
+    t.shrink_to_fit();
+    REQUIRE(t.capacity() == 251);
+    for (int i = 0; i < 250; ++i) {
+        REQUIRE(*values[i] == i);
+    }
+
+    // Slots below the new end remain available
+    values.erase(values.begin() + 10, values.begin() + 20);
+    for (int i = 0; i < 10; ++i) {
+        values.emplace_back(i);
+    }
+    REQUIRE(t.capacity() == 251);
+    REQUIRE(*values.back() == 9);
+    using ptr = tcb::slot_ptr<int, shrink_tag>;
+    REQUIRE(std::pointer_traits<ptr>::pointer_to(*values.back()) == values.back().operator->());
+}
+
+TEST_CASE("Originals left by slot_table growth are destroyed later", "[slot-ptr]")
+{
+    using table = tcb::slot_table<counted, counted_tag>;
+    auto& t = table::instance();
+    {
+        std::vector<slot_value<counted, counted_tag>> values;
+        values.emplace_back(tcb::in_place, 0);
+        while (t.live() + 1 < t.capacity()) {
+            values.emplace_back(tcb::in_place, 1);
+        }
+        const auto n = values.size();
+        REQUIRE(live_counted == int(n));
+
+        // Growing copies every value, and keeps the originals for now
+        values.push_back(values.front());
+        REQUIRE(live_counted == int(2 * n + 1));
+        REQUIRE(values.back()->id == 0);
+
+        values.pop_back();
+        REQUIRE(live_counted == int(n));
+
+        // Moving the storage explicitly does not keep them
+        t.reserve(4 * t.capacity());
+        REQUIRE(live_counted == int(n));
+    }
+    REQUIRE(live_counted == 0);
+}
+
+TEST_CASE("slot_table moves move-only values", "[slot-ptr]")
+{
+    using value = slot_value<std::unique_ptr<int>, move_only_tag>;
+    std::vector<value> values;
+    for (int i = 0; i < 200; ++i) {
+        values.emplace_back(tcb::in_place, new int(i));
+    }
+    for (int i = 0; i < 200; ++i) {
+        REQUIRE(**values[i] == i);
+    }
+}
+
+TEST_CASE("slot_ptr pointer traits", "[slot-ptr]")
+{
+    using ptr = tcb::slot_ptr<int, traits_tag>;
+    tcb::slot_allocator<int, traits_tag> alloc;
+
+    const ptr p = alloc.allocate(1);
+    *p = 7;
+    REQUIRE(p.index() != 0);
+    REQUIRE(std::pointer_traits<ptr>::pointer_to(*p) == p);
+
+    const tcb::slot_ptr<const int, traits_tag> cp = p;
+    REQUIRE(*cp == 7);
+    const tcb::slot_ptr<void, traits_tag> vp = p;
+    REQUIRE(static_cast<ptr>(vp) == p);
+
+    REQUIRE(ptr{} == nullptr);
+    REQUIRE(p != nullptr);
+    alloc.deallocate(p, 1);
+}
@@ -0,0 +1,231 @@
+
+#include <tcb/value_soa.hpp>
+
+#include "catch.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <numeric>
+#include <type_traits>
+
+namespace {
+
+struct particle {
+    float x = 0;
+    float y = 0;
+    double mass = 0;
+    std::int32_t id = 0;
+    char unlisted = 'u';
+};
+
+bool operator==(const particle& lhs, const particle& rhs)
+{
+    return lhs.x == rhs.x && lhs.y == rhs.y && lhs.mass == rhs.mass && lhs.id == rhs.id;
+}
+
+particle make_particle(int i)
+{
+    particle p;
+    p.x = float(i);
+    p.y = float(-i);
+    p.mass = i * 0.5;
+    p.id = i;
+    p.unlisted = 'x';
+    return p;
+}
+
+// A stateful allocator which counts the blocks outstanding from each
+// instance, so that memory freed through the wrong one is noticed
+template <typename T, bool Propagate>
+struct counting_allocator {
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::integral_constant<bool, Propagate>;
+    using propagate_on_container_move_assignment = std::integral_constant<bool, Propagate>;
+    using propagate_on_container_swap = std::integral_constant<bool, Propagate>;
+    using is_always_equal = std::false_type;
+
+    template <typename U>
+    struct rebind {
+        using other = counting_allocator<U, Propagate>;
+    };
+
+    explicit counting_allocator(long& outstanding) : outstanding(&outstanding) {}
+
+    template <typename U>
+    counting_allocator(const counting_allocator<U, Propagate>& other) noexcept
+        : outstanding(other.outstanding)
+    {}
+
+    T* allocate(std::size_t n)
+    {
+        ++*outstanding;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        --*outstanding;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    friend bool operator==(const counting_allocator& lhs, const counting_allocator& rhs)
+    {
+        return lhs.outstanding == rhs.outstanding;
+    }
+
+    friend bool operator!=(const counting_allocator& lhs, const counting_allocator& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    long* outstanding;
+};
+
+template <bool Propagate>
+void check_unequal_allocators()
+{
+    using alloc = counting_allocator<particle, Propagate>;
+    using soa_type = tcb::value_soa<particle, alloc>;
+
+    long first = 0;
+    long second = 0;
+    {
+        soa_type a{alloc(first)};
+        soa_type b{alloc(second)};
+        for (int i = 0; i < 10; ++i) {
+            a.push_back(make_particle(i));
+        }
+        b.push_back(make_particle(100));
+
+        b = a;
+        REQUIRE(b.size() == 10);
+        REQUIRE(b.get(9) == make_particle(9));
+        REQUIRE(b.get_allocator().outstanding == (Propagate ? &first : &second));
+
+        soa_type c{alloc(second)};
+        c.push_back(make_particle(200));
+        c = std::move(a);
+        REQUIRE(c.size() == 10);
+        REQUIRE(c.get(9) == make_particle(9));
+        REQUIRE(c.get_allocator().outstanding == (Propagate ? &first : &second));
+
+        soa_type d{alloc(first)};
+        soa_type e{alloc(second)};
+        d.push_back(make_particle(1));
+        e.push_back(make_particle(2));
+        e.push_back(make_particle(3));
+        swap(d, e);
+        REQUIRE(d.size() == 2);
+        REQUIRE(d.get(1) == make_particle(3));
+        REQUIRE(e.size() == 1);
+        REQUIRE(e.get(0) == make_particle(1));
+        REQUIRE(d.get_allocator().outstanding == (Propagate ? &second : &first));
+    }
+    // Every block was returned to the allocator which made it
+    REQUIRE(first == 0);
+    REQUIRE(second == 0);
+}
+
+}
+
+template <>
+struct tcb::soa_fields<particle> {
+    static constexpr auto members =
+            std::make_tuple(&particle::x, &particle::y, &particle::mass, &particle::id);
+};
+
+using soa = tcb::value_soa<particle>;
+
+static_assert(std::is_same<soa::field_type<2>, double>::value, "");
+
+TEST_CASE("value_soa stores and copies out elements", "[soa]")
+{
+    soa s;
+    REQUIRE(s.empty());
+
+    for (int i = 0; i < 100; ++i) {
+        s.push_back(make_particle(i));
+    }
+    REQUIRE(s.size() == 100);
+    REQUIRE(s.capacity() >= 100);
+
+    for (int i = 0; i < 100; ++i) {
+        const particle p = s[i];
+        REQUIRE(p == make_particle(i));
+        // Fields which are not listed are not stored
+        REQUIRE(p.unlisted == 'u');
+    }
+}
+
+TEST_CASE("value_soa copies are independent of the container", "[soa]")
+{
+    soa s;
+    s.push_back(make_particle(1));
+
+    const particle copy = s[0];
+    auto handle = s.copy_out(0);
+    s[0] = make_particle(2);
+
+    REQUIRE(copy == make_particle(1));
+    REQUIRE(*handle == make_particle(1));
+    REQUIRE(s.get(0) == make_particle(2));
+}
+
+TEST_CASE("value_soa field spans are contiguous and aligned", "[soa]")
+{
+    soa s;
+    for (int i = 0; i < 37; ++i) {
+        s.push_back(make_particle(i));
+    }
+
+    auto mass = s.field<&particle::mass>();
+    REQUIRE(mass.size() == 37);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(mass.data()) % soa::alignment == 0);
+    REQUIRE(std::accumulate(mass.begin(), mass.end(), 0.0) == 0.5 * (36 * 37 / 2));
+
+    auto ids = s.field<3>();
+    REQUIRE(reinterpret_cast<std::uintptr_t>(ids.data()) % soa::alignment == 0);
+    REQUIRE(ids[36] == 36);
+
+    // Writes through a span are visible in copied-out elements
+    for (auto& x : s.field<&particle::x>()) {
+        x *= 2;
+    }
+    REQUIRE(s.get(10).x == 20.0f);
+    REQUIRE(s[10].get<&particle::y>() == -10.0f);
+}
+
+TEST_CASE("value_soa copy and move", "[soa]")
+{
+    soa a;
+    for (int i = 0; i < 10; ++i) {
+        a.push_back(make_particle(i));
+    }
+
+    soa b = a;
+    b[0] = make_particle(100);
+    REQUIRE(a.get(0) == make_particle(0));
+    REQUIRE(b.get(0) == make_particle(100));
+    REQUIRE(b.get(9) == make_particle(9));
+
+    soa c = std::move(b);
+    REQUIRE(c.size() == 10);
+    REQUIRE(b.size() == 0);
+
+    a = c;
+    REQUIRE(a.get(0) == make_particle(100));
+
+    a.pop_back();
+    REQUIRE(a.size() == 9);
+    // The removed element's fields read as zero padding again
+    REQUIRE(a.field<&particle::mass>().data()[9] == 0.0);
+    a.clear();
+    REQUIRE(a.empty());
+    REQUIRE(a.field<&particle::id>().data()[0] == 0);
+}
+
+TEST_CASE("value_soa assignment and swap follow allocator propagation", "[soa]")
+{
+    check_unequal_allocators<false>();
+    check_unequal_allocators<true>();
+}
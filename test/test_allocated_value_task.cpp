@@ -0,0 +1,209 @@
+
+#include <tcb/task.hpp>
+
+#include "catch.hpp"
+
+#include <array>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+using tcb::task;
+
+namespace {
+
+struct allocation_counts {
+    int allocations = 0;
+    int deallocations = 0;
+};
+
+// A stateful allocator, which must be stored in each frame
+template <typename T>
+struct counting_allocator {
+    using value_type = T;
+
+    explicit counting_allocator(allocation_counts& counts) : counts(&counts) {}
+
+    template <typename U>
+    counting_allocator(const counting_allocator<U>& other) : counts(other.counts) {}
+
+    T* allocate(std::size_t n)
+    {
+        ++counts->allocations;
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n)
+    {
+        ++counts->deallocations;
+        std::allocator<T>().deallocate(p, n);
+    }
+
+    friend bool operator==(const counting_allocator& lhs, const counting_allocator& rhs)
+    {
+        return lhs.counts == rhs.counts;
+    }
+
+    allocation_counts* counts;
+};
+
+using counted_alloc = counting_allocator<std::byte>;
+
+task<int, counted_alloc> add(std::allocator_arg_t, counted_alloc, int a, int b)
+{
+    co_return a + b;
+}
+
+task<int, counted_alloc> sum_to(std::allocator_arg_t, counted_alloc alloc, int n)
+{
+    int total = 0;
+    for (int i = 1; i <= n; ++i) {
+        total = co_await add(std::allocator_arg, alloc, total, i);
+    }
+    co_return total;
+}
+
+task<std::string> greet(std::string name)
+{
+    co_return "hello " + name;
+}
+
+// The awaited task is a temporary, destroyed before r is used
+task<std::size_t> greeting_size()
+{
+    auto&& r = co_await greet("rvalue");
+    co_return r.size();
+}
+
+task<void> fail()
+{
+    throw std::runtime_error("failed");
+    co_return;
+}
+
+task<bool> catch_failure()
+{
+    try {
+        co_await fail();
+    } catch (const std::runtime_error&) {
+        co_return true;
+    }
+    co_return false;
+}
+
+struct big_result {
+    std::array<int, 64> values;
+};
+
+task<big_result, counted_alloc> make_big(std::allocator_arg_t, counted_alloc)
+{
+    big_result r{};
+    r.values[63] = 42;
+    co_return r;
+}
+
+struct widget {
+    task<int, counted_alloc> scaled(std::allocator_arg_t, counted_alloc, int x) const
+    {
+        co_return x * factor;
+    }
+
+    int factor;
+};
+
+}
+
+TEST_CASE("Task frames are allocated with the given allocator", "[task]")
+{
+    allocation_counts counts;
+    {
+        auto t = add(std::allocator_arg, counted_alloc(counts), 1, 2);
+        REQUIRE(counts.allocations == 1);
+        REQUIRE_FALSE(t.done());
+
+        t.start();
+        REQUIRE(t.done());
+        REQUIRE(t.get() == 3);
+    }
+    REQUIRE(counts.deallocations == 1);
+}
+
+TEST_CASE("Awaited tasks pass on their results", "[task]")
+{
+    allocation_counts counts;
+    {
+        auto t = sum_to(std::allocator_arg, counted_alloc(counts), 10);
+        t.start();
+        REQUIRE(t.get() == 55);
+    }
+    REQUIRE(counts.allocations == 11);
+    REQUIRE(counts.deallocations == 11);
+}
+
+TEST_CASE("Tasks use std::allocator by default", "[task]")
+{
+    auto t = greet("world");
+    t.start();
+    REQUIRE(std::move(t).get() == "hello world");
+}
+
+TEST_CASE("Awaiting a temporary task yields its result by value", "[task]")
+{
+    using rvalue_result = decltype(std::declval<task<std::string>>().operator co_await()
+                                           .await_resume());
+    using lvalue_result = decltype(std::declval<task<std::string>&>().operator co_await()
+                                           .await_resume());
+    static_assert(std::is_same<rvalue_result, std::string>::value, "");
+    static_assert(std::is_same<lvalue_result, std::string&>::value, "");
+
+    auto t = greeting_size();
+    t.start();
+    REQUIRE(t.get() == 12);
+}
+
+TEST_CASE("Exceptions propagate out of tasks", "[task]")
+{
+    auto t = fail();
+    t.start();
+    REQUIRE(t.done());
+    REQUIRE_THROWS_AS(t.get(), const std::runtime_error&);
+
+    auto c = catch_failure();
+    c.start();
+    REQUIRE(c.get());
+}
+
+TEST_CASE("Large results are returned through an allocated_value", "[task]")
+{
+    static_assert(task<big_result, counted_alloc>::promise_type::is_boxed, "");
+    static_assert(!task<int, counted_alloc>::promise_type::is_boxed, "");
+
+    allocation_counts counts;
+    {
+        auto t = make_big(std::allocator_arg, counted_alloc(counts));
+        t.start();
+        // One frame, and one box for the result
+        REQUIRE(counts.allocations == 2);
+        REQUIRE(t.get().values[63] == 42);
+
+        auto box = t.take();
+        REQUIRE(box->values[63] == 42);
+        REQUIRE(box.get_allocator().counts == &counts);
+    }
+    REQUIRE(counts.deallocations == 2);
+}
+
+TEST_CASE("Member function tasks take the allocator after the object", "[task]")
+{
+    allocation_counts counts;
+    const widget w{3};
+    {
+        auto t = w.scaled(std::allocator_arg, counted_alloc(counts), 5);
+        t.start();
+        REQUIRE(t.get() == 15);
+    }
+    REQUIRE(counts.allocations == 1);
+    REQUIRE(counts.deallocations == 1);
+}
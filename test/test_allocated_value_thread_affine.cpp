@@ -0,0 +1,147 @@
+
+#include <tcb/thread_affine_allocator.hpp>
+
+#include "catch.hpp"
+#include "hh_short_alloc.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t arena_size = 4096;
+
+template <typename T>
+using affine_alloc = tcb::thread_affine_allocator<hh::short_alloc<T, arena_size>>;
+
+template <typename T>
+using affine_value = tcb::allocated_value<T, affine_alloc<T>>;
+
+}
+
+TEST_CASE("Owner-thread deallocation is direct", "[thread-affine]")
+{
+    hh::arena<arena_size> arena;
+    affine_alloc<long> alloc(arena);
+    {
+        const affine_value<long> a(1, alloc);
+        REQUIRE(arena.used() > 0);
+    }
+    REQUIRE(alloc.pending() == 0);
+    REQUIRE(arena.used() == 0);
+}
+
+TEST_CASE("Foreign-thread deallocation is queued for the owner", "[thread-affine]")
+{
+    hh::arena<arena_size> arena;
+    affine_alloc<std::string> alloc(arena);
+
+    affine_value<std::string> a(std::string("moved between threads"), alloc);
+    affine_value<std::string> b(std::string("also moved"), alloc);
+    const auto used = arena.used();
+
+    std::atomic<bool> ok{false};
+    std::thread consumer([&ok](affine_value<std::string> v1, affine_value<std::string> v2) {
+        ok = *v1 == "moved between threads" && *v2 == "also moved" &&
+             !v1.get_allocator().on_owner_thread();
+        // v1 and v2 are destroyed on this thread
+    }, std::move(a), std::move(b));
+    consumer.join();
+    REQUIRE(ok);
+
+    // The arena has not been touched by the other thread
+    REQUIRE(arena.used() == used);
+    REQUIRE(alloc.pending() == 2);
+
+    // The next allocation on the owning thread drains the queue, and can
+    // reuse the returned space
+    const affine_value<std::string> c(std::string("after"), alloc);
+    REQUIRE(alloc.pending() == 0);
+    REQUIRE(arena.used() <= used);
+}
+
+TEST_CASE("Rebound thread-affine allocators keep their owner", "[thread-affine]")
+{
+    hh::arena<arena_size> arena;
+    affine_alloc<int> alloc(arena);
+    const affine_alloc<double> rebound(alloc);
+
+    REQUIRE(rebound.owner() == std::this_thread::get_id());
+    REQUIRE(affine_alloc<int>(rebound) == alloc);
+}
+
+TEST_CASE("Rebound thread-affine allocators share a return queue", "[thread-affine]")
+{
+    static_assert(std::is_nothrow_constructible<affine_alloc<double>,
+                                                const affine_alloc<int>&>::value, "");
+
+    hh::arena<arena_size> arena;
+    affine_alloc<int> alloc(arena);
+    affine_alloc<double> rebound(alloc);
+
+    double* p = rebound.allocate(1);
+    std::thread other([&rebound, p] { rebound.deallocate(p, 1); });
+    other.join();
+
+    // The owner drains the block through the original adaptor
+    REQUIRE(alloc.pending() == 1);
+    REQUIRE(alloc.drain() == 1);
+    REQUIRE(arena.used() == 0);
+}
+
+TEST_CASE("The last adaptor copy dying on a foreign thread frees nothing there",
+          "[thread-affine]")
+{
+    hh::arena<arena_size> arena;
+    std::atomic<bool> go{false};
+    std::atomic<bool> ok{false};
+
+    // Every copy of the adaptor made on this thread is destroyed before
+    // the worker finishes, so the worker destroys the last one
+    std::thread worker([&go, &ok](affine_value<int> v) {
+        while (!go) {
+            std::this_thread::yield();
+        }
+        ok = *v == 42;
+    }, affine_value<int>(42, affine_alloc<int>(arena)));
+    const auto used = arena.used();
+    go = true;
+    worker.join();
+    REQUIRE(ok);
+
+    REQUIRE(arena.used() == used);
+    REQUIRE(tcb::drain_thread_affine_allocators() == 1);
+    REQUIRE(arena.used() == 0);
+}
+
+TEST_CASE("Many threads returning blocks", "[thread-affine]")
+{
+    const int producers = 4;
+    const int per_producer = 500;
+
+    tcb::thread_affine_allocator<std::allocator<int>> alloc{std::allocator<int>()};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < producers; ++t) {
+        std::vector<tcb::allocated_value<int, decltype(alloc)>> batch;
+        for (int i = 0; i < per_producer; ++i) {
+            batch.emplace_back(i, alloc);
+        }
+        threads.emplace_back([](std::vector<tcb::allocated_value<int, decltype(alloc)>> b) {
+            b.clear();
+        }, std::move(batch));
+
+        // The owner keeps allocating, draining whatever has arrived
+        for (int i = 0; i < 50; ++i) {
+            const tcb::allocated_value<int, decltype(alloc)> v(i, alloc);
+        }
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    alloc.drain();
+    REQUIRE(alloc.pending() == 0);
+}
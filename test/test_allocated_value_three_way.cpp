@@ -0,0 +1,174 @@
+
+#include <tcb/allocated_value.hpp>
+
+#include "catch.hpp"
+
+#include <compare>
+#include <limits>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+using tcb::allocated_value;
+using tcb::make_allocated_value;
+
+namespace {
+
+int three_way_count = 0;
+int less_count = 0;
+
+struct spaceship {
+    int i;
+
+    friend bool operator==(const spaceship&, const spaceship&) = default;
+
+    friend std::strong_ordering operator<=>(const spaceship& lhs, const spaceship& rhs)
+    {
+        ++three_way_count;
+        return lhs.i <=> rhs.i;
+    }
+};
+
+// A type providing only operator< and operator==
+struct legacy {
+    int i;
+
+    friend bool operator==(const legacy& lhs, const legacy& rhs) { return lhs.i == rhs.i; }
+
+    friend bool operator<(const legacy& lhs, const legacy& rhs)
+    {
+        ++less_count;
+        return lhs.i < rhs.i;
+    }
+};
+
+template <typename T>
+struct counting_allocator : std::allocator<T> {
+    static inline int allocations = 0;
+
+    template <typename U>
+    struct rebind { using other = counting_allocator<U>; };
+
+    counting_allocator() = default;
+    template <typename U>
+    counting_allocator(const counting_allocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n)
+    {
+        ++allocations;
+        return std::allocator<T>::allocate(n);
+    }
+};
+
+}
+
+// legacy's comparisons are reflexive, so self-comparison can be skipped
+template <>
+struct tcb::is_reflexively_comparable<legacy> : std::true_type {};
+
+TEST_CASE("operator<=> is used when T provides it", "[three_way]")
+{
+    static_assert(std::is_same_v<decltype(allocated_value<int>{} <=> allocated_value<int>{}),
+                                 std::strong_ordering>);
+    static_assert(std::is_same_v<decltype(allocated_value<double>{} <=> 1.0),
+                                 std::partial_ordering>);
+    static_assert(std::is_same_v<decltype(allocated_value<legacy>{} <=> legacy{}),
+                                 std::weak_ordering>);
+
+    const auto a = make_allocated_value<spaceship>(spaceship{1});
+    const auto b = make_allocated_value<spaceship>(spaceship{2});
+
+    three_way_count = 0;
+    REQUIRE((a <=> b) == std::strong_ordering::less);
+    REQUIRE(three_way_count == 1);
+
+    three_way_count = 0;
+    REQUIRE(a < b);
+    REQUIRE(a <= b);
+    REQUIRE_FALSE(a > b);
+    REQUIRE_FALSE(a >= b);
+    REQUIRE(three_way_count == 4);
+}
+
+TEST_CASE("Mixed comparisons with T use operator<=>", "[three_way]")
+{
+    const auto a = make_allocated_value<std::string>("b");
+    const std::string s = "c";
+
+    REQUIRE((a <=> s) == std::strong_ordering::less);
+    REQUIRE((s <=> a) == std::strong_ordering::greater);
+    REQUIRE(a < s);
+    REQUIRE(s > a);
+    REQUIRE(a <= std::string("b"));
+    REQUIRE(std::string("b") >= a);
+    REQUIRE(a == std::string("b"));
+    REQUIRE(std::string("b") == a);
+    REQUIRE(a != s);
+    REQUIRE(s != a);
+}
+
+TEST_CASE("operator<=> is synthesised from operator< when T lacks it", "[three_way]")
+{
+    const auto a = make_allocated_value<legacy>(legacy{1});
+    const auto b = make_allocated_value<legacy>(legacy{1});
+
+    less_count = 0;
+    REQUIRE((a <=> b) == std::weak_ordering::equivalent);
+    REQUIRE(less_count == 2);
+
+    less_count = 0;
+    REQUIRE((a <=> a) == std::weak_ordering::equivalent);
+    REQUIRE(less_count == 0);
+}
+
+TEST_CASE("Comparing NaNs through operator<=> is unordered", "[three_way]")
+{
+    const auto nan = make_allocated_value<double>(std::numeric_limits<double>::quiet_NaN());
+
+    REQUIRE((nan <=> nan) == std::partial_ordering::unordered);
+    REQUIRE_FALSE(nan < nan);
+    REQUIRE_FALSE(nan >= nan);
+}
+
+TEST_CASE("Transparent set lookup does not allocate", "[three_way]")
+{
+    using value_type = allocated_value<std::string, counting_allocator<std::string>>;
+    std::set<value_type, tcb::allocated_value_less> set;
+    set.emplace(std::string("apple"));
+    set.emplace(std::string("banana"));
+
+    counting_allocator<std::string>::allocations = 0;
+    REQUIRE(set.find(std::string("banana")) != set.end());
+    REQUIRE(set.find(std::string_view("apple")) != set.end());
+    REQUIRE(set.count(std::string_view("cherry")) == 0);
+    REQUIRE(counting_allocator<std::string>::allocations == 0);
+}
+
+TEST_CASE("Transparent unordered_set lookup does not allocate", "[three_way]")
+{
+    using value_type = allocated_value<std::string, counting_allocator<std::string>>;
+    using hash = tcb::allocated_value_hash<std::string, std::hash<std::string_view>>;
+    std::unordered_set<value_type, hash, tcb::allocated_value_equal_to> set;
+    set.emplace(std::string("apple"));
+    set.emplace(std::string("banana"));
+
+    counting_allocator<std::string>::allocations = 0;
+    REQUIRE(set.find(std::string_view("banana")) != set.end());
+    REQUIRE(set.find(std::string("apple")) != set.end());
+    REQUIRE(set.count(std::string_view("cherry")) == 0);
+    REQUIRE(counting_allocator<std::string>::allocations == 0);
+}
+
+TEST_CASE("Transparent comparators accept allocated_values on either side", "[three_way]")
+{
+    const auto a = make_allocated_value<int>(1);
+    const auto b = make_allocated_value<int>(2);
+
+    REQUIRE(tcb::allocated_value_less{}(a, b));
+    REQUIRE(tcb::allocated_value_less{}(a, 2));
+    REQUIRE(tcb::allocated_value_less{}(0, a));
+    REQUIRE(tcb::allocated_value_equal_to{}(a, 1));
+    REQUIRE(tcb::allocated_value_equal_to{}(1, a));
+    REQUIRE(tcb::allocated_value_hash<int>{}(a) == std::hash<int>{}(1));
+}
@@ -0,0 +1,30 @@
+#include "test_fast_pimpl.hpp"
+
+#include <utility>
+
+struct test_fast_pimpl::private_ {
+    int i;
+    std::string name;
+};
+
+test_fast_pimpl::test_fast_pimpl(int val, std::string name)
+    : priv_(private_{val, std::move(name)})
+{}
+
+// Defaulted special members. The size of private_ is checked here.
+test_fast_pimpl::test_fast_pimpl() = default;
+test_fast_pimpl::test_fast_pimpl(const test_fast_pimpl&) = default;
+test_fast_pimpl::test_fast_pimpl(test_fast_pimpl&&) noexcept = default;
+test_fast_pimpl::~test_fast_pimpl() = default;
+test_fast_pimpl& test_fast_pimpl::operator=(const test_fast_pimpl&) = default;
+test_fast_pimpl& test_fast_pimpl::operator=(test_fast_pimpl&&) = default;
+
+int test_fast_pimpl::get_value() const
+{
+    return priv_->i;
+}
+
+const std::string& test_fast_pimpl::get_name() const
+{
+    return priv_->name;
+}
@@ -0,0 +1,27 @@
+
+#pragma once
+
+#include <tcb/fast_pimpl.hpp>
+
+#include <string>
+
+class test_fast_pimpl {
+public:
+    test_fast_pimpl();
+    test_fast_pimpl(int val, std::string name);
+
+    // Special member declarations (defaulted in implementation file)
+    test_fast_pimpl(const test_fast_pimpl&);
+    test_fast_pimpl(test_fast_pimpl&&) noexcept;
+    ~test_fast_pimpl();
+    test_fast_pimpl& operator=(const test_fast_pimpl&);
+    test_fast_pimpl& operator=(test_fast_pimpl&&);
+
+    int get_value() const;
+    const std::string& get_name() const;
+
+private:
+    struct private_;
+    // Enough for an int and a std::string on common 64-bit ABIs
+    tcb::fast_pimpl<private_, 48, 8> priv_;
+};